@@ -14,32 +14,118 @@
 #include <kodi/gui/dialogs/Select.h>
 #include <kodi/tools/StringUtils.h>
 #include <zlib.h>
+#include <algorithm>
 
 using namespace NextPVR::utilities;
 
 namespace NextPVR
 {
+  Request::ScopedSlot::ScopedSlot(Request& request, const std::string& resource) :
+    m_request(request),
+    m_method(GetMethodName(resource))
+  {
+    const eRequestPriority priority = m_request.GetPriority(resource);
+    bool promoted;
+    m_waitMicroseconds = m_request.m_slots.Acquire(priority, promoted);
+    m_acquired = std::chrono::steady_clock::now();
+    if (promoted)
+      kodi::Log(ADDON_LOG_DEBUG, "Request priority %d promoted after %d ms", priority, WaitMilliseconds());
+  }
+
+  Request::ScopedSlot::~ScopedSlot()
+  {
+    const int64_t serviceMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_acquired).count();
+    m_request.m_metrics.RecordRequest(m_method, m_waitMicroseconds, serviceMicroseconds, m_bytes);
+    m_request.m_slots.Release();
+  }
+
+  std::string Request::GetMethodName(const std::string& resource)
+  {
+    // method requests are passed as "name&args", the rest as "/path?method=name&args"
+    size_t start = resource.find("method=");
+    start = start == std::string::npos ? 0 : start + 7;
+    return resource.substr(start, resource.find_first_of("&?", start) - start);
+  }
+
+  eRequestPriority Request::GetPriority(const std::string& resource) const
+  {
+    const std::string method = GetMethodName(resource);
+
+    if (kodi::tools::StringUtils::StartsWith(method, "channel.transcode.") || kodi::tools::StringUtils::StartsWith(method, "channel.stream.")
+      || method == "recording.watched.set" || kodi::tools::StringUtils::StartsWith(method, "session."))
+      return PriorityHigh;
+
+    if (method == "channel.listings" || method == "channel.icon"
+      || (method == "recording.list" && resource.find("filter=all") != std::string::npos))
+      return PriorityBulk;
+
+    return PriorityNormal;
+  }
+
+  int Request::GetQueueDepth(eRequestPriority priority) const
+  {
+    return m_slots.GetQueueDepth(priority);
+  }
+
+  int Request::GetPeakQueueDepth(eRequestPriority priority) const
+  {
+    return m_slots.GetPeakQueueDepth(priority);
+  }
+
+  unsigned int Request::GetPromotions() const
+  {
+    return m_slots.GetPromotions();
+  }
+
   int Request::DoRequest(std::string resource, std::string& response)
+  {
+    bool stale = false;
+    if (m_cache.Get(resource, response, stale))
+    {
+      if (stale)
+      {
+        StartRefresh([this, resource]
+        {
+          std::string refreshed;
+          if (FetchRequest(resource, refreshed) == HTTP_OK)
+            m_cache.Put(resource, refreshed);
+        });
+      }
+      return HTTP_OK;
+    }
+
+    int resultCode = FetchRequest(resource, response);
+    if (m_cache.IsCacheable(resource))
+    {
+      if (resultCode == HTTP_OK)
+        m_cache.Put(resource, response);
+      else if (m_cache.GetFallback(resource, response))
+      {
+        kodi::Log(ADDON_LOG_INFO, "DoRequest %s failed, using cached response", resource.c_str());
+        resultCode = HTTP_OK;
+      }
+    }
+    return resultCode;
+  }
+
+  int Request::FetchRequest(const std::string& resource, std::string& response)
   {
     auto start = std::chrono::steady_clock::now();
     char separator = resource.find("?") == std::string::npos ? '?' : '&';
-    std::unique_lock<std::mutex> lock(m_mutexRequest);
     // build request string, adding SID
     const std::string URL = kodi::tools::StringUtils::Format("%s%s%csid=%s", m_settings->m_urlBase,
-      resource.c_str(), separator, GetSID());
+      resource.c_str(), separator, GetSID().c_str());
+
+    ScopedSlot slot(*this, resource);
 
     // ask XBMC to read the URL for us
     int resultCode = HTTP_NOTFOUND;
     kodi::vfs::CFile stream;
     if (stream.OpenFile(URL, ADDON_READ_NO_CACHE))
     {
-      char buffer[1025] = {0};
-      int count;
-      while ((count=stream.Read(buffer, 1024)))
-      {
-        response.append(buffer, count);
-      }
+      ReadResponse(stream, response);
       stream.Close();
+      slot.SetBytes(response.length());
       resultCode = HTTP_OK;
       if (response.empty())
       {
@@ -52,7 +138,7 @@ namespace NextPVR
       }
     }
     int milliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
-    kodi::Log(ADDON_LOG_DEBUG, "DoRequest return %s %d %d %d", resource.c_str(), resultCode, response.length(), milliseconds);
+    kodi::Log(ADDON_LOG_DEBUG, "DoRequest return %s %d %d %d %d", resource.c_str(), resultCode, response.length(), slot.WaitMilliseconds(), milliseconds - slot.WaitMilliseconds());
     return resultCode;
   }
 
@@ -64,82 +150,246 @@ namespace NextPVR
   }
 
   tinyxml2::XMLError Request::DoMethodRequest(std::string resource, tinyxml2::XMLDocument& doc, bool compressed)
+  {
+    m_cache.Invalidate(resource);
+    std::string response;
+    bool stale = false;
+    if (m_cache.Get(resource, response, stale))
+    {
+      if (stale)
+        RefreshMethodResponse(resource, compressed);
+      return ParseMethodRequest(doc, response, false);
+    }
+
+    tinyxml2::XMLError retError = FetchMethodResponse(resource, compressed, doc, response);
+    if (m_cache.IsCacheable(resource))
+    {
+      if (retError == tinyxml2::XML_SUCCESS)
+        m_cache.Put(resource, response);
+      else if (m_cache.GetFallback(resource, response))
+      {
+        kodi::Log(ADDON_LOG_INFO, "DoMethodRequest %s failed, using cached response", resource.c_str());
+        retError = ParseMethodRequest(doc, response, false);
+      }
+    }
+    return retError;
+  }
+
+  tinyxml2::XMLError Request::FetchMethodResponse(const std::string& resource, bool compressed, tinyxml2::XMLDocument& doc, std::string& response)
   {
     auto start = std::chrono::steady_clock::now();
     // return is same on timeout or http return ie 404, 500.
     tinyxml2::XMLError retError = tinyxml2::XML_ERROR_FILE_NOT_FOUND;
-    std::unique_lock<std::mutex> lock(m_mutexRequest);
-    // build request string, adding SID if required
     std::string URL;
+    if (!GetMethodURL(resource, compressed, URL))
+      return tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED;
+
+    int waitMilliseconds = 0;
+    bool shared = false;
+    const bool opened = JoinFlight(resource, response, shared, [&](std::string& text)
+    {
+      ScopedSlot slot(*this, resource);
+      waitMilliseconds = slot.WaitMilliseconds();
+      // ask XBMC to read the URL for us
+      kodi::vfs::CFile stream;
+      if (!stream.OpenFile(URL, ADDON_READ_NO_CACHE))
+        return false;
+      ReadResponse(stream, text);
+      stream.Close();
+      slot.SetBytes(text.length());
+      return true;
+    });
+    if (opened)
+    {
+      auto parseStart = std::chrono::steady_clock::now();
+      retError = ParseMethodRequest(doc, response, true);
+      m_metrics.RecordParse(GetMethodName(resource), std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - parseStart).count());
+    }
+    int milliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+    kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest %s %d %d %d %d%s", resource.c_str(), retError, response.length(), waitMilliseconds, milliseconds - waitMilliseconds, shared ? " shared" : "");
+    return retError;
+  }
+
+  bool Request::IsIdempotent(const std::string& resource) const
+  {
+    for (const char* method : { "recording.lastupdated", "system.", "recording.list", "recording.recurring.list",
+                                "channel.groups", "channel.list", "setting.get", "setting.list" })
+    {
+      if (kodi::tools::StringUtils::StartsWith(resource, method))
+        return true;
+    }
+    return false;
+  }
+
+  bool Request::JoinFlight(const std::string& resource, std::string& response, bool& shared, const std::function<bool(std::string&)>& fetch)
+  {
+    shared = false;
+    if (!IsIdempotent(resource))
+    {
+      if (!kodi::tools::StringUtils::StartsWith(resource, "recording."))
+        return fetch(response);
+      // a change to recordings or timers makes list results fetched before it ends wrong
+      m_flights.Invalidate();
+      const bool success = fetch(response);
+      m_flights.Invalidate();
+      return success;
+    }
+    return m_flights.Join(resource, response, shared, fetch);
+  }
+
+  bool Request::ShareFlight(const std::string& resource, std::string& response)
+  {
+    if (!IsIdempotent(resource))
+      return false;
+    return m_flights.Share(resource, response);
+  }
+
+  tinyxml2::XMLError Request::DoMethodRequest(std::string resource, const char* recordTag, const XMLRecordReader::RecordCallback& callback, bool compressed)
+  {
+    XMLRecordReader reader(recordTag, callback);
+    const bool cacheable = m_cache.IsCacheable(resource);
+    std::string response;
+    bool stale = false;
+    if (m_cache.Get(resource, response, stale))
+    {
+      if (stale)
+        RefreshMethodResponse(resource, compressed);
+      reader.Feed(response.data(), response.size());
+      return reader.Finish();
+    }
+    // an identical request in flight or just finished is shared rather than streamed again
+    if (ShareFlight(resource, response))
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest %s shared", resource.c_str());
+      reader.Feed(response.data(), response.size());
+      return reader.Finish();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    tinyxml2::XMLError retError = tinyxml2::XML_ERROR_FILE_NOT_FOUND;
+    std::string URL;
+    if (!GetMethodURL(resource, compressed, URL))
+      return tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED;
 
+    ScopedSlot slot(*this, resource);
+    // records are parsed as each chunk arrives, only the partial record is buffered
+    // unless the response is also wanted for the cache
+    kodi::vfs::CFile stream;
+    if (stream.OpenFile(URL, ADDON_READ_NO_CACHE))
+    {
+      std::string chunk(RESPONSE_CHUNK, '\0');
+      ssize_t count;
+      while ((count = stream.Read(&chunk[0], chunk.size())) > 0)
+      {
+        if (cacheable)
+          response.append(chunk.data(), count);
+        if (!reader.Feed(chunk.data(), count))
+          break;
+      }
+      stream.Close();
+      slot.SetBytes(reader.Length());
+      retError = reader.Finish();
+      TrackSID(retError);
+      if (cacheable && retError == tinyxml2::XML_SUCCESS)
+        m_cache.Put(resource, response);
+    }
+    int milliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+    kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest %s %d %d %d %d records %d", resource.c_str(), retError, reader.Length(), slot.WaitMilliseconds(), milliseconds - slot.WaitMilliseconds(), reader.Records());
+    return retError;
+  }
+
+  void Request::RefreshMethodResponse(const std::string& resource, bool compressed)
+  {
+    StartRefresh([this, resource, compressed]
+    {
+      tinyxml2::XMLDocument doc;
+      std::string refreshed;
+      if (FetchMethodResponse(resource, compressed, doc, refreshed) == tinyxml2::XML_SUCCESS)
+        m_cache.Put(resource, refreshed);
+    });
+  }
+
+  void Request::StartRefresh(std::function<void()> refresh)
+  {
+    // one background refresh at a time, callers keep getting the stale copy meanwhile
+    bool expected = false;
+    if (!m_refreshing.compare_exchange_strong(expected, true))
+      return;
+    if (m_refreshThread.joinable())
+      m_refreshThread.join();
+    m_refreshThread = std::thread([this, refresh]
+    {
+      refresh();
+      m_refreshing = false;
+    });
+  }
+
+  bool Request::GetMethodURL(const std::string& resource, bool compressed, std::string& URL)
+  {
+    // build request string, adding SID if required
     if (IsActiveSID())
-      URL = kodi::tools::StringUtils::Format("%s/service?method=%s&sid=%s", m_settings->m_urlBase, resource.c_str(), GetSID());
+      URL = kodi::tools::StringUtils::Format("%s/service?method=%s&sid=%s", m_settings->m_urlBase, resource.c_str(), GetSID().c_str());
     else if (kodi::tools::StringUtils::StartsWith(resource, "session"))
       URL = kodi::tools::StringUtils::Format("%s/service?method=%s", m_settings->m_urlBase, resource.c_str());
     else
     {
       kodi::Log(ADDON_LOG_ERROR, "%s called before session.login", resource.c_str());
-      return tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED;
+      return false;
     }
 
     if (!compressed)
       URL += "|Accept-Encoding=identity";
+    return true;
+  }
 
-    // ask XBMC to read the URL for us
-    kodi::vfs::CFile stream;
-    std::string response;
-    if (stream.OpenFile(URL, ADDON_READ_NO_CACHE))
+  void Request::ReadResponse(kodi::vfs::CFile& stream, std::string& response)
+  {
+    // Content-Length is only a hint, it is the compressed size when the backend gzips the body
+    const int64_t length = stream.GetLength();
+    size_t used = response.size();
+    response.resize(used + (length > 0 ? static_cast<size_t>(length) : RESPONSE_CHUNK));
+    while (true)
     {
-      char buffer[1025]{ 0 };
-      int count;
-      while ((count = stream.Read(buffer, 1024)))
+      if (used == response.size())
       {
-        response.append(buffer, count);
+        // buffer is full, only grow it if there really is more to come
+        char probe[4096];
+        const ssize_t count = stream.Read(probe, sizeof(probe));
+        if (count <= 0)
+          break;
+        response.resize(std::max(response.size() * 2, used + RESPONSE_CHUNK));
+        memcpy(&response[used], probe, count);
+        used += count;
+        continue;
       }
-      stream.Close();
-      retError = ParseMethodRequest(doc, response);
+      const ssize_t count = stream.Read(&response[used], response.size() - used);
+      if (count <= 0)
+        break;
+      used += count;
     }
-    int milliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
-    kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest %s %d %d %d", resource.c_str(), retError, response.length(), milliseconds);
-    return retError;
+    response.resize(used);
   }
 
-  tinyxml2::XMLError Request::ParseMethodRequest(tinyxml2::XMLDocument& doc, const std::string& xml)
+  tinyxml2::XMLError Request::ParseMethodRequest(tinyxml2::XMLDocument& doc, const std::string& xml, bool fromBackend)
   {
-    tinyxml2::XMLError retError = doc.Parse(xml.c_str());;
+    tinyxml2::XMLError retError = doc.Parse(xml.data(), xml.size());
     if (retError == tinyxml2::XML_SUCCESS)
     {
-      const char* attrib = doc.RootElement()->Attribute("stat");
-      if (attrib == nullptr || strcmp(attrib, "ok"))
-      {
-        kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest bad return %s", attrib);
-        retError = tinyxml2::XML_NO_ATTRIBUTE;
-        if (!strcmp(attrib, "fail"))
-        {
-          const tinyxml2::XMLElement* err = doc.RootElement()->FirstChildElement("err");
-          if (err)
-          {
-            const char* code = err->Attribute("code");
-            if (code)
-            {
-              kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest error code %s", code);
-              if (atoi(code) == 8)
-              {
-                ClearSID();
-                retError = tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED;
-              }
-            }
-          }
-        }
-      }
-      else
-      {
-        RenewSID();
-      }
+      retError = CheckResponseStatus(doc.RootElement());
+      if (fromBackend)
+        TrackSID(retError);
     }
     return retError;
   }
 
+  void Request::TrackSID(tinyxml2::XMLError status)
+  {
+    if (status == tinyxml2::XML_SUCCESS)
+      RenewSID();
+    else if (status == tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED)
+      ClearSID();
+  }
+
   tinyxml2::XMLError Request::GetLastUpdate(std::string resource, time_t& last_update)
   {
     tinyxml2::XMLDocument doc;
@@ -152,19 +402,28 @@ namespace NextPVR
         xmlReturn = tinyxml2::XML_NO_TEXT_NODE;
       }
       last_update = value + m_settings->m_serverTimeOffset;
+      // cached responses depending on either stamp are dropped when it moves
+      if (xmlReturn == tinyxml2::XML_SUCCESS)
+      {
+        const std::string method = resource.substr(0, resource.find('&'));
+        if (method == "recording.lastupdated")
+          m_cache.Validate(InvalidateRecordings, last_update);
+        else if (method == "system.epg.summary")
+          m_cache.Validate(InvalidateEPG, last_update);
+      }
     }
     return xmlReturn;
   }
 
   int Request::FileCopy(const char* resource, std::string fileName)
   {
-    std::unique_lock<std::mutex> lock(m_mutexRequest);
     ssize_t written = 0;
-    m_start = time(nullptr);
-
+    auto start = std::chrono::steady_clock::now();
 
     char separator = (strchr(resource, '?') == nullptr) ? '?' : '&';
-    const std::string URL = kodi::tools::StringUtils::Format("%s%s%csid=%s", m_settings->m_urlBase, resource, separator, GetSID());
+    const std::string URL = kodi::tools::StringUtils::Format("%s%s%csid=%s", m_settings->m_urlBase, resource, separator, GetSID().c_str());
+
+    ScopedSlot slot(*this, resource);
 
     // ask XBMC to read the URL for us
     int resultCode = HTTP_NOTFOUND;
@@ -173,12 +432,12 @@ namespace NextPVR
     if (inputStream.OpenFile(URL, ADDON_READ_NO_CACHE))
     {
       kodi::vfs::CFile outputFile;
-      if (outputFile.OpenFileForWrite(fileName))
+      if (outputFile.OpenFileForWrite(fileName, true))
       {
-        char buffer[1024];
-        while ((datalen = inputStream.Read( buffer, sizeof(buffer))))
+        std::string buffer(RESPONSE_CHUNK, '\0');
+        while ((datalen = inputStream.Read(&buffer[0], buffer.size())) > 0)
         {
-          outputFile.Write( buffer, datalen);
+          outputFile.Write(buffer.data(), datalen);
           written += datalen;
         }
         inputStream.Close();
@@ -190,7 +449,9 @@ namespace NextPVR
     {
       resultCode = HTTP_BADREQUEST;
     }
-    kodi::Log(ADDON_LOG_DEBUG, "FileCopy (%s - %s) %zu %d %d", resource, fileName.c_str(), resultCode, written, time(nullptr) - m_start);
+    slot.SetBytes(written);
+    int milliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+    kodi::Log(ADDON_LOG_DEBUG, "FileCopy (%s - %s) %zu %d %d %d", resource, fileName.c_str(), resultCode, written, slot.WaitMilliseconds(), milliseconds - slot.WaitMilliseconds());
 
     return resultCode;
   }
@@ -293,11 +554,22 @@ namespace NextPVR
     return foundAddress;
   }
   Request::Request(const std::shared_ptr<InstanceSettings>& settings) :
-    m_settings(settings)
+    m_settings(settings),
+    m_slots([this] { return m_settings->m_backendConcurrency; }, PRIORITY_AGING_MS),
+    m_flights(FLIGHT_LINGER_MS)
   {
   }
   Request::Request(InstanceSettings* settings) :
-    m_settings(settings)
+    m_settings(settings),
+    m_slots([this] { return m_settings->m_backendConcurrency; }, PRIORITY_AGING_MS),
+    m_flights(FLIGHT_LINGER_MS)
+  {
+  }
+  Request::~Request()
   {
+    if (m_refreshThread.joinable())
+      m_refreshThread.join();
+    kodi::Log(ADDON_LOG_DEBUG, "ResponseCache %s", m_cache.GetStats().c_str());
+    kodi::Log(ADDON_LOG_DEBUG, "Shared requests %u", m_flights.GetShared());
   }
 } // namespace NextPVR
@@ -13,11 +13,23 @@
   #include "windows.h"
 #endif
 #include <kodi/Filesystem.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <ctime>
+#include <list>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <stdio.h>
 #include <stdlib.h>
 #include "tinyxml2.h"
+#include "utilities/FlightTable.h"
+#include "utilities/Metrics.h"
+#include "utilities/ResponseCache.h"
+#include "utilities/SlotPool.h"
+#include "utilities/XMLRecordReader.h"
 
 #define HTTP_OK 200
 #define HTTP_NOTFOUND 404
@@ -27,6 +39,16 @@
 
 namespace NextPVR
 {
+  enum eRequestPriority
+  {
+    PriorityHigh = 0,
+    PriorityNormal = 1,
+    PriorityBulk = 2
+  };
+
+  constexpr int REQUEST_PRIORITIES = 3;
+  static_assert(REQUEST_PRIORITIES == utilities::SlotPool::LANES, "every priority needs a slot pool lane");
+
   class ATTR_DLL_LOCAL Request
   {
   public:
@@ -36,27 +58,92 @@ namespace NextPVR
     int DoRequest(std::string resource, std::string& response);
     bool DoActionRequest(std::string resource);
     tinyxml2::XMLError DoMethodRequest(std::string resource, tinyxml2::XMLDocument& doc, bool compresssed = true);
+    /*
+     * Streams the response, calling back with each <recordTag> element as it
+     * downloads.  The callback runs while a backend slot is held so it must not
+     * make backend requests of its own.
+     */
+    tinyxml2::XMLError DoMethodRequest(std::string resource, const char* recordTag, const utilities::XMLRecordReader::RecordCallback& callback, bool compresssed = true);
     int FileCopy(const char* resource, std::string fileName);
     tinyxml2::XMLError  GetLastUpdate(std::string resource, time_t& last_update);
     bool PingBackend();
     bool OneTimeSetup();
-    const char* GetSID() { return m_sid.c_str(); };
+    std::string GetSID() { std::unique_lock<std::mutex> lock(m_mutexSID); return m_sid; };
     std::vector<std::vector<std::string>> Discovery();
 
-    void SetSID(std::string newsid) { m_sid = newsid; };
-    void ClearSID() { m_sid.clear(); m_sidUpdate = 0; };
-    void RenewSID() { m_sidUpdate = time(nullptr); };
-    bool IsActiveSID() { return !m_sid.empty() && time(nullptr) < m_sidUpdate + 3600; };
+    void SetSID(std::string newsid) { std::unique_lock<std::mutex> lock(m_mutexSID); m_sid = newsid; };
+    void ClearSID() { std::unique_lock<std::mutex> lock(m_mutexSID); m_sid.clear(); m_sidUpdate = 0; };
+    void RenewSID() { std::unique_lock<std::mutex> lock(m_mutexSID); m_sidUpdate = time(nullptr); };
+    bool IsActiveSID() { std::unique_lock<std::mutex> lock(m_mutexSID); return !m_sid.empty() && time(nullptr) < m_sidUpdate + 3600; };
+    static std::string GetMethodName(const std::string& resource);
+    eRequestPriority GetPriority(const std::string& resource) const;
+    int GetQueueDepth(eRequestPriority priority) const;
+    int GetPeakQueueDepth(eRequestPriority priority) const;
+    unsigned int GetPromotions() const;
     Request(InstanceSettings* settings);
     Request(const std::shared_ptr<InstanceSettings>& settings);
+    ~Request();
+    std::string GetCacheStats() const { return m_cache.GetStats(); };
+    utilities::Metrics& GetMetrics() { return m_metrics; };
 
   private:
     Request(Request const&) = delete;
     void operator=(Request const&) = delete;
-    tinyxml2::XMLError ParseMethodRequest(tinyxml2::XMLDocument& doc, const std::string& xml);
+
+    /*
+     * Holds one of the in-flight backend slots for its lifetime, blocking
+     * until a slot is free.  The limit is read from the settings on each
+     * acquire so it can be changed without a restart.  The priority is the
+     * slot pool lane, a waiter is promoted one lane for every
+     * PRIORITY_AGING_MS it waits so bulk work is never starved, and bulk
+     * requests leave one slot free for playback when the limit allows it.
+     * Wait and service time are recorded in the metrics when it is released.
+     */
+    class ScopedSlot
+    {
+    public:
+      ScopedSlot(Request& request, const std::string& resource);
+      ~ScopedSlot();
+      int WaitMilliseconds() const { return static_cast<int>(m_waitMicroseconds / 1000); };
+      void SetBytes(int64_t bytes) { m_bytes = bytes; };
+    private:
+      Request& m_request;
+      const std::string m_method;
+      int64_t m_waitMicroseconds = 0;
+      int64_t m_bytes = 0;
+      std::chrono::steady_clock::time_point m_acquired;
+    };
+
+    static constexpr int PRIORITY_AGING_MS = 2000;
+
+    static constexpr size_t RESPONSE_CHUNK = 64 * 1024;
+    int FetchRequest(const std::string& resource, std::string& response);
+    tinyxml2::XMLError FetchMethodResponse(const std::string& resource, bool compressed, tinyxml2::XMLDocument& doc, std::string& response);
+    /*
+     * Identical idempotent method requests that overlap, or arrive within
+     * FLIGHT_LINGER_MS of the last one finishing, share one round trip.  Each
+     * caller parses its own copy of the response text.
+     */
+    static constexpr int FLIGHT_LINGER_MS = 1000;
+    bool IsIdempotent(const std::string& resource) const;
+    bool JoinFlight(const std::string& resource, std::string& response, bool& shared, const std::function<bool(std::string&)>& fetch);
+    bool ShareFlight(const std::string& resource, std::string& response);
+    void RefreshMethodResponse(const std::string& resource, bool compressed);
+    void StartRefresh(std::function<void()> refresh);
+    bool GetMethodURL(const std::string& resource, bool compressed, std::string& URL);
+    void ReadResponse(kodi::vfs::CFile& stream, std::string& response);
+    // only a response that just came from the backend says anything about the session
+    tinyxml2::XMLError ParseMethodRequest(tinyxml2::XMLDocument& doc, const std::string& xml, bool fromBackend);
+    // a backend answer keeps the session alive, an expired session is dropped so the next request logs in again
+    void TrackSID(tinyxml2::XMLError status);
     std::shared_ptr<InstanceSettings> m_settings;
-    mutable std::mutex m_mutexRequest;
-    time_t m_start = 0;
+    utilities::SlotPool m_slots;
+    utilities::FlightTable m_flights;
+    utilities::ResponseCache m_cache;
+    utilities::Metrics m_metrics;
+    std::thread m_refreshThread;
+    std::atomic<bool> m_refreshing{false};
+    mutable std::mutex m_mutexSID;
     std::string m_sid;
     time_t m_sidUpdate = 0;
   };
@@ -0,0 +1,32 @@
+/*
+ *  Copyright (C) 2020-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ChannelIndex.h"
+
+#include <algorithm>
+
+using namespace NextPVR;
+
+ChannelIndex::ChannelIndex(std::vector<ChannelDetail>&& details) :
+  m_details(std::move(details))
+{
+  std::stable_sort(m_details.begin(), m_details.end(),
+            [](const ChannelDetail& a, const ChannelDetail& b) { return a.uid < b.uid; });
+  // a uid listed twice keeps its first entry
+  m_details.erase(std::unique(m_details.begin(), m_details.end(),
+                              [](const ChannelDetail& a, const ChannelDetail& b) { return a.uid == b.uid; }),
+                  m_details.end());
+}
+
+const ChannelDetail* ChannelIndex::Find(unsigned int uid) const
+{
+  auto it = std::lower_bound(m_details.begin(), m_details.end(), uid,
+                             [](const ChannelDetail& detail, unsigned int value) { return detail.uid < value; });
+  if (it == m_details.end() || it->uid != uid)
+    return nullptr;
+  return &*it;
+}
@@ -0,0 +1,53 @@
+/*
+ *  Copyright (C) 2020-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+
+#pragma once
+
+#include <kodi/AddonBase.h>
+
+#include <string>
+#include <vector>
+
+namespace NextPVR
+{
+
+  struct ChannelDetail
+  {
+    unsigned int uid;
+    bool epgNone;
+    bool radio;
+    bool plugin;
+    std::string mimeType;
+    std::string iconPath;
+  };
+
+  /*
+   * What the rest of the add-on needs to know about each channel Kodi has
+   * been given, sorted by uid in one vector.  An index is never changed once
+   * built; Channels publishes a new one after each channel load so readers
+   * on other threads keep a consistent snapshot for as long as they hold it.
+   */
+  class ATTR_DLL_LOCAL ChannelIndex
+  {
+  public:
+    ChannelIndex() = default;
+    explicit ChannelIndex(std::vector<ChannelDetail>&& details);
+
+    const ChannelDetail* Find(unsigned int uid) const;
+
+    size_t Size() const { return m_details.size(); }
+    std::vector<ChannelDetail>::const_iterator begin() const { return m_details.begin(); }
+    std::vector<ChannelDetail>::const_iterator end() const { return m_details.end(); }
+
+  private:
+    ChannelIndex(ChannelIndex const&) = delete;
+    void operator=(ChannelIndex const&) = delete;
+
+    std::vector<ChannelDetail> m_details;
+  };
+} // namespace NextPVR
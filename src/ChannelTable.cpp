@@ -0,0 +1,315 @@
+/*
+ *  Copyright (C) 2020-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ChannelTable.h"
+
+#include <kodi/Filesystem.h>
+#include <kodi/General.h>
+#include <kodi/tools/StringUtils.h>
+#include "utilities/Hash.h"
+#include "utilities/XMLUtils.h"
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace NextPVR;
+using namespace NextPVR::utilities;
+
+namespace
+{
+class StringPoolBuilder
+{
+public:
+  // offset 0 is the empty string for missing fields
+  StringPoolBuilder() : m_pool(1, '\0') {}
+
+  uint32_t Add(const char* value)
+  {
+    if (*value == '\0')
+      return 0;
+
+    // group and EPG source names repeat on most channels, store them once
+    auto it = m_index.find(value);
+    if (it != m_index.end())
+      return it->second;
+
+    const uint32_t offset = static_cast<uint32_t>(m_pool.size());
+    m_pool.append(value);
+    m_pool.push_back('\0');
+    m_index.emplace(value, offset);
+    return offset;
+  }
+
+  const std::string& Pool() const { return m_pool; }
+
+private:
+  std::string m_pool;
+  std::unordered_map<std::string, uint32_t> m_index;
+};
+
+uint32_t AppendColumn(std::string& image, const void* data, size_t length)
+{
+  image.resize((image.size() + 3) & ~static_cast<size_t>(3), '\0');
+  const uint32_t offset = static_cast<uint32_t>(image.size());
+  image.append(static_cast<const char*>(data), length);
+  return offset;
+}
+
+bool ColumnFits(const ChannelTableHeader* header, uint32_t offset, size_t count, size_t width)
+{
+  return offset % width == 0 && offset >= sizeof(ChannelTableHeader) && offset <= header->fileSize &&
+         count <= (header->fileSize - offset) / width;
+}
+} // unnamed namespace
+
+bool ChannelTable::Parse(const char* xml, size_t length, time_t updateTime)
+{
+  tinyxml2::XMLDocument doc;
+  if (doc.Parse(xml, length) != tinyxml2::XML_SUCCESS || doc.RootElement() == nullptr)
+    return false;
+
+  const tinyxml2::XMLElement* channelsNode = doc.RootElement()->FirstChildElement("channels");
+  if (channelsNode == nullptr)
+    return false;
+
+  StringPoolBuilder pool;
+  std::vector<uint32_t> id, number, minor, name, epgSource, groupStart(1, 0), groups;
+  std::vector<uint8_t> flagColumn;
+  const tinyxml2::XMLElement* pChannelNode;
+  for (pChannelNode = channelsNode->FirstChildElement("channel"); pChannelNode; pChannelNode = pChannelNode->NextSiblingElement())
+  {
+    uint8_t flags = 0;
+    std::string buffer;
+    XMLUtils::GetString(pChannelNode, "type", buffer);
+    if (buffer == "0xa")
+      flags |= ChannelRadio;
+
+    // any well formed <icon> means the backend has one
+    bool isIcon;
+    if (XMLUtils::GetBoolean(pChannelNode, "icon", isIcon))
+      flags |= ChannelIcon;
+
+    // V5 has the EPG source type info.
+    std::string epg;
+    if (XMLUtils::GetString(pChannelNode, "epg", epg) && epg == "None")
+      flags |= ChannelEpgNone;
+
+    const tinyxml2::XMLElement* groupsNode = pChannelNode->FirstChildElement("groups");
+    if (groupsNode != nullptr)
+    {
+      flags |= ChannelHasGroups;
+      for (const tinyxml2::XMLElement* pGroupNode = groupsNode->FirstChildElement("group"); pGroupNode; pGroupNode = pGroupNode->NextSiblingElement("group"))
+      {
+        if (pGroupNode->GetText() != nullptr)
+          groups.push_back(pool.Add(pGroupNode->GetText()));
+      }
+    }
+    groupStart.push_back(static_cast<uint32_t>(groups.size()));
+
+    buffer.clear();
+    XMLUtils::GetString(pChannelNode, "name", buffer);
+
+    id.push_back(XMLUtils::GetUIntValue(pChannelNode, "id"));
+    number.push_back(XMLUtils::GetUIntValue(pChannelNode, "number"));
+    minor.push_back(XMLUtils::GetUIntValue(pChannelNode, "minor"));
+    name.push_back(pool.Add(buffer.c_str()));
+    epgSource.push_back(pool.Add(epg.c_str()));
+    flagColumn.push_back(flags);
+  }
+
+  ChannelTableHeader header{};
+  memcpy(header.magic, CHANNEL_TABLE_MAGIC, sizeof(header.magic));
+  header.version = CHANNEL_TABLE_VERSION;
+  header.byteOrder = CHANNEL_TABLE_BYTE_ORDER;
+  header.updateTime = static_cast<int64_t>(updateTime);
+  header.channels = static_cast<uint32_t>(id.size());
+  header.groupRefs = static_cast<uint32_t>(groups.size());
+  header.poolSize = static_cast<uint32_t>(pool.Pool().size());
+
+  std::string image(sizeof(header), '\0');
+  header.id = AppendColumn(image, id.data(), id.size() * sizeof(uint32_t));
+  header.number = AppendColumn(image, number.data(), number.size() * sizeof(uint32_t));
+  header.minor = AppendColumn(image, minor.data(), minor.size() * sizeof(uint32_t));
+  header.name = AppendColumn(image, name.data(), name.size() * sizeof(uint32_t));
+  header.epg = AppendColumn(image, epgSource.data(), epgSource.size() * sizeof(uint32_t));
+  header.groupStart = AppendColumn(image, groupStart.data(), groupStart.size() * sizeof(uint32_t));
+  header.groups = AppendColumn(image, groups.data(), groups.size() * sizeof(uint32_t));
+  header.flags = AppendColumn(image, flagColumn.data(), flagColumn.size());
+  header.pool = AppendColumn(image, pool.Pool().data(), pool.Pool().size());
+  header.fileSize = static_cast<uint32_t>(image.size());
+  memcpy(&image[0], &header, sizeof(header));
+
+  m_mapping.reset();
+  m_image.swap(image);
+  return Attach(m_image.data(), m_image.size());
+}
+
+bool ChannelTable::Load(const std::string& filename)
+{
+  std::unique_ptr<MappedFile> mapping(new MappedFile());
+  if (!mapping->Open(filename))
+    return false;
+
+  if (!Attach(mapping->Data(), mapping->Size()))
+  {
+    kodi::Log(ADDON_LOG_INFO, "Ignoring unusable channel table %s", filename.c_str());
+    return false;
+  }
+  m_image.clear();
+  m_mapping.swap(mapping);
+  return true;
+}
+
+bool ChannelTable::Save(const std::string& filename) const
+{
+  if (m_header == nullptr)
+    return false;
+
+  // write beside the old table and swap, a mapped reader never sees a partial file
+  const std::string tempFile = filename + ".tmp";
+  kodi::vfs::CFile file;
+  if (!file.OpenFileForWrite(tempFile, true))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot write channel table %s", tempFile.c_str());
+    return false;
+  }
+  const bool written = file.Write(m_header, m_header->fileSize) == static_cast<ssize_t>(m_header->fileSize);
+  file.Close();
+  if (!written || !kodi::vfs::RenameFile(tempFile, filename))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot replace channel table %s", filename.c_str());
+    kodi::vfs::DeleteFile(tempFile);
+    return false;
+  }
+  return true;
+}
+
+bool ChannelTable::Attach(const void* data, size_t size)
+{
+  m_header = nullptr;
+  if (size < sizeof(ChannelTableHeader))
+    return false;
+
+  const ChannelTableHeader* header = static_cast<const ChannelTableHeader*>(data);
+  if (memcmp(header->magic, CHANNEL_TABLE_MAGIC, sizeof(header->magic)) != 0 || header->version != CHANNEL_TABLE_VERSION ||
+      header->byteOrder != CHANNEL_TABLE_BYTE_ORDER || header->fileSize != size)
+    return false;
+
+  // a truncated or damaged file must not be able to send a lookup outside the image
+  if (!ColumnFits(header, header->id, header->channels, sizeof(uint32_t)) ||
+      !ColumnFits(header, header->number, header->channels, sizeof(uint32_t)) ||
+      !ColumnFits(header, header->minor, header->channels, sizeof(uint32_t)) ||
+      !ColumnFits(header, header->name, header->channels, sizeof(uint32_t)) ||
+      !ColumnFits(header, header->epg, header->channels, sizeof(uint32_t)) ||
+      !ColumnFits(header, header->groupStart, header->channels + static_cast<size_t>(1), sizeof(uint32_t)) ||
+      !ColumnFits(header, header->groups, header->groupRefs, sizeof(uint32_t)) ||
+      !ColumnFits(header, header->flags, header->channels, 1) ||
+      !ColumnFits(header, header->pool, header->poolSize, 1) || header->poolSize == 0)
+    return false;
+
+  const char* base = static_cast<const char*>(data);
+  const uint32_t* name = reinterpret_cast<const uint32_t*>(base + header->name);
+  const uint32_t* epg = reinterpret_cast<const uint32_t*>(base + header->epg);
+  const uint32_t* groupStart = reinterpret_cast<const uint32_t*>(base + header->groupStart);
+  const uint32_t* groups = reinterpret_cast<const uint32_t*>(base + header->groups);
+  const char* pool = base + header->pool;
+  if (pool[header->poolSize - 1] != '\0' || groupStart[0] != 0 || groupStart[header->channels] != header->groupRefs)
+    return false;
+  for (uint32_t row = 0; row < header->channels; row++)
+  {
+    if (name[row] >= header->poolSize || epg[row] >= header->poolSize || groupStart[row] > groupStart[row + 1])
+      return false;
+  }
+  for (uint32_t ref = 0; ref < header->groupRefs; ref++)
+  {
+    if (groups[ref] >= header->poolSize)
+      return false;
+  }
+
+  m_id = reinterpret_cast<const uint32_t*>(base + header->id);
+  m_number = reinterpret_cast<const uint32_t*>(base + header->number);
+  m_minor = reinterpret_cast<const uint32_t*>(base + header->minor);
+  m_name = name;
+  m_epg = epg;
+  m_groupStart = groupStart;
+  m_groups = groups;
+  m_flags = reinterpret_cast<const uint8_t*>(base + header->flags);
+  m_pool = pool;
+  m_header = header;
+  return true;
+}
+
+uint64_t ChannelTable::GetRowHash(size_t row) const
+{
+  uint64_t hash = FNV_OFFSET_BASIS;
+  const uint32_t numbers[3] = {m_id[row], m_number[row], m_minor[row]};
+  hash = HashBytes(hash, numbers, sizeof(numbers));
+  hash = HashBytes(hash, &m_flags[row], 1);
+  hash = HashString(hash, GetName(row));
+  hash = HashString(hash, GetEpgSource(row));
+  for (size_t index = 0; index < GetGroupCount(row); index++)
+    hash = HashString(hash, GetGroup(row, index));
+  return hash;
+}
+
+uint64_t ChannelTable::GetLineupHash() const
+{
+  uint64_t hash = FNV_OFFSET_BASIS;
+  for (size_t row = 0; row < Size(); row++)
+  {
+    const uint64_t rowHash = GetRowHash(row);
+    hash = HashBytes(hash, &rowHash, sizeof(rowHash));
+  }
+  return hash;
+}
+
+ChannelDiff ChannelTable::Diff(const ChannelTable& before, const ChannelTable& after)
+{
+  ChannelDiff diff;
+  if (before.Size() == after.Size() && before.GetLineupHash() == after.GetLineupHash())
+    return diff;
+
+  std::unordered_map<unsigned int, size_t> beforeRows;
+  for (size_t row = 0; row < before.Size(); row++)
+    beforeRows.emplace(before.GetId(row), row);
+
+  for (size_t row = 0; row < after.Size(); row++)
+  {
+    auto it = beforeRows.find(after.GetId(row));
+    if (it == beforeRows.end())
+    {
+      diff.added++;
+      continue;
+    }
+    const size_t old = it->second;
+    beforeRows.erase(it);
+    if (before.GetRowHash(old) == after.GetRowHash(row))
+      continue;
+
+    if (strcmp(before.GetName(old), after.GetName(row)) != 0)
+      diff.renamed++;
+    if (before.GetNumber(old) != after.GetNumber(row) || before.GetMinor(old) != after.GetMinor(row))
+      diff.renumbered++;
+    if (before.HasIcon(old) != after.HasIcon(row))
+    {
+      diff.iconChanged++;
+      diff.iconChangedUids.push_back(after.GetId(row));
+    }
+    if (before.IsRadio(old) != after.IsRadio(row) || before.IsEpgNone(old) != after.IsEpgNone(row) ||
+        strcmp(before.GetEpgSource(old), after.GetEpgSource(row)) != 0)
+      diff.otherChanged++;
+
+    bool sameGroups = before.GetGroupCount(old) == after.GetGroupCount(row) && before.HasGroups(old) == after.HasGroups(row);
+    for (size_t index = 0; sameGroups && index < after.GetGroupCount(row); index++)
+      sameGroups = strcmp(before.GetGroup(old, index), after.GetGroup(row, index)) == 0;
+    if (!sameGroups)
+      diff.groupsChanged++;
+  }
+  diff.removed = static_cast<int>(beforeRows.size());
+  return diff;
+}
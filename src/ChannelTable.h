@@ -0,0 +1,140 @@
+/*
+ *  Copyright (C) 2020-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+
+#pragma once
+
+#include "utilities/MappedFile.h"
+#include <kodi/AddonBase.h>
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace NextPVR
+{
+
+  enum eChannelFlags
+  {
+    ChannelRadio = 0x01,
+    ChannelIcon = 0x02,
+    ChannelEpgNone = 0x04,
+    ChannelHasGroups = 0x08
+  };
+
+  constexpr char CHANNEL_TABLE_MAGIC[8] = {'N', 'P', 'V', 'R', 'C', 'H', 'A', 'N'};
+  constexpr uint32_t CHANNEL_TABLE_VERSION = 1;
+  // written in host order, a file from a machine of the other endianness is rebuilt
+  constexpr uint32_t CHANNEL_TABLE_BYTE_ORDER = 0x01020304;
+
+  /*
+   * On-disk and in-memory layout of the table.  Every field has a fixed
+   * width and every column starts on a four byte boundary, so a mapped file
+   * is used as is.  Offsets are from the start of the header.
+   */
+  struct ChannelTableHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    int64_t updateTime;
+    uint32_t fileSize;
+    uint32_t channels;
+    uint32_t groupRefs;
+    uint32_t poolSize;
+    uint32_t id;
+    uint32_t number;
+    uint32_t minor;
+    uint32_t name;
+    uint32_t epg;
+    uint32_t groupStart;
+    uint32_t groups;
+    uint32_t flags;
+    uint32_t pool;
+    uint32_t reserved;
+  };
+  static_assert(sizeof(ChannelTableHeader) == 80, "channel table header must not change size");
+
+  /*
+   * What changed between two lineups.  Kodi needs a channel update for any
+   * per-channel change and a group update when membership or numbering moved.
+   */
+  struct ChannelDiff
+  {
+    int added = 0;
+    int removed = 0;
+    int renamed = 0;
+    int renumbered = 0;
+    int iconChanged = 0;
+    // type or EPG source
+    int otherChanged = 0;
+    int groupsChanged = 0;
+    std::vector<unsigned int> iconChangedUids;
+
+    bool HasChannelChanges() const { return added + removed + renamed + renumbered + iconChanged + otherChanged != 0; }
+    bool HasGroupChanges() const { return added + removed + renumbered + groupsChanged != 0; }
+  };
+
+  /*
+   * The channel.list&extras=true lineup parsed once into one column per field.
+   * Names, EPG sources and group names live in a single string pool and the
+   * columns hold offsets into it.  The columns are always read through the
+   * same image, either built in memory by Parse() or mapped from channel.bin
+   * by Load(), so a cold start needs no inflate and no XML parse.
+   */
+  class ATTR_DLL_LOCAL ChannelTable
+  {
+  public:
+    ChannelTable() = default;
+
+    bool Parse(const char* xml, size_t length, time_t updateTime);
+    bool Load(const std::string& filename);
+    bool Save(const std::string& filename) const;
+
+    size_t Size() const { return m_header ? m_header->channels : 0; }
+    time_t GetUpdateTime() const { return m_header ? static_cast<time_t>(m_header->updateTime) : 0; }
+
+    unsigned int GetId(size_t row) const { return m_id[row]; }
+    unsigned int GetNumber(size_t row) const { return m_number[row]; }
+    unsigned int GetMinor(size_t row) const { return m_minor[row]; }
+    const char* GetName(size_t row) const { return m_pool + m_name[row]; }
+    const char* GetEpgSource(size_t row) const { return m_pool + m_epg[row]; }
+    bool IsRadio(size_t row) const { return (m_flags[row] & ChannelRadio) != 0; }
+    bool HasIcon(size_t row) const { return (m_flags[row] & ChannelIcon) != 0; }
+    bool IsEpgNone(size_t row) const { return (m_flags[row] & ChannelEpgNone) != 0; }
+    bool HasGroups(size_t row) const { return (m_flags[row] & ChannelHasGroups) != 0; }
+
+    uint64_t GetRowHash(size_t row) const;
+    uint64_t GetLineupHash() const;
+    static ChannelDiff Diff(const ChannelTable& before, const ChannelTable& after);
+
+    size_t GetGroupCount(size_t row) const { return m_groupStart[row + 1] - m_groupStart[row]; }
+    const char* GetGroup(size_t row, size_t index) const { return m_pool + m_groups[m_groupStart[row] + index]; }
+
+  private:
+    ChannelTable(ChannelTable const&) = delete;
+    void operator=(ChannelTable const&) = delete;
+
+    bool Attach(const void* data, size_t size);
+
+    std::string m_image;
+    std::unique_ptr<utilities::MappedFile> m_mapping;
+
+    const ChannelTableHeader* m_header = nullptr;
+    const uint32_t* m_id = nullptr;
+    const uint32_t* m_number = nullptr;
+    const uint32_t* m_minor = nullptr;
+    const uint32_t* m_name = nullptr;
+    const uint32_t* m_epg = nullptr;
+    const uint32_t* m_groupStart = nullptr;
+    const uint32_t* m_groups = nullptr;
+    const uint8_t* m_flags = nullptr;
+    const char* m_pool = nullptr;
+  };
+} // namespace NextPVR
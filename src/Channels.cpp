@@ -6,6 +6,7 @@
  */
 
 #include "Channels.h"
+#include "utilities/Hash.h"
 #include "utilities/XMLUtils.h"
 #include "pvrclient-nextpvr.h"
 
@@ -15,30 +16,33 @@
 using namespace NextPVR;
 using namespace NextPVR::utilities;
 
+namespace
+{
+constexpr char LIVE_STREAM_MAGIC[8] = {'N', 'P', 'V', 'R', 'L', 'I', 'V', 'E'};
+constexpr uint32_t LIVE_STREAM_VERSION = 1;
+} // unnamed namespace
+
 /** Channel handling */
 
-Channels::Channels(const std::shared_ptr<InstanceSettings>& settings, Request& request) :
+Channels::Channels(const std::shared_ptr<InstanceSettings>& settings, Request& request, cPVRClientNextPVR& pvrclient) :
   m_settings(settings),
-  m_request(request)
+  m_request(request),
+  m_pvrclient(pvrclient),
+  m_iconFetcher(settings, request, [this] { m_pvrclient.TriggerChannelUpdate(); }),
+  m_channelIndex(std::make_shared<const ChannelIndex>()),
+  m_liveStreams(std::make_shared<const LiveStreamMap>())
 {
 }
 
 int Channels::GetNumChannels()
 {
   // Kodi polls this while recordings are open avoid calls to backend
-  int channelCount = m_channelDetails.size();
+  int channelCount = GetChannelIndex()->Size();
   if (channelCount == 0)
   {
-    tinyxml2::XMLDocument doc;
-    if (ReadCachedChannelList(doc) == tinyxml2::XML_SUCCESS)
-    {
-      tinyxml2::XMLNode* channelsNode = doc.RootElement()->FirstChildElement("channels");
-      tinyxml2::XMLNode* pChannelNode;
-      for( pChannelNode = channelsNode->FirstChildElement("channel"); pChannelNode; pChannelNode=pChannelNode->NextSiblingElement())
-      {
-        channelCount++;
-      }
-    }
+    std::shared_ptr<const ChannelTable> channelTable = GetChannelTable();
+    if (channelTable)
+      channelCount = channelTable->Size();
   }
   return channelCount;
 }
@@ -50,29 +54,29 @@ std::string Channels::GetChannelIcon(int channelID)
   // do we already have the icon file?
   if (kodi::vfs::FileExists(iconFilename))
   {
-    return iconFilename;
-  }
-  const std::string URL = "/service?method=channel.icon&channel_id=" + std::to_string(channelID);
-  if (m_request.FileCopy(URL.c_str(), iconFilename) == HTTP_OK)
-  {
+    m_iconFetcher.Use(channelID);
     return iconFilename;
   }
 
+  // fetched in the background, the channel update after the batch picks it up
+  m_iconFetcher.Queue(channelID);
   return "";
 }
 
 std::string Channels::GetChannelIconFileName(int channelID)
 {
-  return kodi::tools::StringUtils::Format("%snextpvr-ch%d.png",m_settings->m_instanceDirectory.c_str(), channelID);
+  return m_iconFetcher.GetFileName(channelID);
 }
 
 void  Channels::DeleteChannelIcon(int channelID)
 {
   kodi::vfs::DeleteFile(GetChannelIconFileName(channelID));
+  m_iconFetcher.Forget(channelID);
 }
 
 void Channels::DeleteChannelIcons()
 {
+  m_iconFetcher.ForgetAll();
   std::vector<kodi::vfs::CDirEntry> icons;
   if (kodi::vfs::GetDirectory(m_settings->m_instanceDirectory, "nextpvr-ch*.png", icons))
   {
@@ -91,27 +95,21 @@ PVR_ERROR Channels::GetChannels(bool radio, kodi::addon::PVRChannelsResultSet& r
     return PVR_ERROR_NO_ERROR;
   PVR_ERROR returnValue = PVR_ERROR_NO_ERROR;
   std::string stream;
-  std::map<int, std::pair<bool, bool>>::iterator  itr = m_channelDetails.begin();
-  while (itr != m_channelDetails.end())
+  std::vector<ChannelDetail> loaded;
+  std::shared_ptr<const ChannelTable> channelTable = GetChannelTable();
+  if (channelTable)
   {
-    if (itr->second.second == (radio == true))
-      itr = m_channelDetails.erase(itr);
-    else
-      ++itr;
-  }
+    // icons of both halves of the lineup are kept when the icon cache is full
+    std::vector<int> lineup;
+    for (size_t row = 0; row < channelTable->Size(); row++)
+      lineup.push_back(channelTable->GetId(row));
+    m_iconFetcher.SetLineup(lineup);
 
-  tinyxml2::XMLDocument doc;
-  if (ReadCachedChannelList(doc) == tinyxml2::XML_SUCCESS)
-  {
-    tinyxml2::XMLNode* channelsNode = doc.RootElement()->FirstChildElement("channels");
-    tinyxml2::XMLNode* pChannelNode;
-    for( pChannelNode = channelsNode->FirstChildElement("channel"); pChannelNode; pChannelNode=pChannelNode->NextSiblingElement())
+    for (size_t row = 0; row < channelTable->Size(); row++)
     {
       kodi::addon::PVRChannel tag;
-      tag.SetUniqueId(XMLUtils::GetUIntValue(pChannelNode, "id"));
-      std::string buffer;
-      XMLUtils::GetString(pChannelNode, "type", buffer);
-      if ( buffer =="0xa")
+      tag.SetUniqueId(channelTable->GetId(row));
+      if (channelTable->IsRadio(row))
       {
         tag.SetIsRadio(true);
         tag.SetMimeType("application/octet-stream");
@@ -122,7 +120,8 @@ PVR_ERROR Channels::GetChannels(bool radio, kodi::addon::PVRChannelsResultSet& r
         tag.SetMimeType("application/octet-stream");
         if (IsChannelAPlugin(tag.GetUniqueId()))
         {
-          if (kodi::tools::StringUtils::EndsWithNoCase(m_liveStreams[tag.GetUniqueId()], ".m3u8"))
+          GetLiveStream(tag.GetUniqueId(), stream);
+          if (kodi::tools::StringUtils::EndsWithNoCase(stream, ".m3u8"))
             tag.SetMimeType("application/x-mpegURL");
           else
             tag.SetMimeType("video/MP2T");
@@ -131,18 +130,16 @@ PVR_ERROR Channels::GetChannels(bool radio, kodi::addon::PVRChannelsResultSet& r
       if (radio != tag.GetIsRadio())
         continue;
 
-      tag.SetChannelNumber(XMLUtils::GetUIntValue(pChannelNode, "number"));
-      tag.SetSubChannelNumber(XMLUtils::GetUIntValue(pChannelNode, "minor"));
+      tag.SetChannelNumber(channelTable->GetNumber(row));
+      tag.SetSubChannelNumber(channelTable->GetMinor(row));
 
-      buffer.clear();
-      XMLUtils::GetString(pChannelNode, "name", buffer);
+      std::string buffer = channelTable->GetName(row);
       if (m_settings->m_addChannelInstance)
         buffer += kodi::tools::StringUtils::Format(" (%d)", m_settings->m_instanceNumber);
       tag.SetChannelName(buffer);
 
       // check if we need to download a channel icon
-      bool isIcon;
-      if (XMLUtils::GetBoolean(pChannelNode, "icon", isIcon))
+      if (channelTable->HasIcon(row))
       {
         // only set when true;
         std::string iconFile = GetChannelIcon(tag.GetUniqueId());
@@ -150,12 +147,8 @@ PVR_ERROR Channels::GetChannels(bool radio, kodi::addon::PVRChannelsResultSet& r
           tag.SetIconPath(iconFile);
       }
 
-      // V5 has the EPG source type info.
-      std::string epg;
-      if (XMLUtils::GetString(pChannelNode, "epg", epg))
-        m_channelDetails[tag.GetUniqueId()] = std::make_pair(epg == "None", tag.GetIsRadio());
-      else
-        m_channelDetails[tag.GetUniqueId()] = std::make_pair(false, tag.GetIsRadio());
+      loaded.push_back({tag.GetUniqueId(), channelTable->IsEpgNone(row), tag.GetIsRadio(), IsChannelAPlugin(tag.GetUniqueId()),
+                         tag.GetMimeType(), tag.GetIconPath()});
 
       // transfer channel to XBMC
       results.Add(tag);
@@ -165,9 +158,47 @@ PVR_ERROR Channels::GetChannels(bool radio, kodi::addon::PVRChannelsResultSet& r
   {
     returnValue = PVR_ERROR_SERVER_ERROR;
   }
+
+  // keep the other half of the lineup, this call replaces channels of the requested type.  TV and
+  // radio may load at the same time, the lock keeps one from publishing over the other's channels.
+  std::unique_lock<std::mutex> lock(m_channelIndexMutex);
+  std::vector<ChannelDetail> details;
+  for (const ChannelDetail& detail : *GetChannelIndex())
+  {
+    if (detail.radio != radio)
+      details.emplace_back(detail);
+  }
+  details.insert(details.end(), std::make_move_iterator(loaded.begin()), std::make_move_iterator(loaded.end()));
+  std::atomic_store(&m_channelIndex, std::shared_ptr<const ChannelIndex>(std::make_shared<ChannelIndex>(std::move(details))));
   return returnValue;
 }
 
+std::shared_ptr<const ChannelIndex> Channels::GetChannelIndex() const
+{
+  return std::atomic_load(&m_channelIndex);
+}
+
+void Channels::ClearChannelIndex()
+{
+  std::unique_lock<std::mutex> lock(m_channelIndexMutex);
+  std::atomic_store(&m_channelIndex, std::make_shared<const ChannelIndex>());
+}
+
+bool Channels::GetGuideChannels(std::vector<int>& channelUids)
+{
+  channelUids.clear();
+  std::shared_ptr<const ChannelTable> channelTable = GetChannelTable();
+  if (!channelTable)
+    return false;
+  for (size_t row = 0; row < channelTable->Size(); row++)
+  {
+    if (channelTable->IsEpgNone(row) || (channelTable->IsRadio(row) && !m_settings->m_showRadio))
+      continue;
+    channelUids.push_back(channelTable->GetId(row));
+  }
+  return true;
+}
+
 
 /************************************************************/
 /** Channel group handling **/
@@ -182,7 +213,8 @@ PVR_ERROR Channels::GetChannelGroupsAmount(int& amount)
 PVR_RECORDING_CHANNEL_TYPE Channels::GetChannelType(unsigned int uid)
 {
   // when uid is invalid we assume TV because Kodi will
-  if (m_channelDetails.count(uid) > 0 && m_channelDetails[uid].second == true)
+  const ChannelDetail* detail = GetChannelIndex()->Find(uid);
+  if (detail != nullptr && detail->radio)
     return PVR_RECORDING_CHANNEL_TYPE_RADIO;
 
   return PVR_RECORDING_CHANNEL_TYPE_TV;
@@ -200,21 +232,12 @@ PVR_ERROR Channels::GetChannelGroups(bool radio, kodi::addon::PVRChannelGroupsRe
 
   selectedGroups.clear();
   bool hasAllChannels = false;
-  tinyxml2::XMLDocument doc;
-  if (ReadCachedChannelList(doc) == tinyxml2::XML_SUCCESS)
+  std::shared_ptr<const ChannelTable> channelTable = GetChannelTable();
+  if (channelTable)
   {
-    tinyxml2::XMLNode* channelsNode = doc.RootElement()->FirstChildElement("channels");
-    tinyxml2::XMLNode* pChannelNode;
-    for( pChannelNode = channelsNode->FirstChildElement("channel"); pChannelNode; pChannelNode=pChannelNode->NextSiblingElement())
+    for (size_t row = 0; row < channelTable->Size(); row++)
     {
-      std::string buffer;
-      XMLUtils::GetString(pChannelNode, "type", buffer);
-      bool foundRadio = false;
-      if ( buffer == "0xa")
-      {
-        foundRadio = true;
-      }
-      if (radio == foundRadio)
+      if (radio == channelTable->IsRadio(row))
       {
         if (m_settings->m_allChannels && !hasAllChannels)
         {
@@ -226,18 +249,9 @@ PVR_ERROR Channels::GetChannelGroups(bool radio, kodi::addon::PVRChannelGroupsRe
           tag.SetGroupName(allChannels);
           results.Add(tag);
         }
-        buffer.clear();
-        if (XMLUtils::GetAdditiveString(pChannelNode->FirstChildElement("groups"), "group", "\t", buffer, true))
+        for (size_t index = 0; index < channelTable->GetGroupCount(row); index++)
         {
-          std::vector<std::string> groups = kodi::tools::StringUtils::Split(buffer, '\t');
-          XMLUtils::GetString(pChannelNode, "type", buffer);
-          for (auto const& group : groups)
-          {
-            if (selectedGroups.find(group) == selectedGroups.end())
-            {
-              selectedGroups.insert(group);
-            }
-          }
+          selectedGroups.insert(channelTable->GetGroup(row, index));
         }
       }
     }
@@ -251,7 +265,7 @@ PVR_ERROR Channels::GetChannelGroups(bool radio, kodi::addon::PVRChannelGroupsRe
   if (selectedGroups.size() == 0)
     return PVR_ERROR_NO_ERROR;
 
-  doc.Clear();
+  tinyxml2::XMLDocument doc;
   if (m_request.DoMethodRequest("channel.groups", doc) == tinyxml2::XML_SUCCESS)
   {
     tinyxml2::XMLNode* groupsNode = doc.RootElement()->FirstChildElement("groups");
@@ -285,19 +299,42 @@ PVR_ERROR Channels::GetChannelGroupMembers(const kodi::addon::PVRChannelGroup& g
 {
   PVR_ERROR returnValue = PVR_ERROR_SERVER_ERROR;
 
-  tinyxml2::XMLDocument doc;
-  tinyxml2::XMLError retCode;
-  if (group.GetGroupName() == GetAllChannelsGroupName(group.GetIsRadio()))
-  {
-    retCode = ReadCachedChannelList(doc);
-  }
-  else
+  std::shared_ptr<const ChannelTable> channelTable = GetChannelTable();
+  std::shared_ptr<const ChannelIndex> channelIndex = GetChannelIndex();
+  std::vector<size_t> rows;
+  bool allChannels = group.GetGroupName() == GetAllChannelsGroupName(group.GetIsRadio());
+  if (allChannels && !channelTable)
+    return PVR_ERROR_SERVER_ERROR;
+
+  if (allChannels || GetGroupRows(channelTable, group.GetGroupName(), rows))
   {
-    const std::string encodedGroupName = UriEncode(group.GetGroupName());
-    retCode = m_request.DoMethodRequest("channel.list&group_id=" + encodedGroupName, doc);
+    if (allChannels)
+    {
+      rows.resize(channelTable->Size());
+      for (size_t row = 0; row < rows.size(); row++)
+        rows[row] = row;
+    }
+    for (const size_t row : rows)
+    {
+      // ignore orphan channels in groups
+      const ChannelDetail* detail = channelIndex->Find(channelTable->GetId(row));
+      if (detail != nullptr && group.GetIsRadio() == detail->radio)
+      {
+        kodi::addon::PVRChannelGroupMember tag;
+        tag.SetChannelUniqueId(channelTable->GetId(row));
+        tag.SetGroupName(group.GetGroupName());
+        tag.SetChannelNumber(channelTable->GetNumber(row));
+        tag.SetSubChannelNumber(channelTable->GetMinor(row));
+        results.Add(tag);
+      }
+    }
+    return PVR_ERROR_NO_ERROR;
   }
 
-  if (retCode == tinyxml2::XML_SUCCESS)
+  // only reached when the cached lineup came without <groups>
+  tinyxml2::XMLDocument doc;
+  const std::string encodedGroupName = UriEncode(group.GetGroupName());
+  if (m_request.DoMethodRequest("channel.list&group_id=" + encodedGroupName, doc) == tinyxml2::XML_SUCCESS)
   {
     tinyxml2::XMLNode* channelsNode = doc.RootElement()->FirstChildElement("channels");
     tinyxml2::XMLNode* pChannelNode;
@@ -306,8 +343,8 @@ PVR_ERROR Channels::GetChannelGroupMembers(const kodi::addon::PVRChannelGroup& g
       kodi::addon::PVRChannelGroupMember tag;
       tag.SetChannelUniqueId(XMLUtils::GetUIntValue(pChannelNode, "id"));
       // ignore orphan channels in groups
-      if (m_channelDetails.find(tag.GetChannelUniqueId()) != m_channelDetails.end()
-        && group.GetIsRadio() == m_channelDetails[tag.GetChannelUniqueId()].second)
+      const ChannelDetail* detail = channelIndex->Find(tag.GetChannelUniqueId());
+      if (detail != nullptr && group.GetIsRadio() == detail->radio)
       {
         tag.SetGroupName(group.GetGroupName());
         tag.SetChannelNumber(XMLUtils::GetUIntValue(pChannelNode, "number"));
@@ -324,6 +361,45 @@ PVR_ERROR Channels::GetChannelGroupMembers(const kodi::addon::PVRChannelGroup& g
   return returnValue;
 }
 
+bool Channels::GetGroupRows(const std::shared_ptr<const ChannelTable>& channelTable, const std::string& groupName, std::vector<size_t>& rows)
+{
+  if (!channelTable)
+    return false;
+
+  // one pass over the table answers every group until the table is replaced
+  std::unique_lock<std::mutex> lock(m_channelTableMutex);
+  if (m_groupRowsTable.lock() != channelTable)
+  {
+    m_groupRows.clear();
+    m_hasGroupInfo = false;
+    for (size_t row = 0; row < channelTable->Size(); row++)
+    {
+      m_hasGroupInfo |= channelTable->HasGroups(row);
+      for (size_t index = 0; index < channelTable->GetGroupCount(row); index++)
+        m_groupRows[channelTable->GetGroup(row, index)].push_back(row);
+    }
+    m_groupRowsTable = channelTable;
+  }
+  if (!m_hasGroupInfo)
+    return false;
+
+  auto it = m_groupRows.find(groupName);
+  if (it != m_groupRows.end())
+    rows = it->second;
+  return true;
+}
+
+void Channels::GetGroupMembers(const std::string& groupName, std::unordered_set<int>& channelUids)
+{
+  // only the lineup is consulted, a backend without group information has no members
+  std::shared_ptr<const ChannelTable> channelTable = GetChannelTable();
+  std::vector<size_t> rows;
+  if (!GetGroupRows(channelTable, groupName, rows))
+    return;
+  for (const size_t row : rows)
+    channelUids.insert(channelTable->GetId(row));
+}
+
 const std::string Channels::GetAllChannelsGroupName(bool radio)
 {
   std::string allChannels;
@@ -342,24 +418,56 @@ const std::string Channels::GetAllChannelsGroupName(bool radio)
 
 bool Channels::IsChannelAPlugin(int uid)
 {
-  if (m_liveStreams.count(uid) != 0)
-    if (kodi::tools::StringUtils::StartsWith(m_liveStreams[uid], "plugin:") || kodi::tools::StringUtils::EndsWithNoCase(m_liveStreams[uid], ".m3u8"))
+  std::string stream;
+  if (GetLiveStream(uid, stream))
+    if (kodi::tools::StringUtils::StartsWith(stream, "plugin:") || kodi::tools::StringUtils::EndsWithNoCase(stream, ".m3u8"))
       return true;
 
   return false;
 }
 
+bool Channels::GetLiveStream(int uid, std::string& stream) const
+{
+  std::shared_ptr<const LiveStreamMap> liveStreams = std::atomic_load(&m_liveStreams);
+  auto it = liveStreams->find(uid);
+  if (it == liveStreams->end())
+    return false;
+  stream = it->second;
+  return true;
+}
+
+void Channels::ClearLiveStreams()
+{
+  std::atomic_store(&m_liveStreams, std::make_shared<const LiveStreamMap>());
+}
+
 /************************************************************/
 void Channels::LoadLiveStreams()
 {
+  // the copy from the last session is usable straight away while the backend is asked
+  const std::string filename = m_settings->m_instanceDirectory + "livestreams.bin";
+  if (m_liveStreamsHash == 0)
+  {
+    std::shared_ptr<LiveStreamMap> liveStreams = std::make_shared<LiveStreamMap>();
+    if (ReadLiveStreamCache(filename, *liveStreams, m_liveStreamsHash))
+      std::atomic_store(&m_liveStreams, std::shared_ptr<const LiveStreamMap>(liveStreams));
+  }
+
   std::string response;
   const std::string URL = "/public/service.xml";
-  m_liveStreams.clear();
   if (m_request.DoRequest(URL, response) == HTTP_OK)
   {
+    const uint64_t hash = HashBytes(FNV_OFFSET_BASIS, response.data(), response.size());
+    if (hash == m_liveStreamsHash)
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "LiveStreams unchanged %zu", std::atomic_load(&m_liveStreams)->size());
+      return;
+    }
+
     tinyxml2::XMLDocument doc;
     if (doc.Parse(response.c_str()) == tinyxml2::XML_SUCCESS)
     {
+      std::shared_ptr<LiveStreamMap> liveStreams = std::make_shared<LiveStreamMap>();
       tinyxml2::XMLNode* streamsNode = doc.FirstChildElement("streams");
       if (streamsNode)
       {
@@ -367,21 +475,17 @@ void Channels::LoadLiveStreams()
         for (streamNode = streamsNode->FirstChildElement("stream"); streamNode; streamNode = streamNode->NextSiblingElement())
         {
           const char* attrib = streamNode->Attribute("id");
-          if (attrib != nullptr)
+          if (attrib != nullptr && streamNode->FirstChild() != nullptr)
           {
-            try
-            {
-              int channelID = std::atoi(attrib);
-              kodi::Log(ADDON_LOG_DEBUG, "%d %s", channelID, streamNode->FirstChild()->Value());
-              m_liveStreams[channelID] = streamNode->FirstChild()->Value();
-            }
-            catch (...)
-            {
-              kodi::Log(ADDON_LOG_DEBUG, "%s:%d", __FUNCTION__, __LINE__);
-            }
+            int channelID = std::atoi(attrib);
+            (*liveStreams)[channelID] = streamNode->FirstChild()->Value();
           }
         }
       }
+      kodi::Log(ADDON_LOG_DEBUG, "LiveStreams loaded %zu", liveStreams->size());
+      std::atomic_store(&m_liveStreams, std::shared_ptr<const LiveStreamMap>(liveStreams));
+      m_liveStreamsHash = hash;
+      WriteLiveStreamCache(filename, *liveStreams, hash);
     }
     else
     {
@@ -389,50 +493,227 @@ void Channels::LoadLiveStreams()
     }
   }
 }
+
+bool Channels::ReadLiveStreamCache(const std::string& filename, LiveStreamMap& liveStreams, uint64_t& hash)
+{
+  kodi::vfs::CFile file;
+  if (!file.OpenFile(filename, ADDON_READ_NO_CACHE))
+    return false;
+
+  std::string data;
+  char buffer[16 * 1024];
+  ssize_t count;
+  while ((count = file.Read(buffer, sizeof(buffer))) > 0)
+    data.append(buffer, count);
+  file.Close();
+
+  LiveStreamHeader header;
+  if (data.size() < sizeof(header))
+    return false;
+  memcpy(&header, data.data(), sizeof(header));
+  if (memcmp(header.magic, LIVE_STREAM_MAGIC, sizeof(header.magic)) != 0 || header.version != LIVE_STREAM_VERSION ||
+      header.byteOrder != CHANNEL_TABLE_BYTE_ORDER)
+    return false;
+
+  size_t offset = sizeof(header);
+  for (uint32_t entry = 0; entry < header.count; entry++)
+  {
+    int32_t channelID;
+    uint32_t length;
+    if (data.size() - offset < sizeof(channelID) + sizeof(length))
+      return false;
+    memcpy(&channelID, data.data() + offset, sizeof(channelID));
+    memcpy(&length, data.data() + offset + sizeof(channelID), sizeof(length));
+    offset += sizeof(channelID) + sizeof(length);
+    if (data.size() - offset < length)
+      return false;
+    liveStreams[channelID].assign(data.data() + offset, length);
+    offset += length;
+  }
+  hash = header.hash;
+  return true;
+}
+
+bool Channels::WriteLiveStreamCache(const std::string& filename, const LiveStreamMap& liveStreams, uint64_t hash)
+{
+  LiveStreamHeader header{};
+  memcpy(header.magic, LIVE_STREAM_MAGIC, sizeof(header.magic));
+  header.version = LIVE_STREAM_VERSION;
+  header.byteOrder = CHANNEL_TABLE_BYTE_ORDER;
+  header.hash = hash;
+  header.count = static_cast<uint32_t>(liveStreams.size());
+
+  std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const auto& stream : liveStreams)
+  {
+    const int32_t channelID = stream.first;
+    const uint32_t length = static_cast<uint32_t>(stream.second.length());
+    data.append(reinterpret_cast<const char*>(&channelID), sizeof(channelID));
+    data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    data.append(stream.second);
+  }
+
+  // a reader at startup must find the old cache or the new one, never half of it
+  const std::string tempFile = filename + ".tmp";
+  kodi::vfs::CFile file;
+  if (!file.OpenFileForWrite(tempFile, true))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot write %s", tempFile.c_str());
+    return false;
+  }
+  const bool written = file.Write(data.data(), data.size()) == static_cast<ssize_t>(data.size());
+  file.Close();
+  if (!written || !kodi::vfs::RenameFile(tempFile, filename))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot replace %s", filename.c_str());
+    kodi::vfs::DeleteFile(tempFile);
+    return false;
+  }
+  return true;
+}
+
 bool Channels::CacheAllChannels(time_t updateTime)
+{
+  const time_t tableUpdate = updateTime - m_settings->m_serverTimeOffset;
+  {
+    std::unique_lock<std::mutex> lock(m_channelTableMutex);
+    if (!m_channelTable)
+      m_channelTable = LoadChannelTable();
+    if (m_channelTable && m_channelTable->GetUpdateTime() == tableUpdate)
+      return true;
+  }
+
+  ChannelDiff diff;
+  if (!DownloadChannelTable(tableUpdate, diff))
+    return false;
+
+  // logos may have changed with the lineup
+  m_iconFetcher.Revalidate(tableUpdate);
+  return true;
+}
+
+bool Channels::RefreshChannels(ChannelDiff& diff)
+{
+  time_t tableUpdate = 0;
+  {
+    std::unique_lock<std::mutex> lock(m_channelTableMutex);
+    if (!m_channelTable)
+      m_channelTable = LoadChannelTable();
+    if (m_channelTable)
+      tableUpdate = m_channelTable->GetUpdateTime();
+  }
+
+  if (!DownloadChannelTable(tableUpdate, diff))
+    return false;
+
+  // the backend gained or lost a logo, drop ours so the next channel load asks again
+  for (const unsigned int uid : diff.iconChangedUids)
+    DeleteChannelIcon(uid);
+  return true;
+}
+
+bool Channels::DownloadChannelTable(time_t tableUpdate, ChannelDiff& diff)
 {
   std::string response;
-  const std::string filename = kodi::tools::StringUtils::Format("%s%s", m_settings->m_instanceDirectory.c_str(), "channel.cache");
-  gzFile gz_file;
-  struct { time_t update; unsigned long size; } header{0,0};
-  if (kodi::vfs::FileExists(filename))
+  if (m_request.DoRequest("/service?method=channel.list&extras=true", response) != HTTP_OK)
+    return false;
+
+  // the lineup is in memory already, build the table from it instead of reading the file back
+  std::shared_ptr<ChannelTable> channelTable = std::make_shared<ChannelTable>();
+  const bool parsed = channelTable->Parse(response.data(), response.size(), tableUpdate);
+  std::unique_lock<std::mutex> lock(m_channelTableMutex);
+  if (!parsed)
   {
-    gz_file = gzopen(kodi::vfs::TranslateSpecialProtocol(filename).c_str(), "rb");
-    gzread(gz_file, (void*)&header, sizeof(header));
-    gzclose(gz_file);
-    if (updateTime == header.update)
+    kodi::Log(ADDON_LOG_ERROR, "Channel list could not be parsed");
+    m_channelTable.reset();
+    return false;
+  }
+
+  if (m_channelTable)
+  {
+    diff = ChannelTable::Diff(*m_channelTable, *channelTable);
+    if (m_channelTable->GetUpdateTime() == tableUpdate && m_channelTable->GetLineupHash() == channelTable->GetLineupHash())
     {
+      kodi::Log(ADDON_LOG_DEBUG, "Channel list unchanged");
       return true;
     }
   }
-  if (m_request.DoRequest("/service?method=channel.list&extras=true", response) == HTTP_OK)
+  else
   {
-    gz_file = gzopen(kodi::vfs::TranslateSpecialProtocol(filename).c_str(), "wb");
-    header.size = sizeof(char) * response.size();
-    header.update = updateTime - m_settings->m_serverTimeOffset;
-    gzwrite(gz_file, (void*)&header, sizeof(header));
-    gzwrite(gz_file, (void*)(response.c_str()), header.size);
-    gzclose(gz_file);
-    return true;
+    diff.added = static_cast<int>(channelTable->Size());
   }
-  return false;
+  kodi::Log(ADDON_LOG_DEBUG, "Channel list added %d removed %d renamed %d renumbered %d icons %d other %d groups %d", diff.added,
+            diff.removed, diff.renamed, diff.renumbered, diff.iconChanged, diff.otherChanged, diff.groupsChanged);
+
+  // drop the old mapping before replacing the file it maps
+  m_channelTable = channelTable;
+  channelTable->Save(GetChannelTableFileName());
+  return true;
 }
 
-tinyxml2::XMLError Channels::ReadCachedChannelList(tinyxml2::XMLDocument& doc)
+std::string Channels::GetChannelTableFileName()
 {
-  auto start = std::chrono::steady_clock::now();
+  return kodi::tools::StringUtils::Format("%s%s", m_settings->m_instanceDirectory.c_str(), "channel.bin");
+}
+
+std::shared_ptr<const ChannelTable> Channels::GetChannelTable()
+{
+  // built once per channel.bin update, every channel and group call after that shares it
+  {
+    std::unique_lock<std::mutex> lock(m_channelTableMutex);
+    if (!m_channelTable)
+      m_channelTable = LoadChannelTable();
+    if (m_channelTable)
+      return m_channelTable;
+  }
+
+  // asked without the lock so channel and group calls are not held up behind the backend
+  kodi::Log(ADDON_LOG_DEBUG, "No cached channel table, asking backend");
   std::string response;
-  const std::string filename = kodi::tools::StringUtils::Format("%s%s", m_settings->m_instanceDirectory.c_str(), "channel.cache");
-  struct { time_t update; unsigned long size; } header{0,0};
-  gzFile gz_file = gzopen(kodi::vfs::TranslateSpecialProtocol(filename).c_str(), "rb");
-  gzread(gz_file, (void*)&header, sizeof(header));
-  response.resize(header.size / sizeof(char));
-  gzread(gz_file, (void*)response.data(), header.size);
-  gzclose(gz_file);
-  tinyxml2::XMLError xmlCheck = doc.Parse(response.c_str());
-  if (doc.Parse(response.c_str()) != tinyxml2::XML_SUCCESS)
-    return m_request.DoMethodRequest("channel.list&extras=true", doc);
+  std::shared_ptr<ChannelTable> channelTable = std::make_shared<ChannelTable>();
+  const bool parsed = m_request.DoRequest("/service?method=channel.list&extras=true", response) == HTTP_OK &&
+                      channelTable->Parse(response.data(), response.size(), 0);
+  std::unique_lock<std::mutex> lock(m_channelTableMutex);
+  // a download that finished first has a real update time, keep it
+  if (!m_channelTable && parsed)
+    m_channelTable = channelTable;
+  return m_channelTable;
+}
+
+std::shared_ptr<const ChannelTable> Channels::LoadChannelTable()
+{
+  auto start = std::chrono::steady_clock::now();
+  std::shared_ptr<ChannelTable> channelTable = std::make_shared<ChannelTable>();
+  bool loaded = channelTable->Load(GetChannelTableFileName());
+  if (!loaded)
+  {
+    // upgrade the gzipped XML cache written by earlier versions
+    const std::string filename = kodi::tools::StringUtils::Format("%s%s", m_settings->m_instanceDirectory.c_str(), "channel.cache");
+    if (kodi::vfs::FileExists(filename))
+    {
+      std::string response;
+      struct { time_t update; unsigned long size; } header{0,0};
+      gzFile gz_file = gzopen(kodi::vfs::TranslateSpecialProtocol(filename).c_str(), "rb");
+      if (gz_file != nullptr)
+      {
+        if (gzread(gz_file, (void*)&header, sizeof(header)) == sizeof(header))
+        {
+          response.resize(header.size / sizeof(char));
+          if (gzread(gz_file, (void*)response.data(), header.size) != static_cast<int>(header.size))
+            response.clear();
+        }
+        gzclose(gz_file);
+      }
+      loaded = channelTable->Parse(response.data(), response.size(), header.update);
+      if (loaded)
+        channelTable->Save(GetChannelTableFileName());
+      kodi::Log(ADDON_LOG_INFO, "Upgraded channel.cache %d", loaded);
+      kodi::vfs::DeleteFile(filename);
+    }
+  }
   int milliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
-  kodi::Log(ADDON_LOG_DEBUG, "ReadCachedChannelList %d %d %d %d", m_settings->m_instanceNumber, xmlCheck, response.length(), milliseconds);
-  return xmlCheck;
+  kodi::Log(ADDON_LOG_DEBUG, "LoadChannelTable %d %d %zu %d", m_settings->m_instanceNumber, loaded, channelTable->Size(), milliseconds);
+  if (!loaded)
+    return nullptr;
+  return channelTable;
 }
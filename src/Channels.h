@@ -9,8 +9,15 @@
 #pragma once
 
 #include "BackendRequest.h"
+#include "ChannelIndex.h"
+#include "ChannelTable.h"
+#include "IconFetcher.h"
 #include <kodi/addon-instance/PVR.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace NextPVR
 {
@@ -20,12 +27,13 @@ namespace NextPVR
 
   public:
 
-    Channels(const std::shared_ptr<InstanceSettings>& settings, Request& request);
+    Channels(const std::shared_ptr<InstanceSettings>& settings, Request& request, cPVRClientNextPVR& pvrclient);
 
     /* Channel handling */
     int GetNumChannels();
 
     bool CacheAllChannels(time_t updateTime);
+    bool RefreshChannels(ChannelDiff& diff);
 
     PVR_ERROR GetChannels(bool radio, kodi::addon::PVRChannelsResultSet& results);
     /* Channel group handling */
@@ -33,26 +41,69 @@ namespace NextPVR
     PVR_ERROR GetChannelGroups(bool radio, kodi::addon::PVRChannelGroupsResultSet& results);
     PVR_ERROR GetChannelGroupMembers(const kodi::addon::PVRChannelGroup& group, kodi::addon::PVRChannelGroupMembersResultSet& results);
     const std::string GetAllChannelsGroupName(bool radio);
+    void GetGroupMembers(const std::string& groupName, std::unordered_set<int>& channelUids);
     bool IsChannelAPlugin(int uid);
     void LoadLiveStreams();
-    std::map<int, std::string> m_liveStreams;
+    bool GetLiveStream(int uid, std::string& stream) const;
+    void ClearLiveStreams();
     std::string GetChannelIconFileName(int channelID);
     void DeleteChannelIcon(int channelID);
     void DeleteChannelIcons();
     PVR_RECORDING_CHANNEL_TYPE GetChannelType(unsigned int uid);
-    std::map<int, std::pair<bool, bool>> m_channelDetails;
+    std::shared_ptr<const ChannelIndex> GetChannelIndex() const;
+    /*
+     * The channels Kodi is given that have a guide source, read from the
+     * channel table so the answer does not wait for Kodi to load channels.
+     * Returns false when there is no channel table.
+     */
+    bool GetGuideChannels(std::vector<int>& channelUids);
+    void StopIconFetcher() { m_iconFetcher.Stop(); };
+    void ClearChannelIndex();
     std::unordered_set<std::string> m_tvGroups;
     std::unordered_set<std::string> m_radioGroups;
 
   private:
     Channels() = default;
 
+    typedef std::map<int, std::string> LiveStreamMap;
+
+    /* livestreams.bin, followed by count entries of channel id, length and URL */
+    struct LiveStreamHeader
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t byteOrder;
+      uint64_t hash;
+      uint32_t count;
+      uint32_t reserved;
+    };
+
     Channels(Channels const&) = delete;
     void operator=(Channels const&) = delete;
 
     std::string GetChannelIcon(int channelID);
     const std::shared_ptr<InstanceSettings> m_settings;
     Request& m_request;
-    tinyxml2::XMLError ReadCachedChannelList(tinyxml2::XMLDocument& doc);
+    cPVRClientNextPVR& m_pvrclient;
+    IconFetcher m_iconFetcher;
+    std::shared_ptr<const ChannelTable> GetChannelTable();
+    std::shared_ptr<const ChannelTable> LoadChannelTable();
+    bool DownloadChannelTable(time_t tableUpdate, ChannelDiff& diff);
+    bool ReadLiveStreamCache(const std::string& filename, LiveStreamMap& liveStreams, uint64_t& hash);
+    bool WriteLiveStreamCache(const std::string& filename, const LiveStreamMap& liveStreams, uint64_t hash);
+    std::string GetChannelTableFileName();
+    bool GetGroupRows(const std::shared_ptr<const ChannelTable>& channelTable, const std::string& groupName, std::vector<size_t>& rows);
+    std::mutex m_channelTableMutex;
+    std::shared_ptr<const ChannelTable> m_channelTable;
+    std::weak_ptr<const ChannelTable> m_groupRowsTable;
+    std::unordered_map<std::string, std::vector<size_t>> m_groupRows;
+    bool m_hasGroupInfo = false;
+    // replaced whole with std::atomic_store, read with std::atomic_load
+    std::shared_ptr<const ChannelIndex> m_channelIndex;
+    // held while an index is built from the current one, readers only use the atomic load
+    std::mutex m_channelIndexMutex;
+    // replaced whole like m_channelIndex, the hash is of the service.xml it came from
+    std::shared_ptr<const LiveStreamMap> m_liveStreams;
+    uint64_t m_liveStreamsHash = 0;
   };
 } // namespace NextPVR
@@ -8,30 +8,88 @@
 #include "EPG.h"
 
 #include "pvrclient-nextpvr.h"
+#include <kodi/tools/StringUtils.h>
+#include "utilities/FieldScanners.h"
+#include "utilities/Metrics.h"
+#include "utilities/StringPool.h"
+#include "utilities/XMLRecordFields.h"
 #include "utilities/XMLUtils.h"
 
-#include <kodi/tools/StringUtils.h>
-#include <regex>
+#include <algorithm>
 
 using namespace NextPVR;
 using namespace NextPVR::utilities;
 
+namespace
+{
+// Kodi keeps a day of history by default, the margin ahead covers its longest
+// common look ahead plus a day of drift before the next guide update
+constexpr time_t PREFETCH_PAST_SECONDS = 24 * 3600 + 3600;
+constexpr time_t PREFETCH_AHEAD_SECONDS = 8 * 24 * 3600;
+// a stored guide reaching this close to the prefetch window is not extended yet
+constexpr time_t PREFETCH_AHEAD_SLACK_SECONDS = 24 * 3600;
+
+enum eListingField
+{
+  ListingName = 0,
+  ListingDescription,
+  ListingSubtitle,
+  ListingStart,
+  ListingEnd,
+  ListingGenre,
+  ListingGenreType,
+  ListingGenreSubtype,
+  ListingGenres,
+  ListingSeason,
+  ListingEpisode,
+  ListingYear,
+  ListingOriginal,
+  ListingFirstrun,
+  ListingSignificance,
+  ListingCast,
+  ListingCrew,
+  ListingStarRating,
+  LISTING_FIELDS
+};
+
+constexpr auto LISTING_TABLE = MakeFieldTable("name", "description", "subtitle", "start", "end", "genre", "genre_type",
+                                               "genre_subtype", "genres", "season", "episode", "year", "original", "firstrun",
+                                               "significance", "cast", "crew", "star_rating");
+static_assert(LISTING_TABLE.names.size() == LISTING_FIELDS, "every listing field needs a name");
+} // unnamed namespace
+
 /************************************************************/
 /** EPG handling */
 
-EPG::EPG(const std::shared_ptr<InstanceSettings>& settings, Request& request, Recordings& recordings, Channels& channels) :
+EPG::EPG(const std::shared_ptr<InstanceSettings>& settings, Request& request, Recordings& recordings, Channels& channels, cPVRClientNextPVR& pvrclient) :
   m_settings(settings),
   m_request(request),
   m_recordings(recordings),
-  m_channels(channels)
+  m_channels(channels),
+  m_pvrclient(pvrclient),
+  m_updateScheduler(settings, channels, pvrclient)
 {
 }
 
+EPG::~EPG()
+{
+  Stop();
+}
+
+void EPG::Stop()
+{
+  m_stopping = true;
+  if (m_prefetchThread.joinable())
+    m_prefetchThread.join();
+  m_updateScheduler.Stop();
+  m_stopping = false;
+}
+
 PVR_ERROR EPG::GetEPGForChannel(int channelUid, time_t start, time_t end, kodi::addon::PVREPGTagsResultSet& results)
 {
-  std::pair<bool, bool> channelDetail;
-  channelDetail = m_channels.m_channelDetails[channelUid];
-  if (channelDetail.first == true)
+  std::shared_ptr<const ChannelIndex> channelIndex = m_channels.GetChannelIndex();
+  const ChannelDetail* channelDetail = channelIndex->Find(channelUid);
+  if (channelDetail != nullptr && channelDetail->epgNone)
   {
     kodi::Log(ADDON_LOG_DEBUG, "Skipping %d", channelUid);
     return PVR_ERROR_NO_ERROR;
@@ -42,239 +100,479 @@ PVR_ERROR EPG::GetEPGForChannel(int channelUid, time_t start, time_t end, kodi::
     kodi::Log(ADDON_LOG_DEBUG, "Skipping expired EPG data %d %ld %lld", channelUid, start, end);
     return PVR_ERROR_INVALID_PARAMETERS;
   }
+
+  if (m_settings->m_guidePrefetch)
+  {
+    std::vector<EpgEvent> events;
+    std::shared_ptr<const StringPool> strings;
+    {
+      std::unique_lock<std::mutex> lock(m_prefetchMutex);
+      m_prefetched.wait(lock, [&] { return m_prefetchPending.count(channelUid) == 0; });
+    }
+    if (m_guideStore.Get(channelUid, start, end, events, strings))
+    {
+      for (const EpgEvent& event : events)
+      {
+        kodi::addon::PVREPGTag broadcast;
+        FillEPGTag(event, channelUid, broadcast);
+        results.Add(broadcast);
+      }
+      return PVR_ERROR_NO_ERROR;
+    }
+    kodi::Log(ADDON_LOG_DEBUG, "Guide store does not cover %d %lld %lld", channelUid, static_cast<long long>(start), static_cast<long long>(end));
+  }
+
+  // each listing is added as soon as it has downloaded
+  StringPool strings;
+  m_request.DoMethodRequest(GetListingsRequest(channelUid, start, end), "l", [&](tinyxml2::XMLElement* pListingNode)
+  {
+    EpgEvent event;
+    ParseListing(pListingNode, strings, event);
+    kodi::addon::PVREPGTag broadcast;
+    FillEPGTag(event, channelUid, broadcast);
+    results.Add(broadcast);
+  });
+
+  return PVR_ERROR_NO_ERROR;
+}
+
+std::string EPG::GetListingsRequest(int channelUid, time_t start, time_t end) const
+{
   std::string request = kodi::tools::StringUtils::Format("channel.listings&channel_id=%d&start=%d&end=%d&genre=all", channelUid, static_cast<int>(start), static_cast<int>(end));
   if (m_settings->m_castcrew)
     request.append("&extras=true");
+  return request;
+}
+
+void EPG::StartPrefetch(time_t lastUpdate)
+{
+  if (!m_settings->m_guidePrefetch)
+    return;
 
-  tinyxml2::XMLDocument doc;
+  // the lineup comes from the channel table, Kodi may not have asked for channels yet
+  std::vector<int> channelUids;
+  if (!m_channels.GetGuideChannels(channelUids))
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "No channel table, guide prefetch not started");
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(m_prefetchMutex);
+  m_prefetchUpdate = lastUpdate;
+  if (m_prefetchRunning)
+  {
+    // the running pass may already have read the channels that changed
+    m_prefetchAgain = true;
+    return;
+  }
+  m_prefetchRunning = true;
+  QueuePrefetchLocked(std::move(channelUids));
+  lock.unlock();
+
+  if (m_prefetchThread.joinable())
+    m_prefetchThread.join();
+  m_prefetchThread = std::thread(&EPG::PrefetchThread, this);
+}
+
+void EPG::QueuePrefetchLocked(std::vector<int>&& channelUids)
+{
+  m_prefetchChannels = std::move(channelUids);
+  m_prefetchPending.insert(m_prefetchChannels.begin(), m_prefetchChannels.end());
+}
 
-  if (m_request.DoMethodRequest(request, doc) == tinyxml2::XML_SUCCESS)
+void EPG::PrefetchThread()
+{
+  while (true)
   {
-    tinyxml2::XMLNode* listingsNode = doc.RootElement()->FirstChildElement("listings");
-    for (tinyxml2::XMLNode* pListingNode = listingsNode->FirstChildElement("l"); pListingNode; pListingNode = pListingNode->NextSiblingElement())
+    Prefetch();
+
     {
-      kodi::addon::PVREPGTag broadcast;
-      std::string title;
-      std::string description;
-      std::string subtitle;
-      XMLUtils::GetString(pListingNode, "name", title);
-      XMLUtils::GetString(pListingNode, "description", description);
-
-      if (XMLUtils::GetString(pListingNode, "subtitle", subtitle))
+      std::unique_lock<std::mutex> lock(m_prefetchMutex);
+      m_prefetchPending.clear();
+      m_prefetched.notify_all();
+      if (!m_prefetchAgain || m_stopping)
       {
-        if (description != subtitle + ":" && kodi::tools::StringUtils::StartsWith(description, subtitle + ": "))
-        {
-          description = description.substr(subtitle.length() + 2);
-        }
+        m_prefetchRunning = false;
+        return;
       }
+      m_prefetchAgain = false;
+    }
 
-      std::string startTime;
-      std::string endTime;
-      XMLUtils::GetString(pListingNode, "start", startTime);
-      startTime.resize(10);
-      XMLUtils::GetString(pListingNode, "end", endTime);
-      endTime.resize(10);
+    // read outside the lock, the channel table may have to come from the backend
+    std::vector<int> channelUids;
+    m_channels.GetGuideChannels(channelUids);
+    std::unique_lock<std::mutex> lock(m_prefetchMutex);
+    QueuePrefetchLocked(std::move(channelUids));
+  }
+}
 
-      const std::string oidLookup(endTime + ":" + std::to_string(channelUid));
+void EPG::Prefetch()
+{
+  ScopedPhase phase(m_request.GetMetrics(), "GuidePrefetch");
+  const time_t now = time(nullptr);
+  const time_t from = now - PREFETCH_PAST_SECONDS;
+  const time_t to = now + PREFETCH_AHEAD_SECONDS;
+  const uint32_t settings = GetGuideSettings();
+  time_t lastUpdate;
+  {
+    std::unique_lock<std::mutex> lock(m_prefetchMutex);
+    lastUpdate = m_prefetchUpdate;
+  }
 
-      broadcast.SetTitle(title);
-      broadcast.SetUniqueChannelId(channelUid);
-      broadcast.SetStartTime(stol(startTime));
-      broadcast.SetUniqueBroadcastId(stoi(endTime));
-      broadcast.SetEndTime(stol(endTime));
-      broadcast.SetPlot(description);
+  if (!m_guideLoaded)
+  {
+    m_guideLoaded = true;
+    time_t savedUpdate;
+    if (m_guideStore.Load(GetGuideFileName(), settings, from, savedUpdate))
+    {
+      m_guideUpdate = savedUpdate;
+      m_guideSettings = settings;
+      kodi::Log(ADDON_LOG_DEBUG, "Loaded guide for %zu channels, %zu events", m_guideStore.Channels(), m_guideStore.Events());
+    }
+  }
+  else
+  {
+    m_guideStore.Trim(from);
+  }
+  // the loaded guide answers Kodi until there is a lineup to refresh and prune it against
+  if (m_prefetchChannels.empty())
+    return;
+
+  // an unchanged guide only needs the channels and days it does not hold yet
+  struct PrefetchJob
+  {
+    int channelUid;
+    time_t start;
+    bool extend;
+  };
+  const bool stale = m_guideUpdate != lastUpdate || m_guideSettings != settings;
+  std::vector<PrefetchJob> jobs;
+  std::vector<int> current;
+  for (const int channelUid : m_prefetchChannels)
+  {
+    time_t storedFrom, storedTo;
+    if (stale || !m_guideStore.GetCoverage(channelUid, storedFrom, storedTo) || storedTo <= from)
+      jobs.push_back({channelUid, from, false});
+    else if (storedTo < to - PREFETCH_AHEAD_SLACK_SECONDS)
+      jobs.push_back({channelUid, storedTo, true});
+    else
+      current.push_back(channelUid);
+  }
+  {
+    std::unique_lock<std::mutex> lock(m_prefetchMutex);
+    for (const int channelUid : current)
+      m_prefetchPending.erase(channelUid);
+  }
+  m_prefetched.notify_all();
 
-      std::string artworkPath;
-      if (m_settings->m_downloadGuideArtwork)
+  // Only the running pass touches m_prefetchChannels, no lock is needed to read it.
+  // There is no multi-channel listings method, so the per-channel requests are
+  // pipelined instead and Request keeps them in the bulk lane.
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> events{0};
+  std::atomic<int> failed{0};
+  std::vector<int> changedChannels;
+  // genres and cast lists repeat across channels as well as days, each worker
+  // interns into a pool of its own so the workers never wait on each other
+  auto worker = [&](const std::shared_ptr<StringPool>& strings)
+  {
+    size_t index;
+    while (!m_stopping && (index = next++) < jobs.size())
+    {
+      const PrefetchJob& job = jobs[index];
+      std::vector<EpgEvent> listings;
+      const tinyxml2::XMLError result = m_request.DoMethodRequest(GetListingsRequest(job.channelUid, job.start, to), "l", [&](tinyxml2::XMLElement* pListingNode)
       {
-        if (m_settings->m_sendSidWithMetadata)
-          artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&sid=%s&name=%s", m_settings->m_urlBase, m_request.GetSID(), UriEncode(title).c_str());
-        else
-          artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&name=%s", m_settings->m_urlBase, UriEncode(title).c_str());
+        EpgEvent event;
+        ParseListing(pListingNode, *strings, event);
+        listings.push_back(std::move(event));
+      });
 
-        if (m_settings->m_guideArtPortrait)
-          artworkPath += "&prefer=poster";
-        else
-          artworkPath += "&prefer=landscape";
-        broadcast.SetIconPath(artworkPath);
-      }
-      std::string sGenre;
-      if (XMLUtils::GetString(pListingNode, "genre", sGenre))
+      bool changed = false;
+      if (result == tinyxml2::XML_SUCCESS)
       {
-        broadcast.SetGenreDescription(sGenre);
-        broadcast.SetGenreType(EPG_GENRE_USE_STRING);
+        events += listings.size();
+        if (job.extend)
+          m_guideStore.Extend(job.channelUid, job.start, to, std::move(listings), strings);
+        else
+          changed = m_guideStore.Replace(job.channelUid, from, to, std::move(listings), strings);
       }
       else
       {
-        // genre type
-        broadcast.SetGenreType(XMLUtils::GetIntValue(pListingNode, "genre_type"));
-        broadcast.SetGenreSubType(XMLUtils::GetIntValue(pListingNode, "genre_subtype"));
-
+        // the channel goes back to per-request downloads, and Kodi to the backend for it
+        m_guideStore.Erase(job.channelUid);
+        changed = true;
+        failed++;
       }
-      std::string allGenres;
-      if (XMLUtils::GetAdditiveString(pListingNode->FirstChildElement("genres"), "genre", EPG_STRING_TOKEN_SEPARATOR, allGenres, true))
-      {
-        if (allGenres.find(EPG_STRING_TOKEN_SEPARATOR) != std::string::npos)
-        {
-          if (broadcast.GetGenreType() != EPG_GENRE_USE_STRING)
-          {
-            broadcast.SetGenreSubType(EPG_GENRE_USE_STRING);
-          }
-          broadcast.SetGenreDescription(allGenres);
-        }
-        else if (m_settings->m_genreString && broadcast.GetGenreSubType() != EPG_GENRE_USE_STRING)
-        {
-          broadcast.SetGenreDescription(allGenres);
-          broadcast.SetGenreSubType(EPG_GENRE_USE_STRING);
-        }
 
-      }
+      std::unique_lock<std::mutex> lock(m_prefetchMutex);
+      m_prefetchPending.erase(job.channelUid);
+      if (changed)
+        changedChannels.push_back(job.channelUid);
+      m_prefetched.notify_all();
+    }
+  };
+
+  const size_t workers = std::max(static_cast<size_t>(1), std::min(jobs.size(), static_cast<size_t>(std::max(1, m_settings->m_backendConcurrency))));
+  std::vector<std::shared_ptr<StringPool>> pools;
+  for (size_t i = 0; i < workers; i++)
+    pools.push_back(std::make_shared<StringPool>());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < workers; i++)
+    threads.emplace_back(worker, pools[i]);
+  worker(pools[0]);
+  for (std::thread& thread : threads)
+    thread.join();
 
-      int season{EPG_TAG_INVALID_SERIES_EPISODE};
-      int episode{EPG_TAG_INVALID_SERIES_EPISODE};
-      XMLUtils::GetInt(pListingNode, "season", season);
-      XMLUtils::GetInt(pListingNode, "episode", episode);
-      broadcast.SetEpisodeNumber(episode);
-      broadcast.SetEpisodePartNumber(EPG_TAG_INVALID_SERIES_EPISODE);
-      // Backend could send episode only as S00 and parts are not supported
-      if (season <= 0 || episode == EPG_TAG_INVALID_SERIES_EPISODE)
+  kodi::Log(ADDON_LOG_INFO, "Prefetched guide for %zu of %zu channels, %zu events, %d failed, %zu changed", jobs.size(),
+            m_prefetchChannels.size(), static_cast<size_t>(events), static_cast<int>(failed), changedChannels.size());
+  for (size_t i = 0; i < pools.size(); i++)
+    kodi::Log(ADDON_LOG_DEBUG, "Guide strings worker %zu %s", i, pools[i]->GetStats().c_str());
+
+  // channels that were not held before are left to Kodi's own schedule
+  if (!m_stopping && !changedChannels.empty())
+    m_updateScheduler.Queue(changedChannels);
+
+  // a pass cut short would tag listings it never refreshed with the new update
+  if (m_stopping || next < jobs.size())
+    return;
+  // channels dropped from the lineup or set to no guide are not kept
+  m_guideStore.Retain(m_prefetchChannels);
+  m_guideUpdate = lastUpdate;
+  m_guideSettings = settings;
+  if (!jobs.empty() || stale)
+    m_guideStore.Save(GetGuideFileName(), lastUpdate, settings);
+}
+
+std::string EPG::GetGuideFileName() const
+{
+  return m_settings->m_instanceDirectory + "guide.bin";
+}
+
+uint32_t EPG::GetGuideSettings() const
+{
+  // the settings ParseListing reads, a saved guide parsed under others is refetched
+  return (m_settings->m_castcrew ? 0x01 : 0) | (m_settings->m_genreString ? 0x02 : 0) | (m_settings->m_showNew ? 0x04 : 0);
+}
+
+void EPG::ParseListing(const tinyxml2::XMLNode* pListingNode, StringPool& strings, EpgEvent& event)
+{
+  // every field below comes from one walk over the listing's children
+  const XMLRecordFields<LISTING_FIELDS> fields(pListingNode, LISTING_TABLE);
+  std::string_view title;
+  std::string description;
+  std::string subtitle;
+  fields.GetView(ListingName, title);
+  fields.GetString(ListingDescription, description);
+
+  if (fields.GetString(ListingSubtitle, subtitle))
+  {
+    if (description != subtitle + ":" && kodi::tools::StringUtils::StartsWith(description, subtitle + ": "))
+    {
+      description = description.substr(subtitle.length() + 2);
+    }
+  }
+
+  event.title = strings.Intern(title);
+  event.start = fields.GetTime(ListingStart);
+  event.end = fields.GetTime(ListingEnd);
+  event.broadcastId = static_cast<unsigned int>(event.end);
+  event.plot = description;
+
+  std::string_view sGenre;
+  if (fields.GetView(ListingGenre, sGenre))
+  {
+    event.genreDescription = strings.Intern(sGenre);
+    event.genreType = EPG_GENRE_USE_STRING;
+  }
+  else
+  {
+    // genre type
+    event.genreType = fields.GetIntValue(ListingGenreType);
+    event.genreSubType = fields.GetIntValue(ListingGenreSubtype);
+
+  }
+  std::string allGenres;
+  if (XMLUtils::GetAdditiveString(fields.Element(ListingGenres), "genre", EPG_STRING_TOKEN_SEPARATOR, allGenres, true))
+  {
+    if (allGenres.find(EPG_STRING_TOKEN_SEPARATOR) != std::string::npos)
+    {
+      if (event.genreType != EPG_GENRE_USE_STRING)
       {
-        static std::regex base_regex("^.*\\([eE][pP](\\d+)(?:/?(\\d+))?\\)");
-        std::smatch base_match;
-        if (std::regex_search(description, base_match, base_regex))
-        {
-          broadcast.SetEpisodeNumber(std::atoi(base_match[1].str().c_str()));
-          if (base_match[2].matched)
-            broadcast.SetEpisodePartNumber(std::atoi(base_match[2].str().c_str()));
-        }
-        else if (std::regex_search(description, base_match, std::regex("^([1-9]\\d*)/([1-9]\\d*)\\.")))
-        {
-          broadcast.SetEpisodeNumber(std::atoi(base_match[1].str().c_str()));
-          broadcast.SetEpisodePartNumber(std::atoi(base_match[2].str().c_str()));
-        }
+        event.genreSubType = EPG_GENRE_USE_STRING;
       }
-      if (season != EPG_TAG_INVALID_SERIES_EPISODE)
+      event.genreDescription = strings.Intern(allGenres);
+    }
+    else if (m_settings->m_genreString && event.genreSubType != EPG_GENRE_USE_STRING)
+    {
+      event.genreDescription = strings.Intern(allGenres);
+      event.genreSubType = EPG_GENRE_USE_STRING;
+    }
+
+  }
+
+  int season{EPG_TAG_INVALID_SERIES_EPISODE};
+  int episode{EPG_TAG_INVALID_SERIES_EPISODE};
+  fields.GetInt(ListingSeason, season);
+  fields.GetInt(ListingEpisode, episode);
+  event.episode = episode;
+  event.episodePart = EPG_TAG_INVALID_SERIES_EPISODE;
+  // Backend could send episode only as S00 and parts are not supported
+  if (season <= 0 || episode == EPG_TAG_INVALID_SERIES_EPISODE)
+  {
+    if (!ScanEpisodeMarker(description, event.episode, event.episodePart))
+      ScanEpisodeFraction(description, event.episode, event.episodePart);
+  }
+  if (season != EPG_TAG_INVALID_SERIES_EPISODE)
+  {
+    // clear out NextPVR formatted data, Kodi supports S/E display
+    if (subtitle == kodi::tools::StringUtils::Format("S%02dE%02d", season, episode))
+    {
+      subtitle.clear();
+    }
+    if (season == 0)
+      season = EPG_TAG_INVALID_SERIES_EPISODE;
+  }
+  event.season = season;
+  event.episodeName = subtitle;
+
+  int year{YEAR_NOT_SET};
+  if (fields.GetInt(ListingYear, year))
+  {
+    event.year = year;
+  }
+
+  std::string_view original;
+  if (fields.GetView(ListingOriginal, original))
+  {
+    // For movies with YYYY-MM-DD use only YYYY
+    if (event.genreType == EPG_EVENT_CONTENTMASK_MOVIEDRAMA && event.genreSubType == EPG_EVENT_CONTENTSUBMASK_MOVIEDRAMA_GENERAL
+      && year == YEAR_NOT_SET && original.length() > 4)
+    {
+      year = ParseInteger<int>(original.data(), 4);
+      if (year != 0)
+        event.year = year;
+    }
+    else
+    {
+      event.firstAired = strings.Intern(original);
+    }
+  }
+
+
+  bool firstrun;
+  if (fields.GetBoolean(ListingFirstrun, firstrun))
+  {
+    if (firstrun)
+    {
+      // only compared, there is nothing to keep
+      std::string_view significance;
+      fields.GetView(ListingSignificance, significance);
+      if (significance == "Live")
       {
-        // clear out NextPVR formatted data, Kodi supports S/E display
-        if (subtitle == kodi::tools::StringUtils::Format("S%02dE%02d", season, episode))
-        {
-          subtitle.clear();
-        }
-        if (season == 0)
-          season = EPG_TAG_INVALID_SERIES_EPISODE;
+        event.flags = EPG_TAG_FLAG_IS_LIVE;
       }
-      broadcast.SetSeriesNumber(season);
-      broadcast.SetEpisodeName(subtitle);
-
-      int year{YEAR_NOT_SET};
-      if (XMLUtils::GetInt(pListingNode, "year", year))
+      else if (significance.find("Premiere") != std::string_view::npos)
       {
-        broadcast.SetYear(year);
+        event.flags = EPG_TAG_FLAG_IS_PREMIERE;
       }
-
-      std::string original;
-      if (XMLUtils::GetString(pListingNode, "original", original))
+      else if (significance.find("Finale") != std::string_view::npos)
       {
-        // For movies with YYYY-MM-DD use only YYYY
-        if (broadcast.GetGenreType() == EPG_EVENT_CONTENTMASK_MOVIEDRAMA && broadcast.GetGenreSubType() == EPG_EVENT_CONTENTSUBMASK_MOVIEDRAMA_GENERAL
-          && year == YEAR_NOT_SET && original.length() > 4)
-        {
-          const std::string originalYear = kodi::tools::StringUtils::Mid(original, 0, 4);
-          year = std::atoi(originalYear.c_str());
-          if (year != 0)
-            broadcast.SetYear(year);
-        }
-        else
-        {
-          broadcast.SetFirstAired(original);
-        }
+        event.flags = EPG_TAG_FLAG_IS_FINALE;
       }
-
-
-      bool firstrun;
-      if (XMLUtils::GetBoolean(pListingNode, "firstrun", firstrun))
+      else if (m_settings->m_showNew)
       {
-        if (firstrun)
-        {
-          std::string significance;
-          XMLUtils::GetString(pListingNode, "significance", significance);
-          if (significance == "Live")
-          {
-            broadcast.SetFlags(EPG_TAG_FLAG_IS_LIVE);
-          }
-          else if (significance.find("Premiere") != std::string::npos)
-          {
-            broadcast.SetFlags(EPG_TAG_FLAG_IS_PREMIERE);
-          }
-          else if (significance.find("Finale") != std::string::npos)
-          {
-            broadcast.SetFlags(EPG_TAG_FLAG_IS_FINALE);
-          }
-          else if (m_settings->m_showNew)
-          {
-            broadcast.SetFlags(EPG_TAG_FLAG_IS_NEW);
-          }
-        }
+        event.flags = EPG_TAG_FLAG_IS_NEW;
       }
-      if (m_settings->m_castcrew)
+    }
+  }
+  if (m_settings->m_castcrew)
+  {
+    std::string castcrew;
+    fields.GetString(ListingCast, castcrew);
+    std::replace(castcrew.begin(), castcrew.end(), ';', ',');
+    kodi::tools::StringUtils::Replace(castcrew, "Actor:", "");
+    kodi::tools::StringUtils::Replace(castcrew, "Host:", "");
+    event.cast = strings.Intern(castcrew);
+
+    castcrew.clear();
+    fields.GetString(ListingCrew, castcrew);
+    std::vector<std::string> allcrew = kodi::tools::StringUtils::Split(castcrew, ";", 0);
+    std::string writer;
+    std::string director;
+    for (auto it = allcrew.begin(); it != allcrew.end(); ++it)
+    {
+      std::vector<std::string> onecrew = kodi::tools::StringUtils::Split(*it, ":", 0);
+      if (onecrew.size() == 2)
       {
-        std::string castcrew;
-        XMLUtils::GetString(pListingNode, "cast", castcrew);
-        std::replace(castcrew.begin(), castcrew.end(), ';', ',');
-        kodi::tools::StringUtils::Replace(castcrew, "Actor:", "");
-        kodi::tools::StringUtils::Replace(castcrew, "Host:", "");
-        broadcast.SetCast(castcrew);
-
-        castcrew.clear();
-        XMLUtils::GetString(pListingNode, "crew", castcrew);
-        std::vector<std::string> allcrew = kodi::tools::StringUtils::Split(castcrew, ";", 0);
-        std::string writer;
-        std::string director;
-        for (auto it = allcrew.begin(); it != allcrew.end(); ++it)
+        if (kodi::tools::StringUtils::ContainsKeyword(onecrew[0].c_str(), { "Writer", "Screenwriter" }))
         {
-          std::vector<std::string> onecrew = kodi::tools::StringUtils::Split(*it, ":", 0);
-          if (onecrew.size() == 2)
-          {
-            if (kodi::tools::StringUtils::ContainsKeyword(onecrew[0].c_str(), { "Writer", "Screenwriter" }))
-            {
-              if (!writer.empty())
-                writer.append(EPG_STRING_TOKEN_SEPARATOR);
-              writer.append(onecrew[1]);
-            }
-            if (onecrew[0] == "Director")
-            {
-              if (!director.empty())
-                director.append(EPG_STRING_TOKEN_SEPARATOR);
-              director.append(onecrew[1]);
-            }
-          }
+          if (!writer.empty())
+            writer.append(EPG_STRING_TOKEN_SEPARATOR);
+          writer.append(onecrew[1]);
         }
-        broadcast.SetDirector(director);
-        broadcast.SetWriter(writer);
-      }
-      std::string rating;
-      if (XMLUtils::GetString(pListingNode, "star_rating", rating))
-      {
-        std::regex base_regex("(\\d+[.]?\\d*)(?:(?:/)(\\d+[.]?\\d*))?");
-        std::smatch base_match;
-        if (std::regex_match(rating, base_match, base_regex))
+        if (onecrew[0] == "Director")
         {
-          if (base_match.size() == 3)
-          {
-            double quotient = std::atof(base_match[1].str().c_str());
-            double denominator = std::atof(base_match[2].str().c_str());
-            // if single value passed assume base 4
-            if (denominator == 0)
-              denominator = 4;
-            int starRating = (quotient / denominator * 10.0) + 0.5;
-            broadcast.SetStarRating(starRating);
-          }
+          if (!director.empty())
+            director.append(EPG_STRING_TOKEN_SEPARATOR);
+          director.append(onecrew[1]);
         }
       }
-      results.Add(broadcast);
     }
-    return PVR_ERROR_NO_ERROR;
+    event.director = strings.Intern(director);
+    event.writer = strings.Intern(writer);
+  }
+  std::string rating;
+  if (fields.GetString(ListingStarRating, rating))
+  {
+    double quotient;
+    double denominator;
+    if (ScanStarRating(rating, quotient, denominator))
+    {
+      // if single value passed assume base 4
+      if (denominator == 0)
+        denominator = 4;
+      int starRating = (quotient / denominator * 10.0) + 0.5;
+      event.starRating = starRating;
+    }
   }
+}
 
-  return PVR_ERROR_NO_ERROR;
+void EPG::FillEPGTag(const EpgEvent& event, int channelUid, kodi::addon::PVREPGTag& broadcast)
+{
+  broadcast.SetTitle(std::string(event.title));
+  broadcast.SetUniqueChannelId(channelUid);
+  broadcast.SetStartTime(event.start);
+  broadcast.SetUniqueBroadcastId(event.broadcastId);
+  broadcast.SetEndTime(event.end);
+  broadcast.SetPlot(event.plot);
+
+  if (m_settings->m_downloadGuideArtwork)
+  {
+    std::string artworkPath;
+    if (m_settings->m_sendSidWithMetadata)
+      artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&sid=%s&name=%s", m_settings->m_urlBase, m_request.GetSID().c_str(), UriEncode(std::string(event.title)).c_str());
+    else
+      artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&name=%s", m_settings->m_urlBase, UriEncode(std::string(event.title)).c_str());
+
+    if (m_settings->m_guideArtPortrait)
+      artworkPath += "&prefer=poster";
+    else
+      artworkPath += "&prefer=landscape";
+    broadcast.SetIconPath(artworkPath);
+  }
+  broadcast.SetGenreType(event.genreType);
+  broadcast.SetGenreSubType(event.genreSubType);
+  broadcast.SetGenreDescription(std::string(event.genreDescription));
+  broadcast.SetSeriesNumber(event.season);
+  broadcast.SetEpisodeNumber(event.episode);
+  broadcast.SetEpisodePartNumber(event.episodePart);
+  broadcast.SetEpisodeName(event.episodeName);
+  broadcast.SetYear(event.year);
+  broadcast.SetFirstAired(std::string(event.firstAired));
+  broadcast.SetFlags(event.flags);
+  broadcast.SetCast(std::string(event.cast));
+  broadcast.SetDirector(std::string(event.director));
+  broadcast.SetWriter(std::string(event.writer));
+  broadcast.SetStarRating(event.starRating);
 }
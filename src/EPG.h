@@ -11,18 +11,49 @@
 #include "BackendRequest.h"
 #include <kodi/addon-instance/PVR.h>
 #include "Channels.h"
+#include "EpgUpdateScheduler.h"
+#include "GuideStore.h"
 #include "Recordings.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
 namespace NextPVR
 {
   const int YEAR_NOT_SET = -1;
   class ATTR_DLL_LOCAL EPG
   {
   public:
-    EPG(const std::shared_ptr<InstanceSettings>& settings, Request& request, Recordings& recordings, Channels& channels);
+    EPG(const std::shared_ptr<InstanceSettings>& settings, Request& request, Recordings& recordings, Channels& channels, cPVRClientNextPVR& pvrclient);
+    ~EPG();
     PVR_ERROR GetEPGForChannel(int channelUid, time_t start, time_t end, kodi::addon::PVREPGTagsResultSet& results);
+    /*
+     * Downloads the listings of every channel with a guide source into the
+     * guide store on a background thread, keeping up to the backend
+     * concurrency limit of channel.listings requests in flight.  A guide
+     * request for a channel still being fetched waits for it.  The store is
+     * kept in guide.bin, while lastUpdate matches the saved guide only the
+     * channels and days it is missing are downloaded.  After a refresh Kodi
+     * is asked to reload only the channels with a day of listings that no
+     * longer matches what it was given.
+     */
+    void StartPrefetch(time_t lastUpdate);
+    EpgUpdateScheduler& GetUpdateScheduler() { return m_updateScheduler; };
+    // ends the prefetch pass and the queued guide updates, both call back into the client
+    void Stop();
 
   private:
+    void ParseListing(const tinyxml2::XMLNode* pListingNode, utilities::StringPool& strings, EpgEvent& event);
+    void FillEPGTag(const EpgEvent& event, int channelUid, kodi::addon::PVREPGTag& broadcast);
+    std::string GetListingsRequest(int channelUid, time_t start, time_t end) const;
+    void QueuePrefetchLocked(std::vector<int>&& channelUids);
+    void PrefetchThread();
+    void Prefetch();
+    std::string GetGuideFileName() const;
+    uint32_t GetGuideSettings() const;
     EPG() = default;
     EPG(EPG const&) = delete;
     void operator=(EPG const&) = delete;
@@ -31,5 +62,23 @@ namespace NextPVR
     Request& m_request;
     Recordings& m_recordings;
     Channels& m_channels;
+    cPVRClientNextPVR& m_pvrclient;
+
+    EpgUpdateScheduler m_updateScheduler;
+    GuideStore m_guideStore;
+    std::thread m_prefetchThread;
+    std::atomic<bool> m_stopping{false};
+    std::mutex m_prefetchMutex;
+    std::condition_variable m_prefetched;
+    bool m_prefetchRunning = false;
+    bool m_prefetchAgain = false;
+    time_t m_prefetchUpdate = 0;
+    std::vector<int> m_prefetchChannels;
+    // channels queued or in flight in the running prefetch
+    std::unordered_set<int> m_prefetchPending;
+    // only the prefetch thread reads these
+    bool m_guideLoaded = false;
+    time_t m_guideUpdate = 0;
+    uint32_t m_guideSettings = 0;
   };
 } // namespace NextPVR
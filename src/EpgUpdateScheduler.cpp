@@ -0,0 +1,163 @@
+/*
+ *  Copyright (C) 2020-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "EpgUpdateScheduler.h"
+
+#include "pvrclient-nextpvr.h"
+#include <kodi/tools/StringUtils.h>
+
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+
+using namespace NextPVR;
+
+namespace
+{
+// watching a channel this recently moves it to the front
+constexpr time_t WATCHED_PRIORITY_SECONDS = 7 * 24 * 3600;
+constexpr int PAUSE_POLL_MS = 1000;
+} // unnamed namespace
+
+EpgUpdateScheduler::EpgUpdateScheduler(const std::shared_ptr<InstanceSettings>& settings, Channels& channels, cPVRClientNextPVR& pvrclient) :
+  m_settings(settings),
+  m_channels(channels),
+  m_pvrclient(pvrclient)
+{
+}
+
+EpgUpdateScheduler::~EpgUpdateScheduler()
+{
+  Stop();
+}
+
+void EpgUpdateScheduler::Stop()
+{
+  std::thread thread;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    thread.swap(m_thread);
+  }
+  m_wake.notify_all();
+  if (thread.joinable())
+    thread.join();
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_pending.clear();
+  m_pendingUids.clear();
+  m_stopping = false;
+}
+
+void EpgUpdateScheduler::Queue(const std::vector<int>& channelUids)
+{
+  std::unordered_set<int> priorityGroup;
+  if (!m_settings->m_epgPriorityGroup.empty())
+    m_channels.GetGroupMembers(m_settings->m_epgPriorityGroup, priorityGroup);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_stopping)
+    return;
+  for (const int channelUid : channelUids)
+  {
+    m_queuedTotal++;
+    if (!m_pendingUids.insert(channelUid).second)
+    {
+      m_merged++;
+      continue;
+    }
+    m_pending.push_back({channelUid, m_sequence++, priorityGroup.count(channelUid) != 0});
+  }
+  kodi::Log(ADDON_LOG_DEBUG, "Queued %zu guide updates, %zu pending", channelUids.size(), m_pending.size());
+
+  // started on first use and kept until Stop()
+  if (!m_thread.joinable())
+    m_thread = std::thread(&EpgUpdateScheduler::Process, this);
+  m_wake.notify_all();
+}
+
+void EpgUpdateScheduler::Watched(int channelUid)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_watched[channelUid] = time(nullptr);
+}
+
+size_t EpgUpdateScheduler::NextLocked() const
+{
+  // recently watched by recency, then the priority group, then queue order
+  const time_t watchedSince = time(nullptr) - WATCHED_PRIORITY_SECONDS;
+  auto key = [&](const PendingUpdate& update)
+  {
+    auto it = m_watched.find(update.channelUid);
+    if (it != m_watched.end() && it->second > watchedSince)
+      return std::make_tuple(0, -static_cast<int64_t>(it->second), update.sequence);
+    return std::make_tuple(update.priorityGroup ? 1 : 2, static_cast<int64_t>(0), update.sequence);
+  };
+
+  size_t best = 0;
+  auto bestKey = key(m_pending[0]);
+  for (size_t index = 1; index < m_pending.size(); index++)
+  {
+    const auto candidate = key(m_pending[index]);
+    if (candidate < bestKey)
+    {
+      best = index;
+      bestKey = candidate;
+    }
+  }
+  return best;
+}
+
+void EpgUpdateScheduler::Process()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    m_wake.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+    if (m_stopping)
+      return;
+
+    if (m_settings->m_epgUpdatePause && m_pvrclient.m_nowPlaying != NotPlaying)
+    {
+      if (!m_paused)
+      {
+        m_paused = true;
+        m_pauses++;
+        kodi::Log(ADDON_LOG_DEBUG, "Guide updates paused during playback, %zu pending", m_pending.size());
+      }
+      m_wake.wait_for(lock, std::chrono::milliseconds(PAUSE_POLL_MS), [this] { return m_stopping; });
+      continue;
+    }
+    m_paused = false;
+
+    const size_t next = NextLocked();
+    const int channelUid = m_pending[next].channelUid;
+    m_pending.erase(m_pending.begin() + next);
+    m_pendingUids.erase(channelUid);
+    m_released++;
+    lock.unlock();
+    m_pvrclient.TriggerEpgUpdate(channelUid);
+    lock.lock();
+
+    if (m_pending.empty())
+      kodi::Log(ADDON_LOG_DEBUG, "Guide updates done, %llu released", static_cast<unsigned long long>(m_released));
+
+    const int rate = std::max(1, m_settings->m_epgUpdateRate);
+    m_wake.wait_for(lock, std::chrono::microseconds(1000000 / rate), [this] { return m_stopping; });
+  }
+}
+
+std::string EpgUpdateScheduler::GetProgress() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::string progress = kodi::tools::StringUtils::Format(kodi::addon::GetLocalizedString(30228).c_str(),
+                                                         m_pending.size(), static_cast<unsigned long long>(m_released),
+                                                         static_cast<unsigned long long>(m_queuedTotal), static_cast<unsigned long long>(m_merged),
+                                                         static_cast<unsigned long long>(m_pauses));
+  if (m_paused)
+    progress += "\n" + kodi::addon::GetLocalizedString(30229);
+  return progress;
+}
@@ -0,0 +1,81 @@
+/*
+ *  Copyright (C) 2020-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+
+#pragma once
+
+#include "Channels.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace NextPVR
+{
+
+  /*
+   * Releases TriggerEpgUpdate calls at the configured number per second
+   * instead of all at once, so Kodi's guide requests trickle in behind
+   * playback rather than filling every backend slot.  Recently watched
+   * channels go first, most recent first, then the priority channel group
+   * and then the rest in the order they were queued.  A channel queued
+   * twice is triggered once.  Optionally nothing is released while
+   * anything is playing.
+   */
+  class ATTR_DLL_LOCAL EpgUpdateScheduler
+  {
+  public:
+    EpgUpdateScheduler(const std::shared_ptr<InstanceSettings>& settings, Channels& channels, cPVRClientNextPVR& pvrclient);
+    ~EpgUpdateScheduler();
+
+    void Queue(const std::vector<int>& channelUids);
+    void Watched(int channelUid);
+    std::string GetProgress() const;
+    // drops the pending updates and joins the thread, the next Queue() starts it again
+    void Stop();
+
+  private:
+    EpgUpdateScheduler(EpgUpdateScheduler const&) = delete;
+    void operator=(EpgUpdateScheduler const&) = delete;
+
+    struct PendingUpdate
+    {
+      int channelUid;
+      uint64_t sequence;
+      bool priorityGroup;
+    };
+
+    void Process();
+    size_t NextLocked() const;
+
+    const std::shared_ptr<InstanceSettings> m_settings;
+    Channels& m_channels;
+    cPVRClientNextPVR& m_pvrclient;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::thread m_thread;
+    bool m_stopping = false;
+    std::vector<PendingUpdate> m_pending;
+    std::unordered_set<int> m_pendingUids;
+    std::unordered_map<int, time_t> m_watched;
+    uint64_t m_sequence = 0;
+
+    // progress since the add-on started
+    uint64_t m_queuedTotal = 0;
+    uint64_t m_merged = 0;
+    uint64_t m_released = 0;
+    uint64_t m_pauses = 0;
+    bool m_paused = false;
+  };
+} // namespace NextPVR
@@ -0,0 +1,501 @@
+/*
+ *  Copyright (C) 2020-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "GuideStore.h"
+#include "ChannelTable.h"
+#include "utilities/Hash.h"
+
+#include <kodi/Filesystem.h>
+#include <kodi/General.h>
+
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+using namespace NextPVR;
+
+namespace
+{
+constexpr time_t SECONDS_PER_DAY = 24 * 3600;
+
+struct GuideChannelRecord
+{
+  int32_t uid;
+  uint32_t days;
+  int64_t from;
+  int64_t to;
+};
+
+struct GuideDayRecord
+{
+  int64_t day;
+  // a block whose last listing ended before the window is skipped whole
+  int64_t lastEnd;
+  uint32_t events;
+  uint32_t reserved;
+};
+
+enum eGuideString
+{
+  GuideTitle = 0,
+  GuidePlot,
+  GuideEpisodeName,
+  GuideGenreDescription,
+  GuideFirstAired,
+  GuideCast,
+  GuideDirector,
+  GuideWriter,
+  GUIDE_STRINGS
+};
+
+struct GuideEventRecord
+{
+  int64_t start;
+  int64_t end;
+  uint32_t broadcastId;
+  int32_t genreType;
+  int32_t genreSubType;
+  int32_t season;
+  int32_t episode;
+  int32_t episodePart;
+  int32_t year;
+  int32_t starRating;
+  uint32_t flags;
+  uint32_t strings[GUIDE_STRINGS];
+  uint32_t reserved;
+};
+
+uint64_t HashEvent(uint64_t hash, const EpgEvent& event)
+{
+  const int64_t times[] = {event.start, event.end};
+  const int32_t values[] = {static_cast<int32_t>(event.broadcastId), event.genreType, event.genreSubType, event.season,
+                            event.episode, event.episodePart, event.year, event.starRating, static_cast<int32_t>(event.flags)};
+  hash = utilities::HashBytes(hash, times, sizeof(times));
+  hash = utilities::HashBytes(hash, values, sizeof(values));
+  for (const std::string_view value : {event.title, std::string_view(event.plot), std::string_view(event.episodeName),
+                                       event.genreDescription, event.firstAired, event.cast, event.director, event.writer})
+    hash = utilities::HashString(hash, value);
+  return hash;
+}
+
+template<typename T>
+void Append(std::string& data, const T& record)
+{
+  data.append(reinterpret_cast<const char*>(&record), sizeof(record));
+}
+
+template<typename T>
+bool Take(const std::string& data, size_t& offset, T& record)
+{
+  if (data.size() - offset < sizeof(record))
+    return false;
+  memcpy(&record, data.data() + offset, sizeof(record));
+  offset += sizeof(record);
+  return true;
+}
+} // unnamed namespace
+
+std::vector<GuideStore::DayDigest> GuideStore::DigestDays(const std::vector<EpgEvent>& events)
+{
+  std::vector<DayDigest> days;
+  for (const EpgEvent& event : events)
+  {
+    const int64_t day = event.start / SECONDS_PER_DAY;
+    if (days.empty() || days.back().day != day)
+      days.push_back({day, utilities::FNV_OFFSET_BASIS});
+    days.back().digest = HashEvent(days.back().digest, event);
+  }
+  return days;
+}
+
+void GuideStore::InternEvent(utilities::StringPool& strings, EpgEvent& event)
+{
+  for (std::string_view* value : {&event.title, &event.genreDescription, &event.firstAired, &event.cast, &event.director,
+                                  &event.writer})
+    *value = strings.Intern(*value);
+}
+
+bool GuideStore::Replace(int channelUid, time_t from, time_t to, std::vector<EpgEvent>&& events,
+                         const std::shared_ptr<utilities::StringPool>& strings)
+{
+  std::stable_sort(events.begin(), events.end(), [](const EpgEvent& a, const EpgEvent& b) { return a.start < b.start; });
+  std::vector<DayDigest> days = DigestDays(events);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_channels.find(channelUid);
+  bool changed = false;
+  if (it != m_channels.end())
+  {
+    // only whole days both windows hold are compared, the tail of the old window was always partial
+    const int64_t lastDay = std::min(it->second.to, to) / SECONDS_PER_DAY;
+    auto held = [lastDay](const std::vector<DayDigest>& digests)
+    {
+      std::vector<std::pair<int64_t, uint64_t>> heldDays;
+      for (const DayDigest& digest : digests)
+      {
+        if (digest.day < lastDay)
+          heldDays.emplace_back(digest.day, digest.digest);
+      }
+      return heldDays;
+    };
+    changed = held(it->second.days) != held(days);
+  }
+  m_channels[channelUid] = {from, to, std::move(events), std::move(days), strings};
+  return changed;
+}
+
+void GuideStore::Extend(int channelUid, time_t from, time_t to, std::vector<EpgEvent>&& events,
+                        const std::shared_ptr<utilities::StringPool>& strings)
+{
+  // listings before from are already held, the backend repeats the one running at from
+  std::stable_sort(events.begin(), events.end(), [](const EpgEvent& a, const EpgEvent& b) { return a.start < b.start; });
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_channels.find(channelUid);
+  if (it == m_channels.end())
+  {
+    std::vector<DayDigest> days = DigestDays(events);
+    m_channels[channelUid] = {from, to, std::move(events), std::move(days), strings};
+    return;
+  }
+  std::vector<EpgEvent>& guide = it->second.events;
+  guide.erase(std::lower_bound(guide.begin(), guide.end(), from,
+                               [](const EpgEvent& event, time_t value) { return event.start < value; }),
+              guide.end());
+  // move the listings kept onto the new pool so the channel never holds more than one
+  if (it->second.strings != strings)
+  {
+    for (EpgEvent& event : guide)
+      InternEvent(*strings, event);
+    it->second.strings = strings;
+  }
+  for (EpgEvent& event : events)
+  {
+    if (event.start >= from)
+      guide.push_back(std::move(event));
+  }
+  it->second.to = to;
+  it->second.days = DigestDays(guide);
+}
+
+bool GuideStore::Get(int channelUid, time_t start, time_t end, std::vector<EpgEvent>& events,
+                     std::shared_ptr<const utilities::StringPool>& strings) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_channels.find(channelUid);
+  if (it == m_channels.end() || start < it->second.from || end > it->second.to)
+    return false;
+
+  strings = it->second.strings;
+  // events overlapping [start, end], the backend answers the same way
+  const std::vector<EpgEvent>& guide = it->second.events;
+  auto first = std::lower_bound(guide.begin(), guide.end(), end,
+                                [](const EpgEvent& event, time_t value) { return event.start < value; });
+  for (auto event = guide.begin(); event != first; ++event)
+  {
+    if (event->end > start)
+      events.push_back(*event);
+  }
+  return true;
+}
+
+bool GuideStore::GetCoverage(int channelUid, time_t& from, time_t& to) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_channels.find(channelUid);
+  if (it == m_channels.end())
+    return false;
+  from = it->second.from;
+  to = it->second.to;
+  return true;
+}
+
+void GuideStore::Trim(time_t before)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (auto& channel : m_channels)
+  {
+    std::vector<EpgEvent>& guide = channel.second.events;
+    guide.erase(std::remove_if(guide.begin(), guide.end(), [before](const EpgEvent& event) { return event.end <= before; }),
+                guide.end());
+    channel.second.from = std::max(channel.second.from, before);
+    channel.second.days = DigestDays(guide);
+  }
+}
+
+void GuideStore::Retain(const std::vector<int>& channelUids)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (auto it = m_channels.begin(); it != m_channels.end();)
+  {
+    if (std::find(channelUids.begin(), channelUids.end(), it->first) == channelUids.end())
+      it = m_channels.erase(it);
+    else
+      ++it;
+  }
+}
+
+void GuideStore::Erase(int channelUid)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_channels.erase(channelUid);
+}
+
+void GuideStore::Clear()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_channels.clear();
+}
+
+size_t GuideStore::Channels() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_channels.size();
+}
+
+size_t GuideStore::Events() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  size_t events = 0;
+  for (const auto& guide : m_channels)
+    events += guide.second.events.size();
+  return events;
+}
+
+bool GuideStore::Save(const std::string& filename, time_t lastUpdate, uint32_t settings) const
+{
+  std::string data;
+  if (!Serialize(lastUpdate, settings, data))
+    return false;
+
+  // write beside the old guide and swap, a crash never leaves half a file
+  const std::string tempFile = filename + ".tmp";
+  kodi::vfs::CFile file;
+  if (!file.OpenFileForWrite(tempFile, true))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot write guide %s", tempFile.c_str());
+    return false;
+  }
+  const bool written = file.Write(data.data(), data.size()) == static_cast<ssize_t>(data.size());
+  file.Close();
+  if (!written || !kodi::vfs::RenameFile(tempFile, filename))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot replace guide %s", filename.c_str());
+    kodi::vfs::DeleteFile(tempFile);
+    return false;
+  }
+  return true;
+}
+
+bool GuideStore::Load(const std::string& filename, uint32_t settings, time_t keepFrom, time_t& lastUpdate)
+{
+  kodi::vfs::CFile file;
+  if (!file.OpenFile(filename, ADDON_READ_NO_CACHE))
+    return false;
+
+  std::string data;
+  char buffer[64 * 1024];
+  ssize_t count;
+  while ((count = file.Read(buffer, sizeof(buffer))) > 0)
+    data.append(buffer, count);
+  file.Close();
+
+  if (!Deserialize(std::move(data), settings, keepFrom, lastUpdate))
+  {
+    kodi::Log(ADDON_LOG_INFO, "Ignoring guide %s", filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool GuideStore::Serialize(time_t lastUpdate, uint32_t settings, std::string& data) const
+{
+  std::string pool(1, '\0');
+  // the views stay valid while the store is locked
+  std::unordered_map<std::string_view, uint32_t> pooled;
+  auto intern = [&](std::string_view value) -> uint32_t
+  {
+    if (value.empty())
+      return 0;
+    auto it = pooled.find(value);
+    if (it != pooled.end())
+      return it->second;
+    const uint32_t offset = static_cast<uint32_t>(pool.size());
+    pool.append(value.data(), value.length());
+    pool.push_back('\0');
+    pooled.emplace(value, offset);
+    return offset;
+  };
+
+  std::string listings;
+  uint32_t channels = 0;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (const auto& channel : m_channels)
+    {
+      const std::vector<EpgEvent>& guide = channel.second.events;
+      GuideChannelRecord channelRecord{channel.first, 0, channel.second.from, channel.second.to};
+      const size_t channelOffset = listings.size();
+      Append(listings, channelRecord);
+
+      auto event = guide.begin();
+      while (event != guide.end())
+      {
+        GuideDayRecord dayRecord{};
+        dayRecord.day = event->start / SECONDS_PER_DAY;
+        const size_t dayOffset = listings.size();
+        Append(listings, dayRecord);
+        for (; event != guide.end() && event->start / SECONDS_PER_DAY == dayRecord.day; ++event)
+        {
+          GuideEventRecord record{};
+          record.start = event->start;
+          record.end = event->end;
+          record.broadcastId = event->broadcastId;
+          record.genreType = event->genreType;
+          record.genreSubType = event->genreSubType;
+          record.season = event->season;
+          record.episode = event->episode;
+          record.episodePart = event->episodePart;
+          record.year = event->year;
+          record.starRating = event->starRating;
+          record.flags = event->flags;
+          record.strings[GuideTitle] = intern(event->title);
+          record.strings[GuidePlot] = intern(event->plot);
+          record.strings[GuideEpisodeName] = intern(event->episodeName);
+          record.strings[GuideGenreDescription] = intern(event->genreDescription);
+          record.strings[GuideFirstAired] = intern(event->firstAired);
+          record.strings[GuideCast] = intern(event->cast);
+          record.strings[GuideDirector] = intern(event->director);
+          record.strings[GuideWriter] = intern(event->writer);
+          Append(listings, record);
+          dayRecord.lastEnd = std::max<int64_t>(dayRecord.lastEnd, event->end);
+          dayRecord.events++;
+        }
+        memcpy(&listings[dayOffset], &dayRecord, sizeof(dayRecord));
+        channelRecord.days++;
+      }
+      memcpy(&listings[channelOffset], &channelRecord, sizeof(channelRecord));
+      channels++;
+    }
+  }
+
+  const std::string raw = pool + listings;
+  uLongf packedSize = compressBound(static_cast<uLong>(raw.size()));
+  data.assign(sizeof(GuideFileHeader) + packedSize, '\0');
+  if (compress2(reinterpret_cast<Bytef*>(&data[sizeof(GuideFileHeader)]), &packedSize, reinterpret_cast<const Bytef*>(raw.data()),
+                static_cast<uLong>(raw.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot compress guide");
+    return false;
+  }
+  data.resize(sizeof(GuideFileHeader) + packedSize);
+
+  GuideFileHeader header{};
+  memcpy(header.magic, GUIDE_FILE_MAGIC, sizeof(header.magic));
+  header.version = GUIDE_FILE_VERSION;
+  header.byteOrder = CHANNEL_TABLE_BYTE_ORDER;
+  header.lastUpdate = lastUpdate;
+  header.settings = settings;
+  header.channels = channels;
+  header.poolSize = static_cast<uint32_t>(pool.size());
+  header.rawSize = static_cast<uint32_t>(raw.size());
+  header.packedSize = static_cast<uint32_t>(packedSize);
+  memcpy(&data[0], &header, sizeof(header));
+  kodi::Log(ADDON_LOG_DEBUG, "Packed guide %u channels %zu bytes, %zu before compression", channels, data.size(), raw.size());
+  return true;
+}
+
+bool GuideStore::Deserialize(std::string&& data, uint32_t settings, time_t keepFrom, time_t& lastUpdate)
+{
+  GuideFileHeader header;
+  size_t offset = 0;
+  if (!Take(data, offset, header) || memcmp(header.magic, GUIDE_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != GUIDE_FILE_VERSION || header.byteOrder != CHANNEL_TABLE_BYTE_ORDER ||
+      header.packedSize != data.size() - offset || header.poolSize == 0 || header.poolSize > header.rawSize)
+  {
+    kodi::Log(ADDON_LOG_INFO, "Guide is not in a usable format");
+    return false;
+  }
+  if (header.settings != settings)
+  {
+    kodi::Log(ADDON_LOG_INFO, "Guide was saved with other settings");
+    return false;
+  }
+
+  std::string raw(header.rawSize, '\0');
+  uLongf rawSize = header.rawSize;
+  if (uncompress(reinterpret_cast<Bytef*>(&raw[0]), &rawSize, reinterpret_cast<const Bytef*>(data.data() + offset),
+                 header.packedSize) != Z_OK || rawSize != header.rawSize || raw[header.poolSize - 1] != '\0')
+  {
+    kodi::Log(ADDON_LOG_INFO, "Guide is damaged");
+    return false;
+  }
+  data.clear();
+
+  const char* pool = raw.data();
+  offset = header.poolSize;
+  std::shared_ptr<utilities::StringPool> strings = std::make_shared<utilities::StringPool>();
+  std::unordered_map<int, ChannelGuide> channels;
+  for (uint32_t channel = 0; channel < header.channels; channel++)
+  {
+    GuideChannelRecord channelRecord;
+    if (!Take(raw, offset, channelRecord))
+      return false;
+    ChannelGuide& guide = channels[channelRecord.uid];
+    guide.from = std::max(static_cast<time_t>(channelRecord.from), keepFrom);
+    guide.to = static_cast<time_t>(channelRecord.to);
+    guide.strings = strings;
+    for (uint32_t day = 0; day < channelRecord.days; day++)
+    {
+      GuideDayRecord dayRecord;
+      if (!Take(raw, offset, dayRecord) || (raw.size() - offset) / sizeof(GuideEventRecord) < dayRecord.events)
+        return false;
+      if (dayRecord.lastEnd <= keepFrom)
+      {
+        offset += dayRecord.events * sizeof(GuideEventRecord);
+        continue;
+      }
+      for (uint32_t event = 0; event < dayRecord.events; event++)
+      {
+        GuideEventRecord record;
+        Take(raw, offset, record);
+        if (record.end <= keepFrom)
+          continue;
+        for (uint32_t string : record.strings)
+        {
+          if (string >= header.poolSize)
+            return false;
+        }
+        EpgEvent listing;
+        listing.start = static_cast<time_t>(record.start);
+        listing.end = static_cast<time_t>(record.end);
+        listing.broadcastId = record.broadcastId;
+        listing.genreType = record.genreType;
+        listing.genreSubType = record.genreSubType;
+        listing.season = record.season;
+        listing.episode = record.episode;
+        listing.episodePart = record.episodePart;
+        listing.year = record.year;
+        listing.starRating = record.starRating;
+        listing.flags = record.flags;
+        listing.title = strings->Intern(pool + record.strings[GuideTitle]);
+        listing.plot = pool + record.strings[GuidePlot];
+        listing.episodeName = pool + record.strings[GuideEpisodeName];
+        listing.genreDescription = strings->Intern(pool + record.strings[GuideGenreDescription]);
+        listing.firstAired = strings->Intern(pool + record.strings[GuideFirstAired]);
+        listing.cast = strings->Intern(pool + record.strings[GuideCast]);
+        listing.director = strings->Intern(pool + record.strings[GuideDirector]);
+        listing.writer = strings->Intern(pool + record.strings[GuideWriter]);
+        guide.events.push_back(std::move(listing));
+      }
+    }
+    guide.days = DigestDays(guide.events);
+  }
+
+  lastUpdate = static_cast<time_t>(header.lastUpdate);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_channels.swap(channels);
+  return true;
+}
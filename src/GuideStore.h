@@ -0,0 +1,144 @@
+/*
+ *  Copyright (C) 2020-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+
+#pragma once
+
+#include "utilities/StringPool.h"
+
+#include <kodi/addon-instance/PVR.h>
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace NextPVR
+{
+
+  /*
+   * One channel.listings entry after the add-on's own clean up, everything
+   * the EPG tag needs except the artwork URL, which carries the session id
+   * and is built when the tag is handed to Kodi.  The fields that repeat
+   * across listings are views into the StringPool of the refresh that
+   * parsed them, whoever holds the event holds that pool too.
+   */
+  struct EpgEvent
+  {
+    time_t start = 0;
+    time_t end = 0;
+    unsigned int broadcastId = 0;
+    int genreType = 0;
+    int genreSubType = 0;
+    int season = EPG_TAG_INVALID_SERIES_EPISODE;
+    int episode = EPG_TAG_INVALID_SERIES_EPISODE;
+    int episodePart = EPG_TAG_INVALID_SERIES_EPISODE;
+    int year = 0;
+    int starRating = 0;
+    unsigned int flags = 0;
+    std::string_view title;
+    std::string plot;
+    std::string episodeName;
+    std::string_view genreDescription;
+    std::string_view firstAired;
+    std::string_view cast;
+    std::string_view director;
+    std::string_view writer;
+  };
+
+  constexpr char GUIDE_FILE_MAGIC[8] = {'N', 'P', 'V', 'R', 'G', 'I', 'D', 'E'};
+  constexpr uint32_t GUIDE_FILE_VERSION = 1;
+
+  /*
+   * guide.bin starts with this header, the rest of the file is one zlib
+   * stream holding the string pool followed by each channel's listings in
+   * one block per day.  Strings are stored once and referenced by offset.
+   */
+  struct GuideFileHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    int64_t lastUpdate;
+    uint32_t settings;
+    uint32_t channels;
+    uint32_t poolSize;
+    uint32_t rawSize;
+    uint32_t packedSize;
+    uint32_t reserved;
+  };
+  static_assert(sizeof(GuideFileHeader) == 48, "guide file header must not change size");
+
+  /*
+   * Guide listings held in memory per channel, sorted by start time, with
+   * the window each channel was fetched for so a request outside it can go
+   * to the backend instead.  A digest is kept for every day of listings so
+   * a refetch can tell whether anything Kodi was already given changed.
+   * Every channel's events point into one string pool, a refresh's pool
+   * is freed with the last channel still using it.
+   */
+  class ATTR_DLL_LOCAL GuideStore
+  {
+  public:
+    GuideStore() = default;
+
+    bool Replace(int channelUid, time_t from, time_t to, std::vector<EpgEvent>&& events,
+                 const std::shared_ptr<utilities::StringPool>& strings);
+    void Extend(int channelUid, time_t from, time_t to, std::vector<EpgEvent>&& events,
+                const std::shared_ptr<utilities::StringPool>& strings);
+    bool Get(int channelUid, time_t start, time_t end, std::vector<EpgEvent>& events,
+             std::shared_ptr<const utilities::StringPool>& strings) const;
+    bool GetCoverage(int channelUid, time_t& from, time_t& to) const;
+    void Trim(time_t before);
+    void Retain(const std::vector<int>& channelUids);
+    void Erase(int channelUid);
+    void Clear();
+
+    /*
+     * The file is tagged with the guide's last update and the settings that
+     * shape parsed listings, Load() refuses a file with other settings and
+     * leaves out whole days that ended before keepFrom.
+     */
+    bool Save(const std::string& filename, time_t lastUpdate, uint32_t settings) const;
+    bool Load(const std::string& filename, uint32_t settings, time_t keepFrom, time_t& lastUpdate);
+    // the file contents without the file, Load() and Save() go through these
+    bool Serialize(time_t lastUpdate, uint32_t settings, std::string& data) const;
+    bool Deserialize(std::string&& data, uint32_t settings, time_t keepFrom, time_t& lastUpdate);
+
+    size_t Channels() const;
+    size_t Events() const;
+
+  private:
+    GuideStore(GuideStore const&) = delete;
+    void operator=(GuideStore const&) = delete;
+
+    struct DayDigest
+    {
+      int64_t day;
+      uint64_t digest;
+    };
+
+    struct ChannelGuide
+    {
+      time_t from;
+      time_t to;
+      std::vector<EpgEvent> events;
+      std::vector<DayDigest> days;
+      std::shared_ptr<const utilities::StringPool> strings;
+    };
+
+    static std::vector<DayDigest> DigestDays(const std::vector<EpgEvent>& events);
+    static void InternEvent(utilities::StringPool& strings, EpgEvent& event);
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<int, ChannelGuide> m_channels;
+  };
+} // namespace NextPVR
@@ -0,0 +1,362 @@
+/*
+ *  Copyright (C) 2020-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "IconFetcher.h"
+#include "utilities/Hash.h"
+
+#include <kodi/Filesystem.h>
+#include <kodi/General.h>
+#include <kodi/tools/StringUtils.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+using namespace NextPVR;
+
+namespace
+{
+// icons share the bulk lane with guide downloads, more workers would only queue there
+constexpr int MAX_ICON_WORKERS = 4;
+constexpr int ICON_INDEX_VERSION = 1;
+
+uint64_t HashFile(const std::string& filename, uint32_t& size)
+{
+  // only used to tell one logo from another
+  uint64_t hash = utilities::FNV_OFFSET_BASIS;
+  size = 0;
+  kodi::vfs::CFile file;
+  if (!file.OpenFile(filename, ADDON_READ_NO_CACHE))
+    return 0;
+
+  char buffer[16 * 1024];
+  ssize_t count;
+  while ((count = file.Read(buffer, sizeof(buffer))) > 0)
+  {
+    hash = utilities::HashBytes(hash, buffer, count);
+    size += static_cast<uint32_t>(count);
+  }
+  file.Close();
+  return hash;
+}
+} // unnamed namespace
+
+IconFetcher::IconFetcher(const std::shared_ptr<InstanceSettings>& settings, Request& request, const std::function<void()>& batchComplete) :
+  m_settings(settings),
+  m_request(request),
+  m_batchComplete(batchComplete)
+{
+}
+
+IconFetcher::~IconFetcher()
+{
+  Stop();
+}
+
+void IconFetcher::Stop()
+{
+  std::vector<std::thread> workers;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    m_queue.clear();
+    workers.swap(m_workers);
+  }
+  m_queued.notify_all();
+  for (std::thread& worker : workers)
+  {
+    if (worker.joinable())
+      worker.join();
+  }
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_pending.clear();
+  if (m_indexDirty)
+    SaveIndexLocked();
+  m_stopping = false;
+}
+
+std::string IconFetcher::GetFileName(int channelID) const
+{
+  return kodi::tools::StringUtils::Format("%snextpvr-ch%d.png", m_settings->m_instanceDirectory.c_str(), channelID);
+}
+
+void IconFetcher::Use(int channelID)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  LoadIndexLocked();
+  auto it = m_index.find(channelID);
+  if (it == m_index.end())
+  {
+    // downloaded before the index existed, hash it so revalidation can tell it is unchanged
+    lock.unlock();
+    IconEntry entry{0, 0, 0, 0};
+    entry.hash = HashFile(GetFileName(channelID), entry.size);
+    lock.lock();
+    it = m_index.emplace(channelID, entry).first;
+  }
+  it->second.lastUsed = time(nullptr);
+  m_indexDirty = true;
+}
+
+void IconFetcher::Queue(int channelID)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  LoadIndexLocked();
+  QueueLocked(channelID, false);
+}
+
+void IconFetcher::Revalidate(time_t updateTime)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  LoadIndexLocked();
+  if (updateTime == m_validatedUpdate)
+    return;
+
+  kodi::Log(ADDON_LOG_DEBUG, "Revalidating %zu channel icons", m_index.size());
+  m_validatedUpdate = updateTime;
+  m_indexDirty = true;
+  for (const auto& icon : m_index)
+    QueueLocked(icon.first, true);
+  // a failed first fetch may have been the network rather than a missing icon
+  std::unordered_set<int> skipped;
+  skipped.swap(m_skipped);
+  for (const int channelID : skipped)
+    QueueLocked(channelID, false);
+}
+
+void IconFetcher::SetLineup(const std::vector<int>& channelIDs)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_lineup.clear();
+  m_lineup.insert(channelIDs.begin(), channelIDs.end());
+  m_lineupKnown = true;
+}
+
+void IconFetcher::Forget(int channelID)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  LoadIndexLocked();
+  m_skipped.erase(channelID);
+  if (m_index.erase(channelID) != 0)
+    m_indexDirty = true;
+}
+
+void IconFetcher::ForgetAll()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  LoadIndexLocked();
+  m_skipped.clear();
+  m_index.clear();
+  m_indexDirty = true;
+}
+
+void IconFetcher::QueueLocked(int channelID, bool revalidate)
+{
+  if (m_stopping || m_pending.count(channelID) != 0 || (!revalidate && m_skipped.count(channelID) != 0))
+    return;
+
+  m_pending.insert(channelID);
+  m_queue.push_back({channelID, revalidate});
+
+  // workers are started on first use and stay for the life of the instance
+  const int limit = std::max(1, std::min(m_settings->m_backendConcurrency, MAX_ICON_WORKERS));
+  if (static_cast<int>(m_workers.size()) < limit && static_cast<int>(m_queue.size()) > static_cast<int>(m_workers.size()) - m_busy)
+    m_workers.emplace_back(&IconFetcher::Worker, this);
+  m_queued.notify_one();
+}
+
+void IconFetcher::Worker()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    m_queued.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+    if (m_stopping)
+      return;
+
+    IconJob job = m_queue.front();
+    m_queue.pop_front();
+    m_busy++;
+    lock.unlock();
+
+    const eFetchResult result = Fetch(job);
+
+    lock.lock();
+    m_busy--;
+    m_pending.erase(job.channelID);
+    if (result == FetchChanged)
+      m_changed++;
+    else if (result == FetchFailed && !job.revalidate)
+      m_skipped.insert(job.channelID);
+
+    if (m_queue.empty() && m_busy == 0 && !m_stopping)
+    {
+      EvictLocked();
+      if (m_indexDirty)
+        SaveIndexLocked();
+      if (m_changed != 0)
+      {
+        kodi::Log(ADDON_LOG_DEBUG, "Fetched %d channel icons", m_changed);
+        m_changed = 0;
+        lock.unlock();
+        m_batchComplete();
+        lock.lock();
+      }
+    }
+  }
+}
+
+IconFetcher::eFetchResult IconFetcher::Fetch(const IconJob& job)
+{
+  // Kodi may read the icon at any time, never let it see a partial file
+  const std::string filename = GetFileName(job.channelID);
+  const std::string tempFile = filename + ".tmp";
+  const std::string URL = "/service?method=channel.icon&channel_id=" + std::to_string(job.channelID);
+  if (m_request.FileCopy(URL.c_str(), tempFile) != HTTP_OK)
+  {
+    // a failed revalidation keeps the icon we have
+    kodi::vfs::DeleteFile(tempFile);
+    return job.revalidate ? FetchUnchanged : FetchFailed;
+  }
+
+  uint32_t size;
+  const uint64_t hash = HashFile(tempFile, size);
+  const time_t now = time(nullptr);
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = m_index.find(job.channelID);
+    if (it != m_index.end() && it->second.hash == hash && kodi::vfs::FileExists(filename))
+    {
+      it->second.fetched = now;
+      m_indexDirty = true;
+      lock.unlock();
+      kodi::vfs::DeleteFile(tempFile);
+      return FetchUnchanged;
+    }
+  }
+
+  if (!kodi::vfs::RenameFile(tempFile, filename))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot rename channel icon %s", filename.c_str());
+    kodi::vfs::DeleteFile(tempFile);
+    return FetchFailed;
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  IconEntry& entry = m_index[job.channelID];
+  entry.hash = hash;
+  entry.fetched = now;
+  entry.size = size;
+  if (entry.lastUsed == 0)
+    entry.lastUsed = now;
+  m_indexDirty = true;
+  return FetchChanged;
+}
+
+void IconFetcher::EvictLocked()
+{
+  uint64_t total = 0;
+  for (const auto& icon : m_index)
+    total += icon.second.size;
+
+  const uint64_t budget = static_cast<uint64_t>(std::max(1, m_settings->m_iconCacheSize)) * 1024 * 1024;
+  if (total <= budget || !m_lineupKnown)
+    return;
+
+  std::vector<std::pair<time_t, int>> byUse;
+  for (const auto& icon : m_index)
+  {
+    if (m_lineup.count(icon.first) == 0)
+      byUse.emplace_back(icon.second.lastUsed, icon.first);
+  }
+  std::sort(byUse.begin(), byUse.end());
+
+  int evicted = 0;
+  for (const auto& icon : byUse)
+  {
+    if (total <= budget)
+      break;
+    total -= m_index[icon.second].size;
+    kodi::vfs::DeleteFile(GetFileName(icon.second));
+    m_index.erase(icon.second);
+    evicted++;
+  }
+  if (evicted != 0)
+  {
+    kodi::Log(ADDON_LOG_INFO, "Evicted %d channel icons over the %d MB budget", evicted, m_settings->m_iconCacheSize);
+    m_indexDirty = true;
+  }
+  if (total > budget)
+    kodi::Log(ADDON_LOG_DEBUG, "Icons of the current lineup use more than the %d MB budget", m_settings->m_iconCacheSize);
+}
+
+void IconFetcher::LoadIndexLocked()
+{
+  if (m_indexLoaded)
+    return;
+  m_indexLoaded = true;
+
+  kodi::vfs::CFile file;
+  if (!file.OpenFile(m_settings->m_instanceDirectory + "icons.idx", ADDON_READ_NO_CACHE))
+    return;
+
+  std::string text;
+  char buffer[16 * 1024];
+  ssize_t count;
+  while ((count = file.Read(buffer, sizeof(buffer))) > 0)
+    text.append(buffer, count);
+  file.Close();
+
+  std::vector<std::string> lines = kodi::tools::StringUtils::Split(text, '\n');
+  int version = 0;
+  long long validated = 0;
+  if (lines.empty() || sscanf(lines[0].c_str(), "icons %d %lld", &version, &validated) != 2 || version != ICON_INDEX_VERSION)
+  {
+    kodi::Log(ADDON_LOG_INFO, "Ignoring unusable icons.idx");
+    return;
+  }
+  m_validatedUpdate = static_cast<time_t>(validated);
+  for (size_t line = 1; line < lines.size(); line++)
+  {
+    int channelID;
+    uint64_t hash;
+    long long fetched, lastUsed;
+    unsigned int size;
+    if (sscanf(lines[line].c_str(), "%d %" SCNx64 " %lld %u %lld", &channelID, &hash, &fetched, &size, &lastUsed) == 5)
+      m_index[channelID] = {hash, static_cast<time_t>(fetched), size, static_cast<time_t>(lastUsed)};
+  }
+}
+
+void IconFetcher::SaveIndexLocked()
+{
+  std::string text = kodi::tools::StringUtils::Format("icons %d %lld\n", ICON_INDEX_VERSION, static_cast<long long>(m_validatedUpdate));
+  for (const auto& icon : m_index)
+  {
+    text += kodi::tools::StringUtils::Format("%d %016" PRIx64 " %lld %u %lld\n", icon.first, icon.second.hash,
+                                             static_cast<long long>(icon.second.fetched), icon.second.size,
+                                             static_cast<long long>(icon.second.lastUsed));
+  }
+
+  // a crash while writing must not cost the hashes of every icon
+  const std::string filename = m_settings->m_instanceDirectory + "icons.idx";
+  const std::string tempFile = filename + ".tmp";
+  kodi::vfs::CFile file;
+  if (!file.OpenFileForWrite(tempFile, true))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot write icons.idx");
+    return;
+  }
+  const bool written = file.Write(text.c_str(), text.length()) == static_cast<ssize_t>(text.length());
+  file.Close();
+  if (!written || !kodi::vfs::RenameFile(tempFile, filename))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot replace icons.idx");
+    kodi::vfs::DeleteFile(tempFile);
+    return;
+  }
+  m_indexDirty = false;
+}
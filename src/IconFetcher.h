@@ -0,0 +1,113 @@
+/*
+ *  Copyright (C) 2020-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+
+#pragma once
+
+#include "BackendRequest.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace NextPVR
+{
+
+  /*
+   * Downloads channel icons on a small worker pool so a channel list can be
+   * returned before its icons exist.  Each icon is written to a temporary
+   * file and renamed into place, and the batch callback runs once when the
+   * queue drains after at least one icon changed.
+   *
+   * icons.idx records a content hash, fetch time, size and last use for each
+   * icon.  When the channel list changes every indexed icon is fetched again
+   * and only replaced if its hash differs, and channels whose first fetch
+   * failed are tried again.  Once the set outgrows the icon
+   * cache size setting the icons of channels no longer in the lineup are
+   * deleted, least recently used first.  Icons of the current lineup are
+   * never deleted, Kodi would only ask for them again.
+   */
+  class ATTR_DLL_LOCAL IconFetcher
+  {
+  public:
+    IconFetcher(const std::shared_ptr<InstanceSettings>& settings, Request& request, const std::function<void()>& batchComplete);
+    ~IconFetcher();
+
+    std::string GetFileName(int channelID) const;
+    void Use(int channelID);
+    void Queue(int channelID);
+    void Revalidate(time_t updateTime);
+    // the channels Kodi was last given, nothing is evicted before it is known
+    void SetLineup(const std::vector<int>& channelIDs);
+    void Forget(int channelID);
+    void ForgetAll();
+    // ends the downloads and joins the workers, later requests start them again
+    void Stop();
+
+  private:
+    IconFetcher(IconFetcher const&) = delete;
+    void operator=(IconFetcher const&) = delete;
+
+    enum eFetchResult
+    {
+      FetchFailed = 0,
+      FetchUnchanged = 1,
+      FetchChanged = 2
+    };
+
+    struct IconJob
+    {
+      int channelID;
+      bool revalidate;
+    };
+
+    struct IconEntry
+    {
+      uint64_t hash;
+      time_t fetched;
+      uint32_t size;
+      time_t lastUsed;
+    };
+
+    void QueueLocked(int channelID, bool revalidate);
+    void Worker();
+    eFetchResult Fetch(const IconJob& job);
+    void LoadIndexLocked();
+    void SaveIndexLocked();
+    void EvictLocked();
+
+    const std::shared_ptr<InstanceSettings> m_settings;
+    Request& m_request;
+    std::function<void()> m_batchComplete;
+
+    std::mutex m_mutex;
+    std::condition_variable m_queued;
+    std::deque<IconJob> m_queue;
+    std::unordered_set<int> m_pending;
+    // channels whose first fetch failed, not asked again until the next revalidation
+    std::unordered_set<int> m_skipped;
+    std::unordered_set<int> m_lineup;
+    bool m_lineupKnown = false;
+    std::vector<std::thread> m_workers;
+    int m_busy = 0;
+    int m_changed = 0;
+    bool m_stopping = false;
+
+    std::map<int, IconEntry> m_index;
+    time_t m_validatedUpdate = 0;
+    bool m_indexLoaded = false;
+    bool m_indexDirty = false;
+  };
+} // namespace NextPVR
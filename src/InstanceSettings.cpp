@@ -87,6 +87,9 @@ void InstanceSettings::ReadFromAddon()
 
   m_backendResume = ReadBoolSetting("backendresume", true);
 
+  m_backendConcurrency = ReadIntSetting("backendconcurrency", 4);
+  m_iconCacheSize = ReadIntSetting("iconcachesize", 50);
+
   m_connectionConfirmed = kodi::vfs::FileExists(m_instanceDirectory + connectionFlag);
 
   if (m_PIN != "0000" && m_remoteAccess)
@@ -110,6 +113,11 @@ void InstanceSettings::ReadFromAddon()
 
   m_castcrew = ReadBoolSetting("castcrew", false);
 
+  m_guidePrefetch = ReadBoolSetting("guideprefetch", true);
+  m_epgUpdateRate = ReadIntSetting("epgupdaterate", 10);
+  m_epgUpdatePause = ReadBoolSetting("epgupdatepause", false);
+  m_epgPriorityGroup = ReadStringSetting("epgprioritygroup", "");
+
   m_useLiveStreams = ReadBoolSetting("uselivestreams", false);
 
   if (m_instanceNumber != ReadIntSetting("instance", 0))
@@ -311,6 +319,14 @@ ADDON_STATUS InstanceSettings::SetValue(const std::string& settingName, const ko
     return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_guideArtPortrait, ADDON_STATUS_NEED_SETTINGS, ADDON_STATUS_OK);
   else if (settingName == "castcrew")
     return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_castcrew, ADDON_STATUS_NEED_RESTART, ADDON_STATUS_OK);
+  else if (settingName == "guideprefetch")
+    return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_guidePrefetch, ADDON_STATUS_NEED_RESTART, ADDON_STATUS_OK);
+  else if (settingName == "epgupdaterate")
+    return SetSetting<int, ADDON_STATUS>(settingName, settingValue, m_epgUpdateRate, ADDON_STATUS_OK, ADDON_STATUS_OK);
+  else if (settingName == "epgupdatepause")
+    return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_epgUpdatePause, ADDON_STATUS_OK, ADDON_STATUS_OK);
+  else if (settingName == "epgprioritygroup")
+    return SetStringSetting<ADDON_STATUS>(settingName, settingValue, m_epgPriorityGroup, ADDON_STATUS_OK, ADDON_STATUS_OK);
   else if (settingName == "recordingsize")
     return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_showRecordingSize, ADDON_STATUS_NEED_SETTINGS, ADDON_STATUS_OK);
   else if (settingName == "diskspace")
@@ -343,6 +359,10 @@ ADDON_STATUS InstanceSettings::SetValue(const std::string& settingName, const ko
     return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_addChannelInstance, ADDON_STATUS_OK, ADDON_STATUS_OK);
   else if (settingName == "instancegroup")
     return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_allChannels, ADDON_STATUS_OK, ADDON_STATUS_OK);
+  else if (settingName == "backendconcurrency")
+    return SetSetting<int, ADDON_STATUS>(settingName, settingValue, m_backendConcurrency, ADDON_STATUS_OK, ADDON_STATUS_OK);
+  else if (settingName == "iconcachesize")
+    return SetSetting<int, ADDON_STATUS>(settingName, settingValue, m_iconCacheSize, ADDON_STATUS_OK, ADDON_STATUS_OK);
   else if (settingName == "heartbeat")
     return SetEnumSetting<eHeartbeat, ADDON_STATUS>(settingName, settingValue, m_heartbeat, ADDON_STATUS_NEED_RESTART, ADDON_STATUS_OK);
   return ADDON_STATUS_OK;
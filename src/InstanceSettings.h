@@ -80,6 +80,8 @@ namespace NextPVR
     int m_timeoutWOL = 0;
     bool m_connectionConfirmed = false;
     bool m_backendResume = true;
+    int m_backendConcurrency = 4;
+    int m_iconCacheSize = 50;
 
     //General
     int m_backendVersion = 0;
@@ -104,6 +106,10 @@ namespace NextPVR
     bool m_guideArtPortrait = false;
     bool m_genreString = false;
     bool m_castcrew = false;
+    bool m_guidePrefetch = true;
+    int m_epgUpdateRate = 10;
+    bool m_epgUpdatePause = false;
+    std::string m_epgPriorityGroup;
 
     //Recordings
     bool m_showRecordingSize = false;
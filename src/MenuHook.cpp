@@ -9,10 +9,12 @@
 #include "pvrclient-nextpvr.h"
 #include <kodi/addon-instance/PVR.h>
 #include <kodi/General.h>
+#include <kodi/gui/dialogs/TextViewer.h>
 
 using namespace NextPVR;
-MenuHook::MenuHook(const std::shared_ptr<InstanceSettings>& settings, Recordings& recordings, Channels& channels, cPVRClientNextPVR& pvrclient) :
+MenuHook::MenuHook(const std::shared_ptr<InstanceSettings>& settings, Request& request, Recordings& recordings, Channels& channels, cPVRClientNextPVR& pvrclient) :
   m_settings(settings),
+  m_request(request),
   m_recordings(recordings),
   m_channels(channels),
   m_pvrclient(pvrclient)
@@ -31,7 +33,12 @@ PVR_ERROR MenuHook::CallSettingsMenuHook(const kodi::addon::PVRMenuhook& menuhoo
   }
   else if (menuhook.GetHookId() == PVR_MENUHOOK_SETTING_UPDATE_CHANNNELS)
   {
-    m_pvrclient.TriggerChannelUpdate();
+    // only make Kodi rewrite its channel database when the lineup really moved
+    ChannelDiff diff;
+    if (!m_channels.RefreshChannels(diff) || diff.HasChannelChanges())
+      m_pvrclient.TriggerChannelUpdate();
+    if (diff.HasGroupChanges())
+      m_pvrclient.TriggerChannelGroupsUpdate();
   }
   else if (menuhook.GetHookId() == PVR_MENUHOOK_SETTING_UPDATE_CHANNNEL_GROUPS)
   {
@@ -45,10 +52,31 @@ PVR_ERROR MenuHook::CallSettingsMenuHook(const kodi::addon::PVRMenuhook& menuhoo
   {
     kodi::addon::OpenSettings();
   }
+  else if (menuhook.GetHookId() == PVR_MENUHOOK_SETTING_SHOW_METRICS)
+  {
+    ShowMetrics();
+  }
 
   return PVR_ERROR_NO_ERROR;
 }
 
+void MenuHook::ShowMetrics()
+{
+  std::string text = kodi::tools::StringUtils::Format(kodi::addon::GetLocalizedString(30226).c_str(),
+    m_request.GetQueueDepth(PriorityHigh), m_request.GetQueueDepth(PriorityNormal), m_request.GetQueueDepth(PriorityBulk),
+    m_request.GetPeakQueueDepth(PriorityHigh), m_request.GetPeakQueueDepth(PriorityNormal), m_request.GetPeakQueueDepth(PriorityBulk),
+    m_request.GetPromotions()) + "\n";
+  text += kodi::tools::StringUtils::Format(kodi::addon::GetLocalizedString(30227).c_str(), m_request.GetCacheStats().c_str()) + "\n";
+  text += m_pvrclient.GetEpgUpdateProgress() + "\n\n";
+  text += m_request.GetMetrics().GetSummary();
+
+  const std::string filename = m_settings->m_instanceDirectory + "metrics.json";
+  if (m_request.GetMetrics().WriteJSON(filename))
+    text += "\n" + kodi::tools::StringUtils::Format(kodi::addon::GetLocalizedString(30230).c_str(), filename.c_str());
+
+  kodi::gui::dialogs::TextViewer::Show(kodi::addon::GetLocalizedString(30220), text);
+}
+
 PVR_ERROR MenuHook::CallRecordingsMenuHook(const kodi::addon::PVRMenuhook& menuhook, const kodi::addon::PVRRecording& item)
 {
   if (menuhook.GetHookId() == PVR_MENUHOOK_RECORDING_FORGET_RECORDING)
@@ -87,6 +115,11 @@ void MenuHook::ConfigureMenuHook()
   menuHook.SetLocalizedStringId(30186);
   m_pvrclient.AddMenuHook(menuHook);
 
+  menuHook.SetCategory(PVR_MENUHOOK_SETTING);
+  menuHook.SetHookId(PVR_MENUHOOK_SETTING_SHOW_METRICS);
+  menuHook.SetLocalizedStringId(30220);
+  m_pvrclient.AddMenuHook(menuHook);
+
   if (m_settings->m_enableWOL)
   {
     menuHook.SetCategory(PVR_MENUHOOK_SETTING);
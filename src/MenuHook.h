@@ -22,11 +22,12 @@ namespace NextPVR
   constexpr int PVR_MENUHOOK_SETTING_UPDATE_CHANNNEL_GROUPS = 603;
   constexpr int PVR_MENUHOOK_SETTING_SEND_WOL = 604;
   constexpr int PVR_MENUHOOK_SETTING_OPEN_SETTINGS = 605;
+  constexpr int PVR_MENUHOOK_SETTING_SHOW_METRICS = 606;
 
   class ATTR_DLL_LOCAL MenuHook
   {
   public:
-    MenuHook(const std::shared_ptr<InstanceSettings>& settings, Recordings& recordings, Channels& channels, cPVRClientNextPVR& pvrclient);
+    MenuHook(const std::shared_ptr<InstanceSettings>& settings, Request& request, Recordings& recordings, Channels& channels, cPVRClientNextPVR& pvrclient);
 
     PVR_ERROR CallChannelMenuHook(const kodi::addon::PVRMenuhook& menuhook, const kodi::addon::PVRChannel& item);
     PVR_ERROR CallRecordingsMenuHook(const kodi::addon::PVRMenuhook& menuhook, const kodi::addon::PVRRecording& item);
@@ -39,7 +40,9 @@ namespace NextPVR
     MenuHook() = default;
     MenuHook(MenuHook const&) = delete;
     void operator=(MenuHook const&) = delete;
+    void ShowMetrics();
     std::shared_ptr<InstanceSettings> m_settings;
+    Request& m_request;
     Recordings& m_recordings;
     Channels& m_channels;
     cPVRClientNextPVR& m_pvrclient;
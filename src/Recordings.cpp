@@ -6,12 +6,13 @@
  */
 
 #include "Recordings.h"
+#include "utilities/FieldScanners.h"
+#include "utilities/XMLRecordFields.h"
 #include "utilities/XMLUtils.h"
 
 #include <kodi/General.h>
 #include "pvrclient-nextpvr.h"
 
-#include <regex>
 #include <unordered_set>
 
 #include <kodi/tools/StringUtils.h>
@@ -19,6 +20,41 @@
 using namespace NextPVR;
 using namespace NextPVR::utilities;
 
+namespace
+{
+enum eRecordingField
+{
+  RecordingStartTime = 0,
+  RecordingStatus,
+  RecordingDuration,
+  RecordingPostPadding,
+  RecordingDesc,
+  RecordingReason,
+  RecordingEpgEndTime,
+  RecordingEpgEventOid,
+  RecordingId,
+  RecordingSubtitle,
+  RecordingYear,
+  RecordingOriginal,
+  RecordingPlaybackPosition,
+  RecordingPlayed,
+  RecordingChannelId,
+  RecordingChannel,
+  RecordingFile,
+  RecordingSize,
+  RecordingGroup,
+  RecordingGenres,
+  RecordingSignificance,
+  RECORDING_FIELDS
+};
+
+constexpr auto RECORDING_TABLE = MakeFieldTable("start_time_ticks", "status", "duration_seconds", "post_padding", "desc",
+                                                 "reason", "epg_end_time_ticks", "epg_event_oid", "id", "subtitle", "year",
+                                                 "original", "playback_position", "played", "channel_id", "channel", "file",
+                                                 "size", "group", "genres", "significance");
+static_assert(RECORDING_TABLE.names.size() == RECORDING_FIELDS, "every recording field needs a name");
+} // unnamed namespace
+
 /************************************************************/
 /** Record handling **/
 
@@ -153,20 +189,42 @@ PVR_ERROR Recordings::GetRecordings(bool deleted, kodi::addon::PVRRecordingsResu
       }
     }
   }
-  if (m_request.DoMethodRequest("recording.list&filter=all", doc) == tinyxml2::XML_SUCCESS)
+  // without flattening or season grouping each recording stands alone, so stream the list
+  const bool streamRecordings = !m_settings->m_flattenRecording && !m_settings->m_separateSeasons;
+  tinyxml2::XMLError retError;
+  if (streamRecordings)
   {
-    tinyxml2::XMLNode* recordingsNode = doc.RootElement()->FirstChildElement("recordings");
-    tinyxml2::XMLNode* pRecordingNode;
-    std::map<std::string, int> names;
-    std::map<std::string, int> seasons;
-    if (m_settings->m_flattenRecording || m_settings->m_separateSeasons)
+    retError = m_request.DoMethodRequest("recording.list&filter=all", "recording", [&](tinyxml2::XMLElement* pRecordingNode)
     {
+      kodi::addon::PVRRecording tag;
+      std::string title;
+      XMLUtils::GetString(pRecordingNode, "name", title);
+      if (UpdatePvrRecording(pRecordingNode, tag, title, false, false))
+      {
+        recordingCount++;
+        results.Add(tag);
+      }
+    });
+  }
+  else
+  {
+    retError = m_request.DoMethodRequest("recording.list&filter=all", doc);
+  }
+  if (retError == tinyxml2::XML_SUCCESS)
+  {
+    if (!streamRecordings)
+    {
+      tinyxml2::XMLNode* recordingsNode = doc.RootElement()->FirstChildElement("recordings");
+      tinyxml2::XMLNode* pRecordingNode;
+      std::map<std::string, int> names;
+      std::map<std::string, int> seasons;
       kodi::addon::PVRRecording mytag;
       int season;
       for (pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
       {
+        const XMLRecordFields<RECORDING_FIELDS> fields(pRecordingNode, RECORDING_TABLE);
         std::string status;
-        XMLUtils::GetString(pRecordingNode, "status", status);
+        fields.GetString(RecordingStatus, status);
         if (status != "Ready" && status != "Recording")
           continue;
         std::string title;
@@ -174,7 +232,11 @@ PVR_ERROR Recordings::GetRecordings(bool deleted, kodi::addon::PVRRecordingsResu
         if (m_settings->m_flattenRecording)
           names[title]++;
 
-        if (ParseNextPVRSubtitle(pRecordingNode, mytag))
+        std::string subtitle;
+        std::string recordingFile;
+        fields.GetString(RecordingSubtitle, subtitle);
+        fields.GetString(RecordingFile, recordingFile);
+        if (ParseNextPVRSubtitle(subtitle, recordingFile, mytag))
           season = mytag.GetSeriesNumber();
         else
           season = PVR_RECORDING_INVALID_SERIES_EPISODE;
@@ -192,16 +254,16 @@ PVR_ERROR Recordings::GetRecordings(bool deleted, kodi::addon::PVRRecordingsResu
           seasons[title] = season;
         }
       }
-    }
-    for (pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
-    {
-      kodi::addon::PVRRecording tag;
-      std::string title;
-      XMLUtils::GetString(pRecordingNode, "name", title);
-      if (UpdatePvrRecording(pRecordingNode, tag, title, names[title] == 1, seasons[title] == std::numeric_limits<int>::max()))
+      for (pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
       {
-        recordingCount++;
-        results.Add(tag);
+        kodi::addon::PVRRecording tag;
+        std::string title;
+        XMLUtils::GetString(pRecordingNode, "name", title);
+        if (UpdatePvrRecording(pRecordingNode, tag, title, names[title] == 1, seasons[title] == std::numeric_limits<int>::max()))
+        {
+          recordingCount++;
+          results.Add(tag);
+        }
       }
     }
     m_iRecordingCount = recordingCount;
@@ -236,30 +298,29 @@ PVR_ERROR Recordings::GetRecordingsLastPlayedPosition()
 
 bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRRecording& tag, const std::string& title, bool flatten, bool multipleSeasons)
 {
+  const XMLRecordFields<RECORDING_FIELDS> fields(pRecordingNode, RECORDING_TABLE);
   std::string buffer;
   tag.SetTitle(title);
 
-  XMLUtils::GetString(pRecordingNode, "start_time_ticks", buffer);
-  try {
-    tag.SetRecordingTime(std::stol(buffer));
-  }
-  catch (int e) {
-    kodi::Log(ADDON_LOG_ERROR, "Invalid start time %s", buffer.c_str());
-  }
+  int64_t startTime;
+  if (fields.GetLong(RecordingStartTime, startTime))
+    tag.SetRecordingTime(startTime);
+  else
+    kodi::Log(ADDON_LOG_ERROR, "Missing start time for %s", title.c_str());
 
   std::string status;
-  XMLUtils::GetString(pRecordingNode, "status", status);
+  fields.GetString(RecordingStatus, status);
   if (status == "Pending" && tag.GetRecordingTime() > time(nullptr) + m_settings->m_serverTimeOffset)
   {
     // skip timers
     return false;
   }
 
-  tag.SetDuration(XMLUtils::GetIntValue(pRecordingNode, "duration_seconds"));
+  tag.SetDuration(fields.GetIntValue(RecordingDuration));
 
   if (status == "Recording")
   {
-    tag.SetDuration(tag.GetDuration() + 60 * XMLUtils::GetIntValue(pRecordingNode, "post_padding"));
+    tag.SetDuration(tag.GetDuration() + 60 * fields.GetIntValue(RecordingPostPadding));
   }
 
   if (status == "Ready" || status == "Pending" || status == "Recording")
@@ -270,7 +331,7 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
       tag.SetDirectory(buffer);
     }
     buffer.clear();
-    if (XMLUtils::GetString(pRecordingNode, "desc", buffer))
+    if (fields.GetString(RecordingDesc, buffer))
     {
       tag.SetPlot(buffer);
     }
@@ -279,7 +340,7 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
   {
     buffer = kodi::tools::StringUtils::Format("/%s/%s", kodi::addon::GetLocalizedString(30166).c_str(), title.c_str());
     tag.SetDirectory(buffer);
-    if (XMLUtils::GetString(pRecordingNode, "reason", buffer))
+    if (fields.GetString(RecordingReason, buffer))
     {
       tag.SetPlot(buffer);
     }
@@ -300,7 +361,7 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
   }
 
   // v4 users won't see recently concluded recordings on the EPG
-  int endEpgTime = XMLUtils::GetIntValue(pRecordingNode, "epg_end_time_ticks");
+  int endEpgTime = fields.GetIntValue(RecordingEpgEndTime);
   if (endEpgTime > time(nullptr) - 24 * 3600)
   {
     tag.SetEPGEventId(endEpgTime);
@@ -310,7 +371,7 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
   else if (status == "Recording" || status == "Pending")
   {
     // check for EPG based recording
-    tag.SetEPGEventId(XMLUtils::GetIntValue(pRecordingNode, "epg_event_oid", PVR_TIMER_NO_EPG_UID));
+    tag.SetEPGEventId(fields.GetIntValue(RecordingEpgEventOid, PVR_TIMER_NO_EPG_UID));
     if (tag.GetEPGEventId() != PVR_TIMER_NO_EPG_UID)
     {
       tag.SetEPGEventId(tag.GetRecordingTime() + tag.GetDuration());
@@ -318,10 +379,14 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
   }
 
   buffer.clear();
-  XMLUtils::GetString(pRecordingNode, "id", buffer);
+  fields.GetString(RecordingId, buffer);
   tag.SetRecordingId(buffer);
 
-  if (ParseNextPVRSubtitle(pRecordingNode, tag))
+  std::string subtitle;
+  std::string recordingFile;
+  fields.GetString(RecordingSubtitle, subtitle);
+  const bool hasFile = fields.GetString(RecordingFile, recordingFile);
+  if (ParseNextPVRSubtitle(subtitle, recordingFile, tag))
   {
     if (m_settings->m_separateSeasons && multipleSeasons && tag.GetSeriesNumber() != PVR_RECORDING_INVALID_SERIES_EPISODE)
     {
@@ -332,18 +397,18 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
     }
   }
 
-  tag.SetYear(XMLUtils::GetIntValue(pRecordingNode, "year"));
+  tag.SetYear(fields.GetIntValue(RecordingYear));
 
   std::string original;
-  XMLUtils::GetString(pRecordingNode, "original", original);
+  fields.GetString(RecordingOriginal, original);
   tag.SetFirstAired(original);
 
   if (m_settings->m_backendResume)
   {
     tag.SetPlayCount(0);
-    tag.SetLastPlayedPosition(XMLUtils::GetIntValue(pRecordingNode, "playback_position"));
+    tag.SetLastPlayedPosition(fields.GetIntValue(RecordingPlaybackPosition));
     bool played = false;
-    if (XMLUtils::GetBoolean(pRecordingNode, "played", played))
+    if (fields.GetBoolean(RecordingPlayed, played))
     {
       if (tag.GetLastPlayedPosition() >= tag.GetDuration() - 60)
       {
@@ -356,20 +421,19 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
   }
 
 
-  tag.SetChannelUid(XMLUtils::GetIntValue(pRecordingNode, "channel_id"));
+  tag.SetChannelUid(fields.GetIntValue(RecordingChannelId));
   if (tag.GetChannelUid() == 0)
     tag.SetChannelUid(PVR_CHANNEL_INVALID_UID);
   else
     tag.SetIconPath(m_channels.GetChannelIconFileName(tag.GetChannelUid()));
 
-  buffer.clear();
-  if (XMLUtils::GetString(pRecordingNode, "channel", buffer))
+  std::string_view channelName;
+  if (fields.GetView(RecordingChannel, channelName))
   {
-    tag.SetChannelName(buffer);
+    tag.SetChannelName(std::string(channelName));
   }
   tag.SetSizeInBytes(0);
-  std::string recordingFile;
-  if (XMLUtils::GetString(pRecordingNode, "file", recordingFile))
+  if (hasFile)
   {
     if (m_settings->m_showRoot && status != "Failed")
     {
@@ -392,7 +456,7 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
     }
 
     int64_t filesize = 0;
-    if (XMLUtils::GetLong(pRecordingNode, "size", filesize))
+    if (fields.GetLong(RecordingSize, filesize))
     {
       tag.SetSizeInBytes(filesize);
     }
@@ -428,33 +492,33 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
   {
     std::string artworkPath;
     std::string name;
-    buffer.clear();
-    if (XMLUtils::GetString(pRecordingNode, "group", buffer))
-        name = UriEncode(buffer);
+    std::string_view group;
+    if (fields.GetView(RecordingGroup, group))
+        name = UriEncode(std::string(group));
     else
         name = UriEncode(title);
 
     if (m_settings->m_sendSidWithMetadata)
-      artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&sid=%s&name=%s", m_settings->m_urlBase, m_request.GetSID(), name.c_str());
+      artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&sid=%s&name=%s", m_settings->m_urlBase, m_request.GetSID().c_str(), name.c_str());
     else
       artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&name=%s", m_settings->m_urlBase, name.c_str());
     tag.SetFanartPath(artworkPath + "&prefer=fanart");
     tag.SetThumbnailPath(artworkPath + "&prefer=poster");
   }
-  if (XMLUtils::GetAdditiveString(pRecordingNode->FirstChildElement("genres"), "genre", EPG_STRING_TOKEN_SEPARATOR, buffer, true))
+  if (XMLUtils::GetAdditiveString(fields.Element(RecordingGenres), "genre", EPG_STRING_TOKEN_SEPARATOR, buffer, true))
   {
     tag.SetGenreType(EPG_GENRE_USE_STRING);
     tag.SetGenreSubType(0);
     tag.SetGenreDescription(buffer);
   }
 
-  std::string significance;
-  XMLUtils::GetString(pRecordingNode, "significance", significance);
-  if (significance.find("Premiere") != std::string::npos)
+  std::string_view significance;
+  fields.GetView(RecordingSignificance, significance);
+  if (significance.find("Premiere") != std::string_view::npos)
   {
     tag.SetFlags(PVR_RECORDING_FLAG_IS_PREMIERE);
   }
-  else if (significance.find("Finale") != std::string::npos)
+  else if (significance.find("Finale") != std::string_view::npos)
   {
     tag.SetFlags(PVR_RECORDING_FLAG_IS_FINALE);
   }
@@ -462,75 +526,51 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
   return true;
 }
 
-bool Recordings::ParseNextPVRSubtitle(const tinyxml2::XMLNode *pRecordingNode, kodi::addon::PVRRecording& tag)
+bool Recordings::ParseNextPVRSubtitle(const std::string& subtitle, const std::string& recordingFile, kodi::addon::PVRRecording& tag)
 {
-  std::string buffer;
   bool hasSeasonEpisode = false;
-  if (XMLUtils::GetString(pRecordingNode, "subtitle", buffer))
+  if (!subtitle.empty())
   {
-    static std::regex base_regex("S(\\d{2,4})E(\\d+)(?: - ?(.+)$)?");
-    std::smatch base_match;
+    SeasonEpisode seasonEpisode;
     // note NextPVR does not support S0 for specials
-    if (std::regex_search(buffer, base_match, base_regex))
+    if (ScanSeasonEpisode(subtitle, true, seasonEpisode))
     {
-      if (base_match.size() == 3 || base_match.size() == 4)
+      if (seasonEpisode.season != 0)
       {
-        std::ssub_match base_sub_match = base_match[1];
-        int season = std::stoi(base_sub_match.str());
-        if (season != 0)
-        {
-          tag.SetSeriesNumber(season);
-          hasSeasonEpisode = true;
-        }
-        base_sub_match = base_match[2];
-        tag.SetEpisodeNumber(std::stoi(base_sub_match.str()));
-        if (base_match[3].matched)
-        {
-          base_sub_match = base_match[3];
-          tag.SetEpisodeName(base_sub_match.str());
-        }
+        tag.SetSeriesNumber(seasonEpisode.season);
+        hasSeasonEpisode = true;
       }
+      tag.SetEpisodeNumber(seasonEpisode.episode);
+      if (seasonEpisode.hasName)
+        tag.SetEpisodeName(seasonEpisode.name);
     }
     else
     {
-      tag.SetEpisodeName(buffer);
+      tag.SetEpisodeName(subtitle);
     }
   }
 
   if (!hasSeasonEpisode)
   {
-    std::string recordingFile;
-    if (XMLUtils::GetString(pRecordingNode, "file", recordingFile))
+    if (!recordingFile.empty())
     {
-      static std::regex base_regex("S(\\d{2,4})E(\\d+)");
-      std::smatch base_match;
-      if (std::regex_search(recordingFile, base_match, base_regex))
+      SeasonEpisode seasonEpisode;
+      if (ScanSeasonEpisode(recordingFile, false, seasonEpisode))
       {
-        if (base_match.size() == 3)
-        {
-          std::ssub_match base_sub_match = base_match[1];
-          tag.SetSeriesNumber(std::stoi(base_sub_match.str()));
-          base_sub_match = base_match[2];
-          tag.SetEpisodeNumber(std::stoi(base_sub_match.str()));
-          hasSeasonEpisode = true;
-        }
+        tag.SetSeriesNumber(seasonEpisode.season);
+        tag.SetEpisodeNumber(seasonEpisode.episode);
+        hasSeasonEpisode = true;
       }
     }
     const std::string plot = tag.GetPlot();
     if (tag.GetEpisodeNumber() == PVR_RECORDING_INVALID_SERIES_EPISODE && !plot.empty());
     {
-      static std::regex base_regex("^.*\\([eE][pP](\\d+)(?:/?(\\d+))?\\)");
-      std::smatch base_match;
-      if (std::regex_search(plot, base_match, base_regex))
-      {
-        tag.SetEpisodeNumber(std::atoi(base_match[1].str().c_str()));
-        if (base_match[2].matched)
-          tag.SetEpisodePartNumber(std::atoi(base_match[2].str().c_str()));
-      }
-      else if (std::regex_search(plot, base_match, std::regex("^([1-9]\\d*)/([1-9]\\d*)\\.")))
+      int episode = tag.GetEpisodeNumber();
+      int part = tag.GetEpisodePartNumber();
+      if (ScanEpisodeMarker(plot, episode, part) || ScanEpisodeFraction(plot, episode, part))
       {
-        tag.SetEpisodeNumber(std::atoi(base_match[1].str().c_str()));
-        tag.SetEpisodePartNumber(std::atoi(base_match[2].str().c_str()));
+        tag.SetEpisodeNumber(episode);
+        tag.SetEpisodePartNumber(part);
       }
     }
   }
@@ -34,7 +34,7 @@ namespace NextPVR
     PVR_ERROR GetRecordingEdl(const kodi::addon::PVRRecording& recording, std::vector<kodi::addon::PVREDLEntry>& edl);
     PVR_ERROR GetRecordingStreamProperties(const PVR_RECORDING*, PVR_NAMED_VALUE*, unsigned int*);
     bool UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRRecording& tag, const std::string& title, bool flatten, bool multipleSeasons);
-    bool ParseNextPVRSubtitle(const tinyxml2::XMLNode*, kodi::addon::PVRRecording& tag);
+    bool ParseNextPVRSubtitle(const std::string& subtitle, const std::string& recordingFile, kodi::addon::PVRRecording& tag);
     bool ForgetRecording(const kodi::addon::PVRRecording& recording);
     std::map<std::string, std::string> m_hostFilenames;
 
@@ -6,6 +6,7 @@
  */
 
 #include "Timers.h"
+#include "utilities/XMLRecordFields.h"
 #include "utilities/XMLUtils.h"
 
 #include "pvrclient-nextpvr.h"
@@ -16,6 +17,64 @@
 using namespace NextPVR;
 using namespace NextPVR::utilities;
 
+namespace
+{
+enum eRecurringField
+{
+  RecurringId = 0,
+  RecurringType,
+  RecurringName,
+  RecurringMatchRules,
+  RECURRING_FIELDS
+};
+
+constexpr auto RECURRING_TABLE = MakeFieldTable("id", "type", "name", "matchrules");
+static_assert(RECURRING_TABLE.names.size() == RECURRING_FIELDS, "every recurring field needs a name");
+
+enum eRuleField
+{
+  RuleChannelOID = 0,
+  RuleEPGTitle,
+  RuleStartTimeTicks,
+  RuleEndTimeTicks,
+  RuleAdvancedRules,
+  RuleDays,
+  RulePrePadding,
+  RulePostPadding,
+  RuleKeep,
+  RuleOnlyNewEpisodes,
+  RuleRecordingDirectoryID,
+  RULE_FIELDS
+};
+
+constexpr auto RULE_TABLE = MakeFieldTable("ChannelOID", "EPGTitle", "StartTimeTicks", "EndTimeTicks", "AdvancedRules", "Days",
+                                           "PrePadding", "PostPadding", "Keep", "OnlyNewEpisodes", "RecordingDirectoryID");
+static_assert(RULE_TABLE.names.size() == RULE_FIELDS, "every rule field needs a name");
+
+enum eTimerField
+{
+  TimerId = 0,
+  TimerChannelId,
+  TimerRecurringParent,
+  TimerPrePadding,
+  TimerPostPadding,
+  TimerName,
+  TimerDesc,
+  TimerStartTime,
+  TimerDuration,
+  TimerEpgEventOid,
+  TimerEpgEndTime,
+  TimerStatus,
+  TimerDirectory,
+  TIMER_FIELDS
+};
+
+constexpr auto TIMER_TABLE = MakeFieldTable("id", "channel_id", "recurring_parent", "pre_padding", "post_padding", "name", "desc",
+                                            "start_time_ticks", "duration_seconds", "epg_event_oid", "epg_end_time_ticks",
+                                            "status", "directory");
+static_assert(TIMER_TABLE.names.size() == TIMER_FIELDS, "every timer field needs a name");
+} // unnamed namespace
+
 /************************************************************/
 /** Timer handling */
 
@@ -76,187 +135,39 @@ PVR_ERROR Timers::GetTimers(kodi::addon::PVRTimersResultSet& results)
 {
   PVR_ERROR returnValue = PVR_ERROR_NO_ERROR;
   int timerCount = 0;
-  // first add the recurring recordings
-  tinyxml2::XMLDocument doc;
-  if (m_request.DoMethodRequest("recording.recurring.list", doc) == tinyxml2::XML_SUCCESS)
+  // first add the recurring recordings, each timer is passed on as soon as it has downloaded
+  tinyxml2::XMLError status = m_request.DoMethodRequest("recording.recurring.list", "recurring", [&](tinyxml2::XMLElement* pRecurringNode)
   {
-    tinyxml2::XMLNode* recurringsNode = doc.RootElement()->FirstChildElement("recurrings");
-    tinyxml2::XMLNode* pRecurringNode;
-    for (pRecurringNode = recurringsNode->FirstChildElement("recurring"); pRecurringNode; pRecurringNode = pRecurringNode->NextSiblingElement())
+    kodi::addon::PVRTimer tag;
+    UpdatePvrRecurringTimer(pRecurringNode, tag);
+    // pass timer to xbmc
+    timerCount++;
+    results.Add(tag);
+  });
+  if (status == tinyxml2::XML_SUCCESS)
+  {
+    // next add the one-off recordings.
+    bool isRecordingUpdated = false;
+    m_request.DoMethodRequest("recording.list&filter=pending", "recording", [&](tinyxml2::XMLElement* pRecordingNode)
     {
       kodi::addon::PVRTimer tag;
-      tinyxml2::XMLNode* pMatchRulesNode = pRecurringNode->FirstChildElement("matchrules");
-      tinyxml2::XMLNode* pRulesNode = pMatchRulesNode->FirstChildElement("Rules");
-
-      tag.SetClientIndex(XMLUtils::GetUIntValue(pRecurringNode, "id"));
-      int channelUID = XMLUtils::GetIntValue(pRulesNode, "ChannelOID");
-      if (channelUID == 0)
-      {
-        tag.SetClientChannelUid(PVR_TIMER_ANY_CHANNEL);
-      }
-      else if (m_channels.m_channelDetails.find(channelUID) == m_channels.m_channelDetails.end())
-      {
-        kodi::Log(ADDON_LOG_DEBUG, "Invalid channel uid %d", channelUID);
-        tag.SetClientChannelUid(PVR_CHANNEL_INVALID_UID);
-      }
-      else
-      {
-        tag.SetClientChannelUid(channelUID);
-      }
-      tag.SetTimerType(pRulesNode->FirstChildElement("EPGTitle") ? TIMER_REPEATING_EPG : TIMER_REPEATING_MANUAL);
-
-      std::string buffer;
-
-      // start/end time
-
-      const int recordingType = XMLUtils::GetUIntValue(pRecurringNode, "type");
-
-      if (recordingType == 1 || recordingType == 2)
-      {
-        tag.SetStartTime(TIMER_DATE_MIN);
-        tag.SetEndTime(TIMER_DATE_MIN);
-        tag.SetStartAnyTime(true);
-        tag.SetEndAnyTime(true);
-        if (recordingType == 2)
-        {
-          tag.SetTimerType(TIMER_REPEATING_EPG_ALL_EPISODES);
-        }
-      }
-      else
-      {
-        if (XMLUtils::GetString(pRulesNode, "StartTimeTicks", buffer))
-          tag.SetStartTime(stoll(buffer));
-        if (XMLUtils::GetString(pRulesNode, "EndTimeTicks", buffer))
-          tag.SetEndTime(stoll(buffer));
-        if (recordingType == 7)
-        {
-          tag.SetEPGSearchString(TYPE_7_TITLE);
-        }
-      }
-
-      // keyword recordings
-      std::string advancedRulesText;
-      if (XMLUtils::GetString(pRulesNode, "AdvancedRules", advancedRulesText))
-      {
-        if (advancedRulesText.find("KEYWORD: ") != std::string::npos)
-        {
-          tag.SetTimerType(TIMER_REPEATING_KEYWORD);
-          tag.SetStartTime(TIMER_DATE_MIN);
-          tag.SetEndTime(TIMER_DATE_MIN);
-          tag.SetStartAnyTime(true);
-          tag.SetEndAnyTime(true);
-          tag.SetEPGSearchString(advancedRulesText.substr(9));
-        }
-        else
-        {
-          tag.SetTimerType(TIMER_REPEATING_ADVANCED);
-          tag.SetStartTime(TIMER_DATE_MIN);
-          tag.SetEndTime(TIMER_DATE_MIN);
-          tag.SetStartAnyTime(true);
-          tag.SetEndAnyTime(true);
-          tag.SetFullTextEpgSearch(true);
-          tag.SetEPGSearchString(advancedRulesText);
-        }
-      }
-
-      // days
-      tag.SetWeekdays(PVR_WEEKDAY_ALLDAYS);
-      std::string daysText;
-      if (XMLUtils::GetString(pRulesNode, "Days", daysText))
-      {
-        unsigned int weekdays = PVR_WEEKDAY_NONE;
-        if (daysText.find("SUN") != std::string::npos)
-          weekdays |= PVR_WEEKDAY_SUNDAY;
-        if (daysText.find("MON") != std::string::npos)
-          weekdays |= PVR_WEEKDAY_MONDAY;
-        if (daysText.find("TUE") != std::string::npos)
-          weekdays |= PVR_WEEKDAY_TUESDAY;
-        if (daysText.find("WED") != std::string::npos)
-          weekdays |= PVR_WEEKDAY_WEDNESDAY;
-        if (daysText.find("THU") != std::string::npos)
-          weekdays |= PVR_WEEKDAY_THURSDAY;
-        if (daysText.find("FRI") != std::string::npos)
-          weekdays |= PVR_WEEKDAY_FRIDAY;
-        if (daysText.find("SAT") != std::string::npos)
-          weekdays |= PVR_WEEKDAY_SATURDAY;
-        tag.SetWeekdays(weekdays);
-      }
-
-      // pre/post padding
-      tag.SetMarginStart(XMLUtils::GetUIntValue(pRulesNode, "PrePadding"));
-      tag.SetMarginEnd(XMLUtils::GetUIntValue(pRulesNode, "PostPadding"));
-
-      // number of recordings to keep
-      tag.SetMaxRecordings(XMLUtils::GetIntValue(pRulesNode, "Keep"));
-
-      // prevent duplicates
-      bool duplicate;
-      if (XMLUtils::GetBoolean(pRulesNode, "OnlyNewEpisodes", duplicate))
-      {
-        if (duplicate == true)
-        {
-          tag.SetPreventDuplicateEpisodes(1);
-        }
-      }
-
-      std::string recordingDirectoryID;
-      if (XMLUtils::GetString(pRulesNode, "RecordingDirectoryID", recordingDirectoryID))
-      {
-        for (unsigned int i = 0; i < m_settings->m_recordingDirectories.size(); ++i)
-        {
-          std::string bracketed = "[" + m_settings->m_recordingDirectories[i] + "]";
-          if (bracketed == recordingDirectoryID)
-          {
-            tag.SetRecordingGroup(i);
-            break;
-          }
-        }
-      }
-
-      buffer.clear();
-      XMLUtils::GetString(pRecurringNode, "name", buffer);
-      tag.SetTitle(buffer);
-      bool state = true;
-      XMLUtils::GetBoolean(pMatchRulesNode, "enabled", state);
-      if (state == false)
-          tag.SetState(PVR_TIMER_STATE_DISABLED);
-      else
-          tag.SetState(PVR_TIMER_STATE_SCHEDULED);
-      tag.SetSummary("summary");
+      UpdatePvrTimer(pRecordingNode, tag);
       // pass timer to xbmc
       timerCount++;
+      if (tag.GetState() == PVR_TIMER_STATE_RECORDING)
+        isRecordingUpdated = true;
       results.Add(tag);
-    }
-    // next add the one-off recordings.
-    bool isRecordingUpdated = false;
-    doc.Clear();
-    if (m_request.DoMethodRequest("recording.list&filter=pending", doc) == tinyxml2::XML_SUCCESS)
+    });
+    if (m_request.DoMethodRequest("recording.list&filter=conflict", "recording", [&](tinyxml2::XMLElement* pRecordingNode)
     {
-      tinyxml2::XMLNode* recordingsNode = doc.RootElement()->FirstChildElement("recordings");
-      for (tinyxml2::XMLNode* pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
-      {
-        kodi::addon::PVRTimer tag;
-        UpdatePvrTimer(pRecordingNode, tag);
-        // pass timer to xbmc
-        timerCount++;
-        if (tag.GetState() == PVR_TIMER_STATE_RECORDING)
-          isRecordingUpdated = true;
-        results.Add(tag);
-      }
-    }
-    doc.Clear();
-    if (m_request.DoMethodRequest("recording.list&filter=conflict", doc) == tinyxml2::XML_SUCCESS)
+      kodi::addon::PVRTimer tag;
+      UpdatePvrTimer(pRecordingNode, tag);
+      // pass timer to xbmc
+      timerCount++;
+      results.Add(tag);
+    }) == tinyxml2::XML_SUCCESS)
     {
-     tinyxml2::XMLNode* recordingsNode = doc.RootElement()->FirstChildElement("recordings");
-     for (tinyxml2::XMLNode* pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
-     {
-       kodi::addon::PVRTimer tag;
-       UpdatePvrTimer(pRecordingNode, tag);
-       // pass timer to xbmc
-       timerCount++;
-       results.Add(tag);
-     }
-     m_iTimerCount = timerCount;
+      m_iTimerCount = timerCount;
     }
 
     if (isRecordingUpdated) {
@@ -274,12 +185,157 @@ PVR_ERROR Timers::GetTimers(kodi::addon::PVRTimersResultSet& results)
   return returnValue;
 }
 
+void Timers::UpdatePvrRecurringTimer(tinyxml2::XMLNode* pRecurringNode, kodi::addon::PVRTimer& tag)
+{
+  const XMLRecordFields<RECURRING_FIELDS> recurring(pRecurringNode, RECURRING_TABLE);
+  const tinyxml2::XMLElement* pMatchRulesNode = recurring.Element(RecurringMatchRules);
+  const XMLRecordFields<RULE_FIELDS> rules(pMatchRulesNode->FirstChildElement("Rules"), RULE_TABLE);
+
+  tag.SetClientIndex(recurring.GetUIntValue(RecurringId));
+  int channelUID = rules.GetIntValue(RuleChannelOID);
+  if (channelUID == 0)
+  {
+    tag.SetClientChannelUid(PVR_TIMER_ANY_CHANNEL);
+  }
+  else if (m_channels.GetChannelIndex()->Find(channelUID) == nullptr)
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "Invalid channel uid %d", channelUID);
+    tag.SetClientChannelUid(PVR_CHANNEL_INVALID_UID);
+  }
+  else
+  {
+    tag.SetClientChannelUid(channelUID);
+  }
+  tag.SetTimerType(rules.Has(RuleEPGTitle) ? TIMER_REPEATING_EPG : TIMER_REPEATING_MANUAL);
+
+  std::string buffer;
+
+  // start/end time
+
+  const int recordingType = recurring.GetUIntValue(RecurringType);
+
+  if (recordingType == 1 || recordingType == 2)
+  {
+    tag.SetStartTime(TIMER_DATE_MIN);
+    tag.SetEndTime(TIMER_DATE_MIN);
+    tag.SetStartAnyTime(true);
+    tag.SetEndAnyTime(true);
+    if (recordingType == 2)
+    {
+      tag.SetTimerType(TIMER_REPEATING_EPG_ALL_EPISODES);
+    }
+  }
+  else
+  {
+    int64_t ticks;
+    if (rules.GetLong(RuleStartTimeTicks, ticks))
+      tag.SetStartTime(ticks);
+    if (rules.GetLong(RuleEndTimeTicks, ticks))
+      tag.SetEndTime(ticks);
+    if (recordingType == 7)
+    {
+      tag.SetEPGSearchString(TYPE_7_TITLE);
+    }
+  }
+
+  // keyword recordings
+  std::string advancedRulesText;
+  if (rules.GetString(RuleAdvancedRules, advancedRulesText))
+  {
+    if (advancedRulesText.find("KEYWORD: ") != std::string::npos)
+    {
+      tag.SetTimerType(TIMER_REPEATING_KEYWORD);
+      tag.SetStartTime(TIMER_DATE_MIN);
+      tag.SetEndTime(TIMER_DATE_MIN);
+      tag.SetStartAnyTime(true);
+      tag.SetEndAnyTime(true);
+      tag.SetEPGSearchString(advancedRulesText.substr(9));
+    }
+    else
+    {
+      tag.SetTimerType(TIMER_REPEATING_ADVANCED);
+      tag.SetStartTime(TIMER_DATE_MIN);
+      tag.SetEndTime(TIMER_DATE_MIN);
+      tag.SetStartAnyTime(true);
+      tag.SetEndAnyTime(true);
+      tag.SetFullTextEpgSearch(true);
+      tag.SetEPGSearchString(advancedRulesText);
+    }
+  }
+
+  // days
+  tag.SetWeekdays(PVR_WEEKDAY_ALLDAYS);
+  std::string daysText;
+  if (rules.GetString(RuleDays, daysText))
+  {
+    unsigned int weekdays = PVR_WEEKDAY_NONE;
+    if (daysText.find("SUN") != std::string::npos)
+      weekdays |= PVR_WEEKDAY_SUNDAY;
+    if (daysText.find("MON") != std::string::npos)
+      weekdays |= PVR_WEEKDAY_MONDAY;
+    if (daysText.find("TUE") != std::string::npos)
+      weekdays |= PVR_WEEKDAY_TUESDAY;
+    if (daysText.find("WED") != std::string::npos)
+      weekdays |= PVR_WEEKDAY_WEDNESDAY;
+    if (daysText.find("THU") != std::string::npos)
+      weekdays |= PVR_WEEKDAY_THURSDAY;
+    if (daysText.find("FRI") != std::string::npos)
+      weekdays |= PVR_WEEKDAY_FRIDAY;
+    if (daysText.find("SAT") != std::string::npos)
+      weekdays |= PVR_WEEKDAY_SATURDAY;
+    tag.SetWeekdays(weekdays);
+  }
+
+  // pre/post padding
+  tag.SetMarginStart(rules.GetUIntValue(RulePrePadding));
+  tag.SetMarginEnd(rules.GetUIntValue(RulePostPadding));
+
+  // number of recordings to keep
+  tag.SetMaxRecordings(rules.GetIntValue(RuleKeep));
+
+  // prevent duplicates
+  bool duplicate;
+  if (rules.GetBoolean(RuleOnlyNewEpisodes, duplicate))
+  {
+    if (duplicate == true)
+    {
+      tag.SetPreventDuplicateEpisodes(1);
+    }
+  }
+
+  std::string recordingDirectoryID;
+  if (rules.GetString(RuleRecordingDirectoryID, recordingDirectoryID))
+  {
+    for (unsigned int i = 0; i < m_settings->m_recordingDirectories.size(); ++i)
+    {
+      std::string bracketed = "[" + m_settings->m_recordingDirectories[i] + "]";
+      if (bracketed == recordingDirectoryID)
+      {
+        tag.SetRecordingGroup(i);
+        break;
+      }
+    }
+  }
+
+  buffer.clear();
+  recurring.GetString(RecurringName, buffer);
+  tag.SetTitle(buffer);
+  bool state = true;
+  XMLUtils::GetBoolean(pMatchRulesNode, "enabled", state);
+  if (state == false)
+      tag.SetState(PVR_TIMER_STATE_DISABLED);
+  else
+      tag.SetState(PVR_TIMER_STATE_SCHEDULED);
+  tag.SetSummary("summary");
+}
+
 bool Timers::UpdatePvrTimer(tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRTimer& tag)
 {
-  tag.SetTimerType(pRecordingNode->FirstChildElement("epg_event_oid") ? TIMER_ONCE_EPG : TIMER_ONCE_MANUAL);
-  tag.SetClientIndex(XMLUtils::GetUIntValue(pRecordingNode, "id"));
-  tag.SetClientChannelUid(XMLUtils::GetUIntValue(pRecordingNode, "channel_id"));
-  tag.SetParentClientIndex(XMLUtils::GetUIntValue(pRecordingNode, "recurring_parent", PVR_TIMER_NO_PARENT));
+  const XMLRecordFields<TIMER_FIELDS> fields(pRecordingNode, TIMER_TABLE);
+  tag.SetTimerType(fields.Has(TimerEpgEventOid) ? TIMER_ONCE_EPG : TIMER_ONCE_MANUAL);
+  tag.SetClientIndex(fields.GetUIntValue(TimerId));
+  tag.SetClientChannelUid(fields.GetUIntValue(TimerChannelId));
+  tag.SetParentClientIndex(fields.GetUIntValue(TimerRecurringParent, PVR_TIMER_NO_PARENT));
 
   if (tag.GetParentClientIndex() != PVR_TIMER_NO_PARENT)
   {
@@ -289,29 +345,26 @@ bool Timers::UpdatePvrTimer(tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRT
       tag.SetTimerType(TIMER_ONCE_MANUAL_CHILD);
   }
 
-  tag.SetMarginStart(XMLUtils::GetUIntValue(pRecordingNode, "pre_padding"));
-  tag.SetMarginEnd(XMLUtils::GetUIntValue(pRecordingNode, "post_padding"));
+  tag.SetMarginStart(fields.GetUIntValue(TimerPrePadding));
+  tag.SetMarginEnd(fields.GetUIntValue(TimerPostPadding));
 
   std::string buffer;
 
   // name
-  XMLUtils::GetString(pRecordingNode, "name", buffer);
+  fields.GetString(TimerName, buffer);
   tag.SetTitle(buffer);
   buffer.clear();
-  XMLUtils::GetString(pRecordingNode, "desc", buffer);
+  fields.GetString(TimerDesc, buffer);
   tag.SetSummary(buffer);
   // start/end time
-  buffer.clear();
-  XMLUtils::GetString(pRecordingNode, "start_time_ticks", buffer);
-  buffer.resize(10);
-  tag.SetStartTime(std::stoll(buffer));
-  buffer.clear();
-  XMLUtils::GetString(pRecordingNode, "duration_seconds", buffer);
-  tag.SetEndTime(tag.GetStartTime() + std::stoll(buffer));
+  int64_t duration = 0;
+  tag.SetStartTime(fields.GetTime(TimerStartTime));
+  fields.GetLong(TimerDuration, duration);
+  tag.SetEndTime(tag.GetStartTime() + duration);
 
   if (tag.GetTimerType() == TIMER_ONCE_EPG || tag.GetTimerType() == TIMER_ONCE_EPG_CHILD)
   {
-    tag.SetEPGUid(XMLUtils::GetUIntValue(pRecordingNode, "epg_end_time_ticks", PVR_TIMER_NO_EPG_UID));
+    tag.SetEPGUid(fields.GetUIntValue(TimerEpgEndTime, PVR_TIMER_NO_EPG_UID));
 
     // version 4 and some versions of v5 won't support the epg end time
     if (tag.GetEPGUid() == PVR_TIMER_NO_EPG_UID)
@@ -327,7 +380,7 @@ bool Timers::UpdatePvrTimer(tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRT
   tag.SetState(PVR_TIMER_STATE_SCHEDULED);
 
   std::string status;
-  if (XMLUtils::GetString(pRecordingNode, "status", status))
+  if (fields.GetString(TimerStatus, status))
   {
     if (status == "Recording" || (status == "Pending" && tag.GetStartTime() <= time(nullptr) + m_settings->m_serverTimeOffset))
     {
@@ -342,7 +395,7 @@ bool Timers::UpdatePvrTimer(tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRT
   if (status == "Pending")
   {
     std::string directory;
-    if (XMLUtils::GetString(pRecordingNode, "directory", directory))
+    if (fields.GetString(TimerDirectory, directory))
     {
         for (unsigned int i = 0; i < m_settings->m_recordingDirectories.size(); ++i)
         {
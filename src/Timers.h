@@ -70,6 +70,7 @@ namespace NextPVR
     PVR_ERROR DeleteTimer(const kodi::addon::PVRTimer& timer, bool forceDelete);
     PVR_ERROR UpdateTimer(const kodi::addon::PVRTimer& timer);
     bool UpdatePvrTimer(tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRTimer& tag);
+    void UpdatePvrRecurringTimer(tinyxml2::XMLNode* pRecurringNode, kodi::addon::PVRTimer& tag);
     time_t m_lastTimerUpdateTime = 0;
 
   private:
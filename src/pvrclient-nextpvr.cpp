@@ -89,11 +89,11 @@ cPVRClientNextPVR::cPVRClientNextPVR(const CNextPVRAddon& base, const kodi::addo
   m_base(base),
   m_settings(new InstanceSettings(*this, instance, first)),
   m_request(m_settings),
-  m_channels(m_settings, m_request),
+  m_channels(m_settings, m_request, *this),
   m_timers(m_settings, m_request, m_channels, *this),
   m_recordings(m_settings, m_request, m_timers, m_channels, *this),
-  m_menuhook(m_settings, m_recordings, m_channels, *this),
-  m_epg(m_settings, m_request, m_recordings, m_channels)
+  m_menuhook(m_settings, m_request, m_recordings, m_channels, *this),
+  m_epg(m_settings, m_request, m_recordings, m_channels, *this)
 {
   if (!kodi::vfs::DirectoryExists(m_settings->m_instanceDirectory))
   {
@@ -119,6 +119,10 @@ cPVRClientNextPVR::cPVRClientNextPVR(const CNextPVRAddon& base, const kodi::addo
 
 cPVRClientNextPVR::~cPVRClientNextPVR()
 {
+  // these threads call back into the client, they have to end before any of it goes
+  m_channels.StopIconFetcher();
+  m_epg.Stop();
+
   if (m_nowPlaying != NotPlaying)
   {
     // this is likley only needed for transcoding but include all cases
@@ -139,12 +143,13 @@ cPVRClientNextPVR::~cPVRClientNextPVR()
   delete m_recordingBuffer;
   delete m_realTimeBuffer;
   m_recordings.m_hostFilenames.clear();
-  m_channels.m_channelDetails.clear();
-  m_channels.m_liveStreams.clear();
+  m_channels.ClearChannelIndex();
+  m_channels.ClearLiveStreams();
 }
 
 ADDON_STATUS cPVRClientNextPVR::Connect(bool sendWOL)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "Connect");
   m_bConnected = false;
   ADDON_STATUS status = ADDON_STATUS_UNKNOWN;
   // initiate session
@@ -250,6 +255,8 @@ void cPVRClientNextPVR::ResetConnection()
 
 void cPVRClientNextPVR::Disconnect()
 {
+  m_channels.StopIconFetcher();
+  m_epg.Stop();
   if (m_bConnected)
     m_request.DoActionRequest("session.logout");
   if (m_settings->CheckInstanceSettings())
@@ -261,6 +268,7 @@ void cPVRClientNextPVR::Disconnect()
 
 void cPVRClientNextPVR::ConfigurePostConnectionOptions()
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "ConfigurePostConnectionOptions");
   m_settings->SetVersionSpecificSettings();
   if (m_settings->m_liveStreamingMethod != eStreamingMethod::RealTime)
   {
@@ -306,6 +314,7 @@ void cPVRClientNextPVR::ConfigurePostConnectionOptions()
     m_request.GetLastUpdate("system.epg.summary", m_lastEPGUpdateTime);
 
   m_channels.CacheAllChannels(m_lastEPGUpdateTime);
+  m_epg.StartPrefetch(m_lastEPGUpdateTime);
 }
 
 /* IsUp()
@@ -335,18 +344,23 @@ bool cPVRClientNextPVR::IsUp()
           {
             if (lastUpdate > m_lastEPGUpdateTime)
             {
-              // trigger EPG updates for all channels with a guide source
-              kodi::Log(ADDON_LOG_DEBUG, "Trigger EPG update start");
-              int channels = 0;
-              for (const auto& updateChannel : m_channels.m_channelDetails)
+              if (m_settings->m_guidePrefetch)
+              {
+                // the prefetch triggers only the channels whose listings changed
+                m_epg.StartPrefetch(lastUpdate);
+              }
+              else
               {
-                if (updateChannel.second.first == false)
+                // trigger EPG updates for all channels with a guide source
+                std::vector<int> channels;
+                std::shared_ptr<const ChannelIndex> channelIndex = m_channels.GetChannelIndex();
+                for (const ChannelDetail& updateChannel : *channelIndex)
                 {
-                  channels++;
-                  TriggerEpgUpdate(updateChannel.first);
+                  if (updateChannel.epgNone == false)
+                    channels.push_back(updateChannel.uid);
                 }
+                m_epg.GetUpdateScheduler().Queue(channels);
               }
-              kodi::Log(ADDON_LOG_DEBUG, "Triggered %d channel updates", channels);
 
               m_lastEPGUpdateTime = lastUpdate;
               m_lastRecordingUpdateTime = update_time;
@@ -566,9 +580,10 @@ PVR_ERROR cPVRClientNextPVR::GetDriveSpace(uint64_t& total, uint64_t& used)
 PVR_ERROR cPVRClientNextPVR::GetChannelStreamProperties(const kodi::addon::PVRChannel& channel, PVR_SOURCE source, std::vector<kodi::addon::PVRStreamProperty>& properties)
 {
   bool liveStream = m_channels.IsChannelAPlugin(channel.GetUniqueId());
-  if (liveStream)
+  std::string stream;
+  if (liveStream && m_channels.GetLiveStream(channel.GetUniqueId(), stream))
   {
-    properties.emplace_back(PVR_STREAM_PROPERTY_STREAMURL, m_channels.m_liveStreams[channel.GetUniqueId()]);
+    properties.emplace_back(PVR_STREAM_PROPERTY_STREAMURL, stream);
     properties.emplace_back(PVR_STREAM_PROPERTY_ISREALTIMESTREAM, "true");
     return PVR_ERROR_NO_ERROR;
   }
@@ -580,7 +595,7 @@ PVR_ERROR cPVRClientNextPVR::GetChannelStreamProperties(const kodi::addon::PVRCh
       m_nowPlaying = NotPlaying;
       m_livePlayer = nullptr;
     }
-    const std::string line = kodi::tools::StringUtils::Format("%s/service?method=channel.transcode.m3u8&sid=%s", m_settings->m_urlBase, m_request.GetSID());
+    const std::string line = kodi::tools::StringUtils::Format("%s/service?method=channel.transcode.m3u8&sid=%s", m_settings->m_urlBase, m_request.GetSID().c_str());
     m_livePlayer = m_timeshiftBuffer;
     m_livePlayer->Channel(channel.GetUniqueId());
     if (m_livePlayer->Open(line))
@@ -610,6 +625,7 @@ PVR_ERROR cPVRClientNextPVR::GetChannelStreamProperties(const kodi::addon::PVRCh
 /** Live stream handling */
 bool cPVRClientNextPVR::OpenLiveStream(const kodi::addon::PVRChannel& channel)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "OpenLiveStream");
   if (!m_bConnected && !m_settings->m_enableWOL)
   {
     m_nextServerCheck = std::numeric_limits<time_t>::max();
@@ -620,6 +636,7 @@ bool cPVRClientNextPVR::OpenLiveStream(const kodi::addon::PVRChannel& channel)
     }
   }
 
+  m_epg.GetUpdateScheduler().Watched(channel.GetUniqueId());
   std::string line;
   if (channel.GetIsRadio() == false)
   {
@@ -629,21 +646,20 @@ bool cPVRClientNextPVR::OpenLiveStream(const kodi::addon::PVRChannel& channel)
   {
     m_nowPlaying = Radio;
   }
-  if (m_channels.m_liveStreams.count(channel.GetUniqueId()) != 0)
+  if (m_channels.GetLiveStream(channel.GetUniqueId(), line))
   {
-    line = m_channels.m_liveStreams[channel.GetUniqueId()];
     m_livePlayer = m_realTimeBuffer;
     return m_livePlayer->Open(line, ADDON_READ_CACHED);
   }
   else if (m_settings->m_liveStreamingMethod == ClientTimeshift)
   {
-    line = kodi::tools::StringUtils::Format("%s/live?channeloid=%d&client=%s&sid=%s", m_settings->m_urlBase, channel.GetUniqueId(), m_request.GetSID(), m_request.GetSID());
+    line = kodi::tools::StringUtils::Format("%s/live?channeloid=%d&client=%s&sid=%s", m_settings->m_urlBase, channel.GetUniqueId(), m_request.GetSID().c_str(), m_request.GetSID().c_str());
     m_livePlayer = m_timeshiftBuffer;
     m_livePlayer->Channel(channel.GetUniqueId());
   }
   else
   {
-    line = kodi::tools::StringUtils::Format("%s/live?channeloid=%d&client=XBMC-%s", m_settings->m_urlBase, channel.GetUniqueId(), m_request.GetSID());
+    line = kodi::tools::StringUtils::Format("%s/live?channeloid=%d&client=XBMC-%s", m_settings->m_urlBase, channel.GetUniqueId(), m_request.GetSID().c_str());
     m_livePlayer = m_realTimeBuffer;
   }
   kodi::Log(ADDON_LOG_INFO, "Calling Open(%s) on tsb!", line.c_str());
@@ -676,6 +692,7 @@ void cPVRClientNextPVR::CloseLiveStream(void)
 
 int64_t cPVRClientNextPVR::SeekLiveStream(int64_t iPosition, int iWhence)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "SeekLiveStream");
   if (IsServerStreamingLive())
   {
     return m_livePlayer->Seek(iPosition, iWhence);
@@ -742,10 +759,11 @@ bool cPVRClientNextPVR::CanSeekStream(void)
 
 bool cPVRClientNextPVR::OpenRecordedStream(const kodi::addon::PVRRecording& recording, int64_t& streamId)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "OpenRecordedStream");
   kodi::addon::PVRRecording copyRecording = recording;
   m_nowPlaying = Recording;
   copyRecording.SetDirectory(m_recordings.m_hostFilenames[recording.GetRecordingId()]);
-  const std::string line = kodi::tools::StringUtils::Format("%s/live?recording=%s&client=XBMC-%s", m_settings->m_urlBase, recording.GetRecordingId().c_str(), m_request.GetSID());
+  const std::string line = kodi::tools::StringUtils::Format("%s/live?recording=%s&client=XBMC-%s", m_settings->m_urlBase, recording.GetRecordingId().c_str(), m_request.GetSID().c_str());
   return m_recordingBuffer->Open(line, copyRecording);
 }
 
@@ -770,6 +788,7 @@ int cPVRClientNextPVR::ReadRecordedStream(int64_t streamId, unsigned char* pBuff
 
 int64_t cPVRClientNextPVR::SeekRecordedStream(int64_t streamId, int64_t iPosition, int iWhence)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "SeekRecordedStream");
   if (IsServerStreamingRecording())
   {
     return m_recordingBuffer->Seek(iPosition, iWhence);
@@ -840,7 +859,7 @@ bool cPVRClientNextPVR::IsServerStreaming()
   {
     return true;
   }
-  kodi::Log(ADDON_LOG_ERROR, "Unknown streaming state %d %d %d", m_nowPlaying, m_recordingBuffer->GetDuration(), !m_livePlayer);
+  kodi::Log(ADDON_LOG_ERROR, "Unknown streaming state %d %d %d", m_nowPlaying.load(), m_recordingBuffer->GetDuration(), !m_livePlayer);
   return false;
 }
 
@@ -851,7 +870,7 @@ bool cPVRClientNextPVR::IsServerStreamingLive(bool log)
     return true;
   }
   if (log)
-    kodi::Log(ADDON_LOG_ERROR, "Unknown live streaming state %d %d %d", m_nowPlaying, m_recordingBuffer->GetDuration(), !m_livePlayer);
+    kodi::Log(ADDON_LOG_ERROR, "Unknown live streaming state %d %d %d", m_nowPlaying.load(), m_recordingBuffer->GetDuration(), !m_livePlayer);
   return false;
 }
 
@@ -862,7 +881,7 @@ bool cPVRClientNextPVR::IsServerStreamingRecording(bool log)
     return true;
   }
   if (log)
-    kodi::Log(ADDON_LOG_ERROR, "Unknown recording streaming state %d %d %d", m_nowPlaying, m_recordingBuffer->GetDuration(), !m_livePlayer);
+    kodi::Log(ADDON_LOG_ERROR, "Unknown recording streaming state %d %d %d", m_nowPlaying.load(), m_recordingBuffer->GetDuration(), !m_livePlayer);
   return false;
 }
 
@@ -894,6 +913,7 @@ PVR_ERROR cPVRClientNextPVR::CallSettingsMenuHook(const kodi::addon::PVRMenuhook
 
 PVR_ERROR cPVRClientNextPVR::GetEPGForChannel(int channelUid, time_t start, time_t end, kodi::addon::PVREPGTagsResultSet& results)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "GetEPGForChannel");
   return m_epg.GetEPGForChannel(channelUid, start, end, results);
 }
 
@@ -914,6 +934,7 @@ PVR_ERROR cPVRClientNextPVR::GetChannelsAmount(int& amount)
 
 PVR_ERROR cPVRClientNextPVR::GetChannels(bool radio, kodi::addon::PVRChannelsResultSet& results)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "GetChannels");
   return m_channels.GetChannels(radio, results);
 }
 
@@ -935,11 +956,13 @@ PVR_ERROR cPVRClientNextPVR::GetChannelGroupsAmount(int& amount)
 
 PVR_ERROR cPVRClientNextPVR::GetChannelGroups(bool radio, kodi::addon::PVRChannelGroupsResultSet& results)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "GetChannelGroups");
   return m_channels.GetChannelGroups(radio, results);
 }
 
 PVR_ERROR cPVRClientNextPVR::GetChannelGroupMembers(const kodi::addon::PVRChannelGroup& group, kodi::addon::PVRChannelGroupMembersResultSet& results)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "GetChannelGroupMembers");
   return m_channels.GetChannelGroupMembers(group, results);
 }
 
@@ -953,6 +976,7 @@ PVR_ERROR cPVRClientNextPVR::GetRecordingsAmount(bool deleted, int& amount)
 
 PVR_ERROR cPVRClientNextPVR::GetRecordings(bool deleted, kodi::addon::PVRRecordingsResultSet& results)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "GetRecordings");
   return m_recordings.GetRecordings(deleted, results);
 }
 
@@ -1002,6 +1026,7 @@ PVR_ERROR cPVRClientNextPVR::GetTimersAmount(int& amount)
 
 PVR_ERROR cPVRClientNextPVR::GetTimers(kodi::addon::PVRTimersResultSet& results)
 {
+  utilities::ScopedPhase phase(m_request.GetMetrics(), "GetTimers");
   return m_timers.GetTimers(results);
 }
 
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 
 /* Master defines for client control */
@@ -94,13 +95,15 @@ public:
   int64_t LengthRecordedStream(int64_t streamId) override;
 
   void ForceRecordingUpdate() { m_lastRecordingUpdateTime = 0; }
+  std::string GetEpgUpdateProgress() { return m_epg.GetUpdateScheduler().GetProgress(); }
 
   /* background connection monitoring */
   void Process();
 
   time_t m_lastRecordingUpdateTime;
   time_t m_lastEPGUpdateTime = 0;
-  eNowPlaying m_nowPlaying = NotPlaying;
+  // read by the guide update scheduler and the timers without the client lock
+  std::atomic<eNowPlaying> m_nowPlaying{NotPlaying};
 
   PVR_ERROR GetCapabilities(kodi::addon::PVRCapabilities& capabilities) override;
 
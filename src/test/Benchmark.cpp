@@ -0,0 +1,360 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+/*
+ * nextpvr-benchmark [--quick] [--seed N]
+ *
+ * Times the parsing and bookkeeping paths of the add-on against generated
+ * responses, each next to the approach it replaced.  The input only
+ * depends on the seed so runs on one machine can be compared.
+ */
+
+#include "ChannelIndex.h"
+#include "ChannelTable.h"
+#include "FixtureGenerator.h"
+#include "utilities/FieldScanners.h"
+#include "utilities/SlotPool.h"
+#include "utilities/StringPool.h"
+#include "utilities/XMLRecordFields.h"
+#include "utilities/XMLRecordReader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NextPVR;
+using namespace NextPVR::test;
+using namespace NextPVR::utilities;
+
+namespace
+{
+volatile int64_t g_sink;
+
+// runs body until minimum time has passed, body returns how many operations it did
+void Measure(const char* name, const std::function<int64_t()>& body)
+{
+  using clock = std::chrono::steady_clock;
+  constexpr auto MINIMUM = std::chrono::milliseconds(300);
+  int64_t operations = 0;
+  int runs = 0;
+  const auto start = clock::now();
+  auto elapsed = clock::duration::zero();
+  while (elapsed < MINIMUM || runs < 3)
+  {
+    operations += body();
+    runs++;
+    elapsed = clock::now() - start;
+  }
+  const double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  printf("%-48s %12.1f ns/op %10lld ops %6d runs\n", name, nanoseconds / static_cast<double>(operations),
+         static_cast<long long>(operations), runs);
+}
+
+std::vector<std::string> StreamTexts(const std::string& response, const char* recordTag, const char* field)
+{
+  std::vector<std::string> texts;
+  XMLRecordReader reader(recordTag, [&](tinyxml2::XMLElement* record) {
+    const tinyxml2::XMLElement* element = record->FirstChildElement(field);
+    if (element != nullptr && element->GetText() != nullptr)
+      texts.emplace_back(element->GetText());
+  });
+  reader.Feed(response.data(), response.size());
+  reader.Finish();
+  return texts;
+}
+
+void BenchmarkResponseParsing(FixtureGenerator& generator)
+{
+  const std::string response = generator.RecordingList();
+  printf("\nrecording.list, %zu bytes\n", response.size());
+  Measure("DOM parse, length scanned again", [&] {
+    tinyxml2::XMLDocument doc;
+    g_sink = doc.Parse(response.c_str());
+    return 1;
+  });
+  Measure("DOM parse, length passed", [&] {
+    tinyxml2::XMLDocument doc;
+    g_sink = doc.Parse(response.data(), response.size());
+    return 1;
+  });
+  Measure("streamed in 64 KiB chunks", [&] {
+    int records = 0;
+    XMLRecordReader reader("recording", [&](tinyxml2::XMLElement*) { records++; });
+    for (size_t offset = 0; offset < response.size(); offset += 64 * 1024)
+      reader.Feed(response.data() + offset, std::min<size_t>(64 * 1024, response.size() - offset));
+    g_sink = reader.Finish() + records;
+    return 1;
+  });
+}
+
+void BenchmarkFieldReads(FixtureGenerator& generator)
+{
+  const std::string response = generator.ChannelListings(generator.GetChannelUid(0));
+  tinyxml2::XMLDocument doc;
+  doc.Parse(response.data(), response.size());
+  std::vector<const tinyxml2::XMLElement*> listings;
+  for (const tinyxml2::XMLElement* l = doc.RootElement()->FirstChildElement("listings")->FirstChildElement("l"); l; l = l->NextSiblingElement("l"))
+    listings.push_back(l);
+  static const char* names[] = {"name", "description", "subtitle", "start", "end", "genre", "genre_type", "genre_subtype", "genres",
+                                "season", "episode", "year", "original", "firstrun", "significance", "cast", "crew", "star_rating"};
+  constexpr auto table = MakeFieldTable("name", "description", "subtitle", "start", "end", "genre", "genre_type", "genre_subtype",
+                                        "genres", "season", "episode", "year", "original", "firstrun", "significance", "cast",
+                                        "crew", "star_rating");
+
+  printf("\nchannel.listings, %zu listings\n", listings.size());
+  Measure("FirstChildElement per field", [&] {
+    int64_t found = 0;
+    for (const tinyxml2::XMLElement* l : listings)
+    {
+      for (const char* name : names)
+        found += l->FirstChildElement(name) != nullptr;
+    }
+    g_sink = found;
+    return static_cast<int64_t>(listings.size());
+  });
+  Measure("one pass with field table", [&] {
+    int64_t found = 0;
+    for (const tinyxml2::XMLElement* l : listings)
+    {
+      const XMLRecordFields<table.names.size()> fields(l, table);
+      for (size_t field = 0; field < table.names.size(); field++)
+        found += fields.Has(field);
+    }
+    g_sink = found;
+    return static_cast<int64_t>(listings.size());
+  });
+
+  std::vector<std::string> times;
+  for (const tinyxml2::XMLElement* l : listings)
+    times.emplace_back(l->FirstChildElement("start")->GetText());
+  Measure("timestamps with strtoll", [&] {
+    int64_t sum = 0;
+    for (const std::string& time : times)
+      sum += std::strtoll(time.substr(0, 10).c_str(), nullptr, 10);
+    g_sink = sum;
+    return static_cast<int64_t>(times.size());
+  });
+  Measure("timestamps with from_chars", [&] {
+    int64_t sum = 0;
+    for (const std::string& time : times)
+      sum += ParseInteger<int64_t>(time.c_str(), 10);
+    g_sink = sum;
+    return static_cast<int64_t>(times.size());
+  });
+}
+
+void BenchmarkScanners(FixtureGenerator& generator)
+{
+  std::vector<std::string> descriptions;
+  std::vector<std::string> subtitles;
+  for (int index = 0; index < 4; index++)
+  {
+    const std::string response = generator.ChannelListings(generator.GetChannelUid(index));
+    for (std::string& text : StreamTexts(response, "l", "description"))
+      descriptions.push_back(std::move(text));
+  }
+  for (std::string& text : StreamTexts(generator.RecordingList(), "recording", "subtitle"))
+    subtitles.push_back(std::move(text));
+
+  printf("\n%zu descriptions, %zu recording subtitles\n", descriptions.size(), subtitles.size());
+  Measure("episode marker with std::regex", [&] {
+    static const std::regex pattern("^.*\\([eE][pP](\\d+)(?:/?(\\d+))?\\)");
+    int64_t found = 0;
+    std::smatch match;
+    for (const std::string& text : descriptions)
+      found += std::regex_search(text, match, pattern);
+    g_sink = found;
+    return static_cast<int64_t>(descriptions.size());
+  });
+  Measure("episode marker with scanner", [&] {
+    int64_t found = 0;
+    int episode, part;
+    for (const std::string& text : descriptions)
+      found += ScanEpisodeMarker(text, episode, part);
+    g_sink = found;
+    return static_cast<int64_t>(descriptions.size());
+  });
+  Measure("season and episode with std::regex", [&] {
+    static const std::regex pattern("S(\\d{2,4})E(\\d+)(?: - ?(.+)$)?");
+    int64_t found = 0;
+    std::smatch match;
+    for (const std::string& text : subtitles)
+      found += std::regex_search(text, match, pattern);
+    g_sink = found;
+    return static_cast<int64_t>(subtitles.size());
+  });
+  Measure("season and episode with scanner", [&] {
+    int64_t found = 0;
+    SeasonEpisode result;
+    for (const std::string& text : subtitles)
+      found += ScanSeasonEpisode(text, true, result);
+    g_sink = found;
+    return static_cast<int64_t>(subtitles.size());
+  });
+}
+
+void BenchmarkChannelDiff(FixtureGenerator& generator)
+{
+  const std::string response = generator.ChannelList();
+  // one renamed channel in the middle of the lineup
+  std::string changed = response;
+  const size_t name = changed.find("<name>", changed.size() / 2);
+  changed.insert(name + 6, "New ");
+
+  ChannelTable before, same, after;
+  before.Parse(response.data(), response.size(), 0);
+  same.Parse(response.data(), response.size(), 0);
+  after.Parse(changed.data(), changed.size(), 0);
+
+  printf("\nchannel.list, %zu channels\n", before.Size());
+  Measure("parse lineup into table", [&] {
+    ChannelTable table;
+    g_sink = table.Parse(response.data(), response.size(), 0);
+    return 1;
+  });
+  Measure("diff unchanged lineup", [&] {
+    g_sink = ChannelTable::Diff(before, same).HasChannelChanges();
+    return 1;
+  });
+  Measure("diff lineup with one rename", [&] {
+    g_sink = ChannelTable::Diff(before, after).renamed;
+    return 1;
+  });
+}
+
+void BenchmarkChannelIndex(FixtureGenerator& generator, int channels)
+{
+  std::vector<int> uids;
+  std::map<int, std::pair<bool, bool>> details;
+  std::vector<ChannelDetail> indexDetails;
+  for (int index = 0; index < channels; index++)
+  {
+    const int uid = generator.GetChannelUid(index);
+    uids.push_back(uid);
+    details[uid] = std::make_pair(index % 10 == 0, generator.IsRadio(index));
+    indexDetails.push_back({static_cast<unsigned int>(uid), index % 10 == 0, generator.IsRadio(index), false, "", ""});
+  }
+  const ChannelIndex channelIndex(std::move(indexDetails));
+
+  // the per-channel lookups of an EPG or group pass, in lineup order
+  printf("\nchannel details, %zu channels\n", uids.size());
+  Measure("std::map operator[]", [&] {
+    int64_t radio = 0;
+    for (const int uid : uids)
+      radio += details[uid].second;
+    g_sink = radio;
+    return static_cast<int64_t>(uids.size());
+  });
+  Measure("ChannelIndex::Find", [&] {
+    int64_t radio = 0;
+    for (const int uid : uids)
+    {
+      const ChannelDetail* detail = channelIndex.Find(uid);
+      radio += detail != nullptr && detail->radio;
+    }
+    g_sink = radio;
+    return static_cast<int64_t>(uids.size());
+  });
+}
+
+void BenchmarkSlotPool()
+{
+  printf("\nslot pool\n");
+  SlotPool slots([] { return 2; }, 2000);
+  Measure("acquire and release, uncontended", [&] {
+    bool promoted;
+    for (int i = 0; i < 10000; i++)
+    {
+      slots.Acquire(1, promoted);
+      slots.Release();
+    }
+    return 10000;
+  });
+  Measure("acquire and release, 8 threads for 2 slots", [&] {
+    constexpr int PER_THREAD = 2000;
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < 8; thread++)
+    {
+      threads.emplace_back([&slots, thread] {
+        bool promoted;
+        for (int i = 0; i < PER_THREAD; i++)
+        {
+          slots.Acquire(thread % 3, promoted);
+          slots.Release();
+        }
+      });
+    }
+    for (std::thread& thread : threads)
+      thread.join();
+    return 8 * PER_THREAD;
+  });
+}
+
+void BenchmarkStringPool(FixtureGenerator& generator)
+{
+  const std::vector<std::string> cast = StreamTexts(generator.ChannelListings(generator.GetChannelUid(1)), "l", "cast");
+  printf("\n%zu cast lists\n", cast.size());
+  Measure("copied into strings", [&] {
+    std::vector<std::string> copies(cast.begin(), cast.end());
+    g_sink = static_cast<int64_t>(copies.size());
+    return static_cast<int64_t>(cast.size());
+  });
+  Measure("interned into a pool", [&] {
+    StringPool strings;
+    std::vector<std::string_view> views;
+    views.reserve(cast.size());
+    for (const std::string& text : cast)
+      views.push_back(strings.Intern(text));
+    g_sink = static_cast<int64_t>(views.size());
+    return static_cast<int64_t>(cast.size());
+  });
+}
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+  FixtureOptions options;
+  options.channels = 2000;
+  options.days = 14;
+  options.recordings = 50000;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--quick"))
+    {
+      options.channels = 200;
+      options.days = 2;
+      options.recordings = 2000;
+    }
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+    {
+      options.seed = static_cast<uint32_t>(atoi(argv[++i]));
+    }
+    else
+    {
+      fprintf(stderr, "Usage: %s [--quick] [--seed N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  FixtureGenerator generator(options);
+  printf("seed %u, %d channels, %d days, %d recordings\n", options.seed, options.channels, options.days, options.recordings);
+  BenchmarkResponseParsing(generator);
+  BenchmarkFieldReads(generator);
+  BenchmarkScanners(generator);
+  BenchmarkChannelDiff(generator);
+  BenchmarkChannelIndex(generator, options.channels);
+  BenchmarkSlotPool();
+  BenchmarkStringPool(generator);
+  return 0;
+}
@@ -0,0 +1,473 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+/*
+ * nextpvr-drive [--host NAME] [--port N] [--concurrency N] [--days N]
+ *               [--stream-bytes N] [--seeks N]
+ *
+ * Runs the backend side of a client session against a server, normally
+ * nextpvr-mock-backend, and prints how long each phase took: connect,
+ * channels, groups, the guide for every channel with a guide source,
+ * recordings, recurring rules, then reading and seeking a live stream and
+ * a recording.  The responses go through the same ChannelTable and
+ * XMLRecordReader code as in Kodi, over keep-alive HTTP connections like
+ * Kodi's, so changes to them can be timed end to end without Kodi.
+ *
+ * Kodi itself is not loaded, so the PVR result sets and cPVRClientNextPVR
+ * are not part of the run.  Any login is accepted by the mock backend, a
+ * real server would want the PIN digest the add-on sends.
+ */
+
+#include "ChannelTable.h"
+#include "utilities/XMLRecordReader.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <tinyxml2.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace NextPVR;
+using namespace NextPVR::utilities;
+
+namespace
+{
+struct DriveOptions
+{
+  std::string host = "127.0.0.1";
+  int port = 8866;
+  int concurrency = 4;
+  int days = 7;
+  size_t streamBytes = 8 * 1024 * 1024;
+  int seeks = 20;
+};
+
+/*
+ * A blocking HTTP/1.1 client on one keep-alive connection, reconnecting
+ * when the server closes it.  The body is handed over as it arrives.
+ */
+class HttpClient
+{
+public:
+  HttpClient(const std::string& host, int port) : m_host(host), m_port(port) {}
+  ~HttpClient() { Close(); }
+
+  typedef std::function<bool(const char*, size_t)> BodyCallback;
+
+  /* \brief Sends a GET and passes the body to callback until it returns false.
+     \return the HTTP status, 0 when the server could not be reached
+  */
+  int Get(const std::string& target, const std::string& headers, const BodyCallback& callback);
+  int Get(const std::string& target, std::string& body);
+  void Close();
+
+  size_t GetBytes() const { return m_bytes; }
+
+private:
+  HttpClient(HttpClient const&) = delete;
+  void operator=(HttpClient const&) = delete;
+
+  bool Connect();
+  bool Fill();
+
+  const std::string m_host;
+  const int m_port;
+  int m_socket = -1;
+  std::string m_buffer;
+  size_t m_bytes = 0;
+};
+
+bool HttpClient::Connect()
+{
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* address = nullptr;
+  if (getaddrinfo(m_host.c_str(), std::to_string(m_port).c_str(), &hints, &address) != 0)
+    return false;
+  m_socket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+  const bool connected = m_socket >= 0 && connect(m_socket, address->ai_addr, address->ai_addrlen) == 0;
+  freeaddrinfo(address);
+  if (!connected)
+  {
+    Close();
+    return false;
+  }
+  const int noDelay = 1;
+  setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  return true;
+}
+
+void HttpClient::Close()
+{
+  if (m_socket >= 0)
+    close(m_socket);
+  m_socket = -1;
+  m_buffer.clear();
+}
+
+bool HttpClient::Fill()
+{
+  char data[64 * 1024];
+  const ssize_t received = recv(m_socket, data, sizeof(data), 0);
+  if (received <= 0)
+    return false;
+  m_buffer.append(data, static_cast<size_t>(received));
+  m_bytes += static_cast<size_t>(received);
+  return true;
+}
+
+int HttpClient::Get(const std::string& target, const std::string& headers, const BodyCallback& callback)
+{
+  // a kept connection the server has dropped is only found out on use, try once more on a new one
+  for (int attempt = 0; attempt < 2; attempt++)
+  {
+    if (m_socket < 0 && !Connect())
+      return 0;
+
+    const std::string request = "GET " + target + " HTTP/1.1\r\nHost: " + m_host + "\r\n" + headers + "\r\n";
+    if (send(m_socket, request.data(), request.size(), 0) != static_cast<ssize_t>(request.size()))
+    {
+      Close();
+      continue;
+    }
+
+    size_t headEnd;
+    while ((headEnd = m_buffer.find("\r\n\r\n")) == std::string::npos)
+    {
+      if (!Fill())
+        break;
+    }
+    if (headEnd == std::string::npos)
+    {
+      Close();
+      continue;
+    }
+
+    const std::string head = m_buffer.substr(0, headEnd);
+    m_buffer.erase(0, headEnd + 4);
+    const int status = atoi(head.c_str() + head.find(' ') + 1);
+    const size_t lengthHeader = head.find("Content-Length: ");
+    const bool sized = lengthHeader != std::string::npos;
+    size_t remaining = sized ? strtoull(head.c_str() + lengthHeader + 16, nullptr, 10) : SIZE_MAX;
+    const bool keepAlive = sized && head.find("Connection: close") == std::string::npos;
+
+    bool wanted = true;
+    while (remaining != 0)
+    {
+      if (m_buffer.empty() && !Fill())
+        break;
+      const size_t length = std::min(remaining, m_buffer.size());
+      wanted = callback(m_buffer.data(), length);
+      m_buffer.erase(0, length);
+      if (sized)
+        remaining -= length;
+      if (!wanted)
+        break;
+    }
+    if (!keepAlive || remaining != 0)
+      Close();
+    return status;
+  }
+  return 0;
+}
+
+int HttpClient::Get(const std::string& target, std::string& body)
+{
+  body.clear();
+  return Get(target, "", [&body](const char* data, size_t length) {
+    body.append(data, length);
+    return true;
+  });
+}
+
+struct Phase
+{
+  const char* name;
+  int requests;
+  size_t bytes;
+  int64_t milliseconds;
+  int64_t items;
+  const char* unit;
+};
+
+class Driver
+{
+public:
+  explicit Driver(const DriveOptions& options) : m_options(options), m_client(options.host, options.port) {}
+
+  bool Run();
+
+private:
+  Driver(Driver const&) = delete;
+  void operator=(Driver const&) = delete;
+
+  bool Connect();
+  bool Channels();
+  bool Groups();
+  bool Guide();
+  bool Stream(const char* name, const std::string& target, const std::string& countTarget);
+  int64_t StreamRecords(HttpClient& client, const std::string& method, const char* recordTag, int& requests);
+  bool List(const char* name, const std::string& method, const char* recordTag, const char* unit);
+  void Report(const char* name, int requests, size_t bytes, std::chrono::steady_clock::time_point start, int64_t items, const char* unit);
+  std::string Service(const std::string& method) const;
+
+  const DriveOptions m_options;
+  HttpClient m_client;
+  std::string m_sid;
+  ChannelTable m_channels;
+  std::vector<Phase> m_phases;
+};
+
+std::string Driver::Service(const std::string& method) const
+{
+  return "/service?method=" + method + (m_sid.empty() ? "" : "&sid=" + m_sid);
+}
+
+void Driver::Report(const char* name, int requests, size_t bytes, std::chrono::steady_clock::time_point start, int64_t items, const char* unit)
+{
+  const int64_t milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  m_phases.push_back({name, requests, bytes, milliseconds, items, unit});
+  printf("%-12s %8lld ms %6d requests %12zu bytes %10lld %s\n", name, static_cast<long long>(milliseconds), requests, bytes,
+         static_cast<long long>(items), unit);
+  fflush(stdout);
+}
+
+bool Driver::Connect()
+{
+  const auto start = std::chrono::steady_clock::now();
+  const size_t bytes = m_client.GetBytes();
+  std::string body;
+  tinyxml2::XMLDocument doc;
+  if (m_client.Get(Service("session.initiate&ver=1.0&device=xbmc"), body) != 200 ||
+      doc.Parse(body.data(), body.size()) != tinyxml2::XML_SUCCESS || CheckResponseStatus(doc.RootElement()) != tinyxml2::XML_SUCCESS)
+  {
+    fprintf(stderr, "session.initiate failed on %s:%d\n", m_options.host.c_str(), m_options.port);
+    return false;
+  }
+  const tinyxml2::XMLElement* sid = doc.RootElement()->FirstChildElement("sid");
+  if (sid == nullptr || sid->GetText() == nullptr)
+    return false;
+  const std::string session = sid->GetText();
+  if (m_client.Get(Service("session.login&sid=" + session + "&md5=0"), body) != 200 ||
+      doc.Parse(body.data(), body.size()) != tinyxml2::XML_SUCCESS || CheckResponseStatus(doc.RootElement()) != tinyxml2::XML_SUCCESS)
+  {
+    fprintf(stderr, "session.login failed\n");
+    return false;
+  }
+  m_sid = session;
+  if (m_client.Get(Service("setting.list"), body) != 200)
+    return false;
+  Report("connect", 3, m_client.GetBytes() - bytes, start, 1, "sessions");
+  return true;
+}
+
+bool Driver::Channels()
+{
+  const auto start = std::chrono::steady_clock::now();
+  const size_t bytes = m_client.GetBytes();
+  std::string body;
+  if (m_client.Get(Service("channel.list&extras=true"), body) != 200 || !m_channels.Parse(body.data(), body.size(), time(nullptr)))
+  {
+    fprintf(stderr, "channel.list failed\n");
+    return false;
+  }
+  Report("channels", 1, m_client.GetBytes() - bytes, start, static_cast<int64_t>(m_channels.Size()), "channels");
+  return true;
+}
+
+bool Driver::Groups()
+{
+  // the add-on answers group members from the channel table, only the names are fetched
+  return List("groups", "channel.groups", "group", "groups");
+}
+
+int64_t Driver::StreamRecords(HttpClient& client, const std::string& method, const char* recordTag, int& requests)
+{
+  int64_t records = 0;
+  XMLRecordReader reader(recordTag, [&records](tinyxml2::XMLElement*) { records++; });
+  requests++;
+  const int status = client.Get(Service(method), "", [&reader](const char* data, size_t length) { return reader.Feed(data, length); });
+  if (status != 200 || reader.Finish() != tinyxml2::XML_SUCCESS)
+  {
+    fprintf(stderr, "%s failed\n", method.c_str());
+    return -1;
+  }
+  return records;
+}
+
+bool Driver::Guide()
+{
+  std::vector<unsigned int> channels;
+  for (size_t row = 0; row < m_channels.Size(); row++)
+  {
+    if (!m_channels.IsEpgNone(row))
+      channels.push_back(m_channels.GetId(row));
+  }
+
+  // the prefetch pipelines one request per channel over a few connections
+  const auto start = std::chrono::steady_clock::now();
+  const time_t from = time(nullptr);
+  const time_t to = from + static_cast<time_t>(m_options.days) * 24 * 60 * 60;
+  std::atomic<size_t> next{0};
+  std::atomic<int64_t> events{0};
+  std::atomic<size_t> bytes{0};
+  std::atomic<int> requests{0};
+  std::atomic<bool> failed{false};
+  auto worker = [&]() {
+    HttpClient client(m_options.host, m_options.port);
+    size_t index;
+    int workerRequests = 0;
+    while (!failed && (index = next++) < channels.size())
+    {
+      const std::string method = "channel.listings&channel_id=" + std::to_string(channels[index]) + "&start=" + std::to_string(from) +
+                                 "&end=" + std::to_string(to) + "&genre=all";
+      const int64_t records = StreamRecords(client, method, "l", workerRequests);
+      if (records < 0)
+        failed = true;
+      else
+        events += records;
+    }
+    bytes += client.GetBytes();
+    requests += workerRequests;
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < std::max(1, m_options.concurrency); i++)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads)
+    thread.join();
+  if (failed)
+    return false;
+  Report("guide", requests, bytes, start, events, "events");
+  return true;
+}
+
+bool Driver::List(const char* name, const std::string& method, const char* recordTag, const char* unit)
+{
+  const auto start = std::chrono::steady_clock::now();
+  const size_t bytes = m_client.GetBytes();
+  int requests = 0;
+  const int64_t records = StreamRecords(m_client, method, recordTag, requests);
+  if (records < 0)
+    return false;
+  Report(name, requests, m_client.GetBytes() - bytes, start, records, unit);
+  return true;
+}
+
+bool Driver::Stream(const char* name, const std::string& target, const std::string& countTarget)
+{
+  // reads from the start, then seeks the way a recording buffer does with a range request per jump
+  const auto start = std::chrono::steady_clock::now();
+  HttpClient client(m_options.host, m_options.port);
+  size_t read = 0;
+  int requests = 1;
+  const int status = client.Get(target, "", [&](const char*, size_t length) {
+    read += length;
+    return read < m_options.streamBytes;
+  });
+  if (status != 200)
+  {
+    fprintf(stderr, "%s returned %d\n", target.c_str(), status);
+    return false;
+  }
+  client.Close();
+
+  if (!countTarget.empty())
+  {
+    uint64_t offset = 1;
+    for (int seek = 0; seek < m_options.seeks; seek++)
+    {
+      offset = (offset * 2654435761u + 188 * 1024) % (256 * 1024 * 1024);
+      size_t seekRead = 0;
+      requests++;
+      const int seekStatus = client.Get(countTarget, "Range: bytes=" + std::to_string(offset) + "-\r\n", [&](const char*, size_t length) {
+        seekRead += length;
+        return seekRead < 188 * 1024;
+      });
+      client.Close();
+      if (seekStatus != 206 && seekStatus != 200)
+      {
+        fprintf(stderr, "seek in %s returned %d\n", countTarget.c_str(), seekStatus);
+        return false;
+      }
+    }
+  }
+  Report(name, requests, client.GetBytes(), start, static_cast<int64_t>(read), "bytes read");
+  return true;
+}
+
+bool Driver::Run()
+{
+  const auto start = std::chrono::steady_clock::now();
+  if (!Connect() || !Channels() || !Groups() || !Guide() || !List("recordings", "recording.list&filter=all", "recording", "recordings") ||
+      !List("timers", "recording.recurring.list", "recurring", "rules"))
+    return false;
+
+  const std::string client = "&client=drive-" + m_sid;
+  if (m_channels.Size() != 0 &&
+      !Stream("live", "/live?channeloid=" + std::to_string(m_channels.GetId(0)) + client, ""))
+    return false;
+  if (!Stream("recording", "/live?recording=1" + client, "/live?recording=1" + client))
+    return false;
+
+  std::string body;
+  m_client.Get(Service("session.logout"), body);
+  const int64_t milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  printf("%-12s %8lld ms\n", "total", static_cast<long long>(milliseconds));
+  return true;
+}
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+  DriveOptions options;
+  for (int i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      fprintf(stderr, "%s needs a value\n", arg);
+      return 1;
+    }
+    const char* value = argv[++i];
+    if (!strcmp(arg, "--host"))
+      options.host = value;
+    else if (!strcmp(arg, "--port"))
+      options.port = atoi(value);
+    else if (!strcmp(arg, "--concurrency"))
+      options.concurrency = atoi(value);
+    else if (!strcmp(arg, "--days"))
+      options.days = atoi(value);
+    else if (!strcmp(arg, "--stream-bytes"))
+      options.streamBytes = strtoull(value, nullptr, 10);
+    else if (!strcmp(arg, "--seeks"))
+      options.seeks = atoi(value);
+    else
+    {
+      fprintf(stderr, "Unknown option %s\n", arg);
+      return 1;
+    }
+  }
+
+  Driver driver(options);
+  return driver.Run() ? 0 : 1;
+}
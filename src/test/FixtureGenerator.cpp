@@ -0,0 +1,332 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "FixtureGenerator.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace NextPVR::test;
+
+namespace
+{
+constexpr int FIRST_CHANNEL_UID = 7000;
+constexpr uint32_t TITLE_POOL = 600;
+constexpr int64_t SECONDS_PER_DAY = 24 * 3600;
+
+enum eFixtureStream
+{
+  StreamChannels = 1,
+  StreamRecordings,
+  StreamRecurring,
+  // listings use one stream per channel above this
+  StreamListings = 0x10000
+};
+
+void AppendElement(std::string& text, const char* name, const std::string& value)
+{
+  text.append("<").append(name).append(">").append(value).append("</").append(name).append(">");
+}
+
+void AppendElement(std::string& text, const char* name, int64_t value)
+{
+  AppendElement(text, name, std::to_string(value));
+}
+
+std::string FormatDate(time_t time, const char* format)
+{
+  char buffer[32];
+  strftime(buffer, sizeof(buffer), format, std::gmtime(&time));
+  return buffer;
+}
+} // unnamed namespace
+
+FixtureGenerator::FixtureGenerator(const FixtureOptions& options) :
+  m_options(options),
+  m_genres({"News", "Drama", "Comedy", "Documentary", "Sport", "Children", "Film", "Music", "Science Fiction", "Crime",
+            "Food &amp; Drink", "Talk Show", "Nature", "History", "Reality"}),
+  m_people()
+{
+  static const char* firstNames[] = {"Alex", "Sam", "Jordan", "Robin", "Charlie", "Morgan", "Casey", "Jamie", "Taylor", "Riley",
+                                     "Avery", "Quinn", "Drew", "Frankie", "Kit", "Lee"};
+  static const char* lastNames[] = {"Smith", "Jones", "Williams", "Brown", "Taylor", "Davies", "Evans", "Wilson", "Thomas",
+                                    "Johnson", "Roberts", "Walker", "Wright", "Robinson", "O'Neill", "Clarke"};
+  for (const char* first : firstNames)
+  {
+    for (const char* last : lastNames)
+      m_people.push_back(std::string(first) + " " + last);
+  }
+}
+
+int FixtureGenerator::GetChannelUid(int index) const
+{
+  return FIRST_CHANNEL_UID + index;
+}
+
+bool FixtureGenerator::IsRadio(int index) const
+{
+  return m_options.radioEvery > 0 && index % m_options.radioEvery == m_options.radioEvery - 1;
+}
+
+void FixtureGenerator::Seed(uint32_t stream)
+{
+  // std::mt19937 gives the same sequence everywhere, the std distributions do not
+  m_random.seed(m_options.seed * 2654435761u + stream);
+}
+
+uint32_t FixtureGenerator::Next(uint32_t limit)
+{
+  return static_cast<uint32_t>(m_random() % limit);
+}
+
+bool FixtureGenerator::Chance(uint32_t percent)
+{
+  return Next(100) < percent;
+}
+
+const std::string& FixtureGenerator::Pick(const std::vector<std::string>& values)
+{
+  return values[Next(static_cast<uint32_t>(values.size()))];
+}
+
+std::string FixtureGenerator::GetTitle(uint32_t index) const
+{
+  static const char* words[] = {"Morning", "Evening", "Coast", "Kitchen", "Mystery", "Garden", "Island", "Detectives", "Live",
+                                "Planet", "Street", "House", "Quiz", "Journey", "Chips", "Fish &amp;"};
+  constexpr uint32_t WORDS = sizeof(words) / sizeof(words[0]);
+  return std::string(words[index % WORDS]) + " " + words[(index / WORDS) % WORDS] + " " + std::to_string(index);
+}
+
+std::string FixtureGenerator::ChannelList()
+{
+  Seed(StreamChannels);
+  std::string text = "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n<rsp stat=\"ok\">\n<channels>\n";
+  for (int index = 0; index < m_options.channels; index++)
+  {
+    const bool radio = IsRadio(index);
+    text.append("<channel>");
+    AppendElement(text, "id", GetChannelUid(index));
+    AppendElement(text, "number", radio ? 700 + index : index + 1);
+    AppendElement(text, "minor", Chance(10) ? 1 + Next(4) : 0);
+    AppendElement(text, "name", (radio ? "Radio " : "Channel ") + std::to_string(index + 1));
+    AppendElement(text, "type", radio ? "0xa" : "0x1");
+    if (Chance(90))
+      AppendElement(text, "icon", "true");
+    AppendElement(text, "epg", Chance(3) ? "None" : "XMLTV");
+    if (m_options.groups > 0)
+    {
+      text.append("<groups>");
+      const uint32_t memberships = 1 + Next(3);
+      for (uint32_t group = 0; group < memberships; group++)
+        AppendElement(text, "group", "Group " + std::to_string(Next(static_cast<uint32_t>(m_options.groups)) + 1));
+      text.append("</groups>");
+    }
+    text.append("</channel>\n");
+  }
+  text.append("</channels>\n</rsp>\n");
+  return text;
+}
+
+std::string FixtureGenerator::ChannelListings(int channelUid)
+{
+  Seed(StreamListings + static_cast<uint32_t>(channelUid));
+  static const int durations[] = {15, 30, 30, 60, 60, 60, 90, 120};
+  std::string text = "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n<rsp stat=\"ok\">\n<listings>\n";
+  const time_t end = m_options.start + m_options.days * SECONDS_PER_DAY;
+  uint32_t oid = static_cast<uint32_t>(channelUid) * 100000;
+  for (time_t start = m_options.start; start < end; oid++)
+  {
+    const time_t stop = start + 60 * durations[Next(sizeof(durations) / sizeof(durations[0]))];
+    const uint32_t titleIndex = Next(TITLE_POOL);
+    const std::string title = GetTitle(titleIndex);
+    const bool series = titleIndex % 3 != 0;
+    const int season = 1 + static_cast<int>(titleIndex % 12);
+    const int episode = 1 + static_cast<int>(Next(24));
+    std::string subtitle;
+    std::string description;
+    if (series && Chance(30))
+    {
+      // the forms ParseListing cleans up, "SxxEyy" subtitles and episode markers in the text
+      char marker[16];
+      snprintf(marker, sizeof(marker), "S%02dE%02d", season, episode);
+      subtitle = marker;
+      description = "Episode " + std::to_string(episode) + " of the series. (Ep" + std::to_string(episode) + "/24)";
+    }
+    else if (series)
+    {
+      subtitle = "Part " + std::to_string(episode);
+      description = subtitle + ": " + title + " continues with another story of " + Pick(m_people) + ".";
+    }
+    else
+    {
+      // operands of + have no evaluation order, draw into locals so every compiler gives the same text
+      const std::string& genre = Pick(m_genres);
+      description = "A one off programme about " + genre + ", presented by " + Pick(m_people) + ".";
+    }
+
+    text.append("<l>");
+    AppendElement(text, "id", oid);
+    AppendElement(text, "name", title);
+    AppendElement(text, "description", description);
+    if (!subtitle.empty())
+      AppendElement(text, "subtitle", subtitle);
+    AppendElement(text, "start", static_cast<int64_t>(start) * 1000);
+    AppendElement(text, "end", static_cast<int64_t>(stop) * 1000);
+    if (Chance(70))
+    {
+      AppendElement(text, "genre", Pick(m_genres));
+    }
+    else
+    {
+      AppendElement(text, "genre_type", 16 * (1 + Next(10)));
+      AppendElement(text, "genre_subtype", Next(8));
+    }
+    text.append("<genres>");
+    const uint32_t genres = 1 + Next(3);
+    for (uint32_t genre = 0; genre < genres; genre++)
+      AppendElement(text, "genre", Pick(m_genres));
+    text.append("</genres>");
+    if (series)
+    {
+      AppendElement(text, "season", season);
+      AppendElement(text, "episode", episode);
+      AppendElement(text, "original", FormatDate(start - Next(3000) * SECONDS_PER_DAY, "%Y-%m-%d"));
+    }
+    else
+    {
+      AppendElement(text, "year", 1950 + Next(74));
+    }
+    if (Chance(20))
+      AppendElement(text, "firstrun", "true");
+    if (Chance(5))
+      AppendElement(text, "significance", "Live");
+    std::string cast = Pick(m_people);
+    for (uint32_t member = Next(5); member > 0; member--)
+      cast.append(", ").append(Pick(m_people));
+    AppendElement(text, "cast", cast);
+    const std::string& director = Pick(m_people);
+    AppendElement(text, "crew", "Director: " + director + ", Writer: " + Pick(m_people));
+    if (!series)
+      AppendElement(text, "star_rating", std::to_string(1 + Next(4)) + ".5/5");
+    text.append("</l>\n");
+    start = stop;
+  }
+  text.append("</listings>\n</rsp>\n");
+  return text;
+}
+
+std::string FixtureGenerator::RecordingList()
+{
+  Seed(StreamRecordings);
+  static const char* statuses[] = {"Ready", "Ready", "Ready", "Ready", "Ready", "Ready", "Failed", "Pending", "Conflict", "Recording"};
+  std::string text = "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n<rsp stat=\"ok\">\n<recordings>\n";
+  for (int index = 0; index < m_options.recordings; index++)
+  {
+    const char* status = statuses[Next(sizeof(statuses) / sizeof(statuses[0]))];
+    const bool future = status[0] == 'P' || status[0] == 'C';
+    const int channelIndex = static_cast<int>(Next(static_cast<uint32_t>(std::max(1, m_options.channels))));
+    const uint32_t titleIndex = Next(TITLE_POOL);
+    const std::string title = GetTitle(titleIndex);
+    // finished recordings go back up to a year, scheduled ones a fortnight ahead
+    const time_t start = future ? m_options.start + Next(14 * 48) * 1800 : m_options.start - 1800 - Next(365 * 48) * 1800;
+    const int duration = 1800 * static_cast<int>(1 + Next(4));
+    const int directory = static_cast<int>(Next(static_cast<uint32_t>(std::max(1, m_options.recordingDirectories))));
+
+    text.append("<recording>");
+    AppendElement(text, "id", 100000 + index);
+    AppendElement(text, "name", title);
+    const std::string& genre = Pick(m_genres);
+    AppendElement(text, "desc", "Recorded from " + genre + " with " + Pick(m_people) + ".");
+    if (titleIndex % 3 != 0)
+    {
+      const int episode = 1 + static_cast<int>(Next(24));
+      char subtitle[64];
+      snprintf(subtitle, sizeof(subtitle), "S%02dE%02d - Part %u", 1 + static_cast<int>(titleIndex % 12), episode, 1 + Next(24));
+      AppendElement(text, "subtitle", subtitle);
+    }
+    AppendElement(text, "start_time_ticks", static_cast<int64_t>(start));
+    AppendElement(text, "duration_seconds", duration);
+    AppendElement(text, "post_padding", Next(3) * 5);
+    AppendElement(text, "status", status);
+    if (status[0] == 'F')
+      AppendElement(text, "reason", "Tuner not available");
+    if (!future)
+    {
+      std::string file = directory == 0 ? "/recordings/" : "/recordings" + std::to_string(directory) + "/";
+      file.append(title).append("/").append(title).append(FormatDate(start, "_%Y%m%d_%H%M.ts"));
+      AppendElement(text, "file", file);
+      AppendElement(text, "size", static_cast<int64_t>(duration) * (1000000 + Next(3000000)));
+      AppendElement(text, "playback_position", Chance(30) ? Next(static_cast<uint32_t>(duration)) : 0);
+      AppendElement(text, "played", Chance(40) ? "true" : "false");
+    }
+    AppendElement(text, "channel", (IsRadio(channelIndex) ? "Radio " : "Channel ") + std::to_string(channelIndex + 1));
+    AppendElement(text, "channel_id", GetChannelUid(channelIndex));
+    if (Chance(60))
+    {
+      AppendElement(text, "epg_event_oid", 1000000 + Next(1000000));
+      AppendElement(text, "epg_end_time_ticks", static_cast<int64_t>(start + duration));
+    }
+    if (Chance(50))
+      AppendElement(text, "recurring_parent", 1 + Next(static_cast<uint32_t>(std::max(1, m_options.recurringRules))));
+    if (titleIndex % 3 == 0)
+      AppendElement(text, "year", 1950 + Next(74));
+    else
+      AppendElement(text, "original", FormatDate(start - Next(3000) * SECONDS_PER_DAY, "%Y-%m-%d"));
+    text.append("<genres>");
+    AppendElement(text, "genre", Pick(m_genres));
+    text.append("</genres>");
+    text.append("</recording>\n");
+  }
+  text.append("</recordings>\n</rsp>\n");
+  return text;
+}
+
+std::string FixtureGenerator::RecurringList()
+{
+  Seed(StreamRecurring);
+  static const int types[] = {1, 2, 3, 4, 5, 6, 7};
+  static const char* days[] = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
+  std::string text = "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n<rsp stat=\"ok\">\n<recurrings>\n";
+  for (int index = 0; index < m_options.recurringRules; index++)
+  {
+    const int type = types[Next(sizeof(types) / sizeof(types[0]))];
+    const std::string title = GetTitle(Next(TITLE_POOL));
+    const time_t start = m_options.start + Next(48) * 1800;
+
+    text.append("<recurring>");
+    AppendElement(text, "id", 1 + index);
+    AppendElement(text, "type", type);
+    AppendElement(text, "name", title);
+    text.append("<matchrules><Rules>");
+    AppendElement(text, "ChannelOID", Chance(20) ? 0 : GetChannelUid(static_cast<int>(Next(static_cast<uint32_t>(std::max(1, m_options.channels))))));
+    if (type != 3)
+      AppendElement(text, "EPGTitle", title);
+    AppendElement(text, "StartTimeTicks", static_cast<int64_t>(start));
+    AppendElement(text, "EndTimeTicks", static_cast<int64_t>(start + 1800 * (1 + Next(4))));
+    if (Chance(10))
+      AppendElement(text, "AdvancedRules", Chance(50) ? "KEYWORD: " + title : "title like '" + title + "%'");
+    std::string dayList;
+    for (const char* day : days)
+    {
+      if (Chance(50))
+        dayList.append(dayList.empty() ? "" : ":").append(day);
+    }
+    if (!dayList.empty())
+      AppendElement(text, "Days", dayList);
+    AppendElement(text, "PrePadding", Next(3) * 2);
+    AppendElement(text, "PostPadding", Next(3) * 5);
+    AppendElement(text, "Keep", Next(10));
+    AppendElement(text, "OnlyNewEpisodes", Chance(50) ? "true" : "false");
+    AppendElement(text, "RecordingDirectoryID", "[Default]");
+    text.append("</Rules>");
+    AppendElement(text, "enabled", Chance(95) ? "true" : "false");
+    text.append("</matchrules>");
+    text.append("</recurring>\n");
+  }
+  text.append("</recurrings>\n</rsp>\n");
+  return text;
+}
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace NextPVR
+{
+namespace test
+{
+
+struct FixtureOptions
+{
+  uint32_t seed = 1;
+  int channels = 2000;
+  int groups = 40;
+  // every radioEvery'th channel is a radio channel
+  int radioEvery = 20;
+  int days = 14;
+  int recordings = 50000;
+  int recordingDirectories = 4;
+  int recurringRules = 5000;
+  // listings and recordings are laid out from here, not from the clock
+  time_t start = 1697500800;
+};
+
+/*
+ * Writes backend responses shaped like the ones Channels, EPG, Recordings
+ * and Timers parse, at sizes no development server has.  Each response is
+ * drawn from its own stream seeded from the options, so the same options
+ * give the same text whatever order the responses are asked for in.
+ * Titles, genres and people come from small pools and repeat the way real
+ * guide data does.
+ */
+class FixtureGenerator
+{
+public:
+  explicit FixtureGenerator(const FixtureOptions& options);
+
+  int GetChannelUid(int index) const;
+  bool IsRadio(int index) const;
+
+  /* channel.list&extras=true */
+  std::string ChannelList();
+  /* channel.listings&channel_id=uid with extras, options.days from options.start */
+  std::string ChannelListings(int channelUid);
+  /* recording.list&filter=all */
+  std::string RecordingList();
+  /* recording.recurring.list */
+  std::string RecurringList();
+
+private:
+  void Seed(uint32_t stream);
+  uint32_t Next(uint32_t limit);
+  bool Chance(uint32_t percent);
+  const std::string& Pick(const std::vector<std::string>& values);
+  std::string GetTitle(uint32_t index) const;
+
+  const FixtureOptions m_options;
+  std::mt19937 m_random;
+  std::vector<std::string> m_genres;
+  std::vector<std::string> m_people;
+};
+
+} // namespace test
+} // namespace NextPVR
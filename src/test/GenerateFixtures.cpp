@@ -0,0 +1,94 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+/*
+ * nextpvr-fixtures [--seed N] [--channels N] [--groups N] [--days N]
+ *                  [--recordings N] [--directories N] [--recurring N] [directory]
+ *
+ * Writes channel.list.xml, one channel.listings.<uid>.xml per guide channel,
+ * recording.list.xml and recording.recurring.list.xml into directory.
+ */
+
+#include "FixtureGenerator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace NextPVR::test;
+
+namespace
+{
+bool WriteFixture(const std::string& filename, const std::string& text)
+{
+  FILE* file = fopen(filename.c_str(), "wb");
+  if (file == nullptr)
+  {
+    fprintf(stderr, "Cannot write %s\n", filename.c_str());
+    return false;
+  }
+  const bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+  return fclose(file) == 0 && written;
+}
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+  FixtureOptions options;
+  std::string directory = ".";
+  for (int i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    if (arg[0] != '-')
+    {
+      directory = arg;
+      continue;
+    }
+    if (i + 1 >= argc)
+    {
+      fprintf(stderr, "%s needs a value\n", arg);
+      return 1;
+    }
+    const int value = atoi(argv[++i]);
+    if (!strcmp(arg, "--seed"))
+      options.seed = static_cast<uint32_t>(value);
+    else if (!strcmp(arg, "--channels"))
+      options.channels = value;
+    else if (!strcmp(arg, "--groups"))
+      options.groups = value;
+    else if (!strcmp(arg, "--days"))
+      options.days = value;
+    else if (!strcmp(arg, "--recordings"))
+      options.recordings = value;
+    else if (!strcmp(arg, "--directories"))
+      options.recordingDirectories = value;
+    else if (!strcmp(arg, "--recurring"))
+      options.recurringRules = value;
+    else
+    {
+      fprintf(stderr, "Unknown option %s\n", arg);
+      return 1;
+    }
+  }
+
+  FixtureGenerator generator(options);
+  directory.append("/");
+  if (!WriteFixture(directory + "channel.list.xml", generator.ChannelList()) ||
+      !WriteFixture(directory + "recording.list.xml", generator.RecordingList()) ||
+      !WriteFixture(directory + "recording.recurring.list.xml", generator.RecurringList()))
+    return 1;
+  for (int index = 0; index < options.channels; index++)
+  {
+    const int channelUid = generator.GetChannelUid(index);
+    if (!WriteFixture(directory + "channel.listings." + std::to_string(channelUid) + ".xml", generator.ChannelListings(channelUid)))
+      return 1;
+  }
+  printf("Wrote %d channels, %d days of listings, %d recordings and %d recurring rules with seed %u to %s\n", options.channels,
+         options.days, options.recordings, options.recurringRules, options.seed, directory.c_str());
+  return 0;
+}
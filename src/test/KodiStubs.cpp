@@ -0,0 +1,32 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include <kodi/AddonBase.h>
+
+namespace
+{
+// kodi::Log goes through the table Kodi hands the add-on at creation, there is no Kodi here
+template<typename Handle>
+void DropLogMessage(Handle, const int, const char*)
+{
+}
+
+AddonToKodiFuncTable_Addon g_toKodi = [] {
+  AddonToKodiFuncTable_Addon toKodi{};
+  toKodi.addon_log_msg = DropLogMessage;
+  return toKodi;
+}();
+
+AddonGlobalInterface g_interface = [] {
+  AddonGlobalInterface addonInterface{};
+  addonInterface.toKodi = &g_toKodi;
+  return addonInterface;
+}();
+} // unnamed namespace
+
+// normally defined by ADDONCREATOR in addon.cpp, which the tests do not link
+AddonGlobalInterface* kodi::addon::CPrivateBase::m_interface = &g_interface;
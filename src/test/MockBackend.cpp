@@ -0,0 +1,556 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+/*
+ * nextpvr-mock-backend [--port N] [--latency MS] [--bandwidth KIB] [--stream-rate KIB]
+ *                      [--recording-size MIB] [--fixtures DIRECTORY] [--seed N]
+ *                      [--channels N] [--groups N] [--days N] [--recordings N]
+ *                      [--recurring N] [--verbose]
+ *
+ * A local stand-in for a NextPVR server.  It answers the /service methods
+ * the add-on uses and the /live streams, from generated responses or from
+ * files written by nextpvr-fixtures, so Channels, EPG, Recordings and the
+ * buffers can be timed without a backend.
+ *
+ * --latency delays every /service answer and --bandwidth caps how fast its
+ * body is sent, both per connection.  /live sends MPEG-TS null packets at
+ * --stream-rate, a recording is --recording-size long and can be read from
+ * any offset with a Range header.  Any login is accepted.
+ */
+
+#include "FixtureGenerator.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace NextPVR::test;
+
+namespace
+{
+struct MockOptions
+{
+  int port = 8866;
+  int latencyMilliseconds = 0;
+  // KiB per second, 0 for no limit
+  int bandwidth = 0;
+  int streamRate = 1024;
+  int recordingSize = 512;
+  std::string fixtures;
+  bool verbose = false;
+};
+
+constexpr size_t TS_PACKET_SIZE = 188;
+constexpr size_t SEND_CHUNK = 16 * 1024;
+constexpr int BACKEND_VERSION = 60100;
+
+const unsigned char ICON[] = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
+                              0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00, 0x00, 0x1F, 0x15, 0xC4,
+                              0x89, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x44, 0x41, 0x54, 0x78, 0xDA, 0x63, 0xF8, 0xFF, 0xFF, 0x3F,
+                              0x00, 0x05, 0xFE, 0x02, 0xFE, 0xA7, 0xD6, 0x05, 0xE5, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4E,
+                              0x44, 0xAE, 0x42, 0x60, 0x82};
+
+struct HttpRequest
+{
+  std::string path;
+  std::map<std::string, std::string> query;
+  std::map<std::string, std::string> headers;
+  bool keepAlive = true;
+};
+
+std::string UrlDecode(const std::string& text)
+{
+  std::string decoded;
+  for (size_t i = 0; i < text.length(); i++)
+  {
+    if (text[i] == '%' && i + 2 < text.length())
+    {
+      decoded += static_cast<char>(strtol(text.substr(i + 1, 2).c_str(), nullptr, 16));
+      i += 2;
+    }
+    else
+    {
+      decoded += text[i] == '+' ? ' ' : text[i];
+    }
+  }
+  return decoded;
+}
+
+std::string Lower(std::string text)
+{
+  for (char& c : text)
+    c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  return text;
+}
+
+bool ParseRequest(const std::string& head, HttpRequest& request)
+{
+  const size_t lineEnd = head.find("\r\n");
+  const std::string line = head.substr(0, lineEnd);
+  const size_t pathStart = line.find(' ');
+  const size_t pathEnd = line.rfind(' ');
+  if (pathStart == std::string::npos || pathEnd <= pathStart)
+    return false;
+
+  const std::string target = line.substr(pathStart + 1, pathEnd - pathStart - 1);
+  const size_t queryStart = target.find('?');
+  request.path = target.substr(0, queryStart);
+  if (queryStart != std::string::npos)
+  {
+    const std::string query = target.substr(queryStart + 1);
+    size_t start = 0;
+    while (start <= query.length())
+    {
+      size_t end = query.find('&', start);
+      if (end == std::string::npos)
+        end = query.length();
+      const std::string pair = query.substr(start, end - start);
+      const size_t equals = pair.find('=');
+      if (!pair.empty())
+        request.query[UrlDecode(pair.substr(0, equals))] = equals == std::string::npos ? "" : UrlDecode(pair.substr(equals + 1));
+      start = end + 1;
+    }
+  }
+
+  size_t pos = lineEnd;
+  while (pos != std::string::npos && pos + 2 < head.length())
+  {
+    const size_t next = head.find("\r\n", pos + 2);
+    const std::string header = head.substr(pos + 2, next == std::string::npos ? std::string::npos : next - pos - 2);
+    const size_t colon = header.find(':');
+    if (colon != std::string::npos)
+    {
+      size_t value = colon + 1;
+      while (value < header.length() && header[value] == ' ')
+        value++;
+      request.headers[Lower(header.substr(0, colon))] = header.substr(value);
+    }
+    pos = next;
+  }
+  request.keepAlive = Lower(request.headers["connection"]) != "close" && line.compare(pathEnd + 1, std::string::npos, "HTTP/1.0") != 0;
+  return true;
+}
+
+// MPEG-TS null packets with a running continuity counter, the same bytes for the same offset
+void FillStream(char* data, uint64_t offset, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    const uint64_t position = offset + i;
+    const size_t inPacket = static_cast<size_t>(position % TS_PACKET_SIZE);
+    switch (inPacket)
+    {
+      case 0:
+        data[i] = 0x47;
+        break;
+      case 1:
+        data[i] = 0x1F;
+        break;
+      case 2:
+        data[i] = static_cast<char>(0xFF);
+        break;
+      case 3:
+        data[i] = static_cast<char>(0x10 | ((position / TS_PACKET_SIZE) & 0x0F));
+        break;
+      default:
+        data[i] = static_cast<char>(0xFF);
+    }
+  }
+}
+
+class MockBackend
+{
+public:
+  MockBackend(const MockOptions& options, const FixtureOptions& fixtureOptions) :
+    m_options(options),
+    m_fixtureOptions(fixtureOptions),
+    m_generator(fixtureOptions),
+    m_started(time(nullptr))
+  {
+  }
+
+  bool Listen();
+  void Run();
+
+private:
+  MockBackend(MockBackend const&) = delete;
+  void operator=(MockBackend const&) = delete;
+
+  void Serve(int socket);
+  bool ServeMethod(int socket, const HttpRequest& request);
+  bool ServeStream(int socket, const HttpRequest& request);
+  std::string Answer(const std::string& method, const HttpRequest& request, std::string& contentType);
+  std::string Generated(const std::string& method, const HttpRequest& request);
+  bool ReadFixture(const std::string& name, std::string& text) const;
+  bool Send(int socket, const char* data, size_t length, int rate) const;
+  bool SendHeader(int socket, const char* status, const char* contentType, int64_t length, bool keepAlive,
+                  const std::string& extra = "") const;
+
+  const MockOptions m_options;
+  const FixtureOptions m_fixtureOptions;
+  // the generator draws from one random engine, one response at a time
+  std::mutex m_generatorMutex;
+  FixtureGenerator m_generator;
+  std::string m_channelList;
+  std::string m_recordingList;
+  std::string m_recurringList;
+  const time_t m_started;
+  int m_listener = -1;
+};
+
+bool MockBackend::Listen()
+{
+  m_listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (m_listener < 0)
+    return false;
+  const int reuse = 1;
+  setsockopt(m_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(static_cast<uint16_t>(m_options.port));
+  if (bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(m_listener, SOMAXCONN) != 0)
+  {
+    fprintf(stderr, "Cannot listen on port %d: %s\n", m_options.port, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+void MockBackend::Run()
+{
+  while (true)
+  {
+    const int connection = accept(m_listener, nullptr, nullptr);
+    if (connection < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      fprintf(stderr, "accept failed: %s\n", strerror(errno));
+      return;
+    }
+    const int noDelay = 1;
+    setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    std::thread(&MockBackend::Serve, this, connection).detach();
+  }
+}
+
+void MockBackend::Serve(int socket)
+{
+  std::string buffer;
+  char data[4096];
+  bool open = true;
+  while (open)
+  {
+    size_t headEnd;
+    while ((headEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+    {
+      const ssize_t received = recv(socket, data, sizeof(data), 0);
+      if (received <= 0 || buffer.length() > 64 * 1024)
+      {
+        close(socket);
+        return;
+      }
+      buffer.append(data, static_cast<size_t>(received));
+    }
+
+    HttpRequest request;
+    const bool parsed = ParseRequest(buffer.substr(0, headEnd), request);
+    // the add-on only sends GET, a body would be skipped here
+    buffer.erase(0, headEnd + 4);
+    if (!parsed)
+      break;
+
+    const auto start = std::chrono::steady_clock::now();
+    if (request.path == "/service")
+    {
+      open = ServeMethod(socket, request) && request.keepAlive;
+    }
+    else if (request.path == "/live")
+    {
+      ServeStream(socket, request);
+      open = false;
+    }
+    else
+    {
+      SendHeader(socket, "404 Not Found", "text/plain", 0, false);
+      open = false;
+    }
+
+    if (m_options.verbose)
+    {
+      const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+      auto method = request.query.find("method");
+      printf("%s %s %lld ms\n", request.path.c_str(), method != request.query.end() ? method->second.c_str() : "",
+             static_cast<long long>(milliseconds));
+      fflush(stdout);
+    }
+  }
+  close(socket);
+}
+
+bool MockBackend::ServeMethod(int socket, const HttpRequest& request)
+{
+  auto method = request.query.find("method");
+  std::string contentType = "text/xml; charset=utf-8";
+  const std::string body = Answer(method != request.query.end() ? method->second : "", request, contentType);
+
+  if (m_options.latencyMilliseconds > 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(m_options.latencyMilliseconds));
+  return SendHeader(socket, "200 OK", contentType.c_str(), static_cast<int64_t>(body.size()), request.keepAlive) &&
+         Send(socket, body.data(), body.size(), m_options.bandwidth);
+}
+
+bool MockBackend::ServeStream(int socket, const HttpRequest& request)
+{
+  std::string stream(SEND_CHUNK - SEND_CHUNK % TS_PACKET_SIZE, '\0');
+  if (request.query.count("recording") == 0)
+  {
+    // live TV has no end and no length
+    if (!SendHeader(socket, "200 OK", "video/mp2t", -1, false))
+      return false;
+    for (uint64_t offset = 0;; offset += stream.size())
+    {
+      FillStream(&stream[0], offset, stream.size());
+      if (!Send(socket, stream.data(), stream.size(), m_options.streamRate))
+        return true;
+    }
+  }
+
+  const uint64_t length = static_cast<uint64_t>(m_options.recordingSize) * 1024 * 1024;
+  uint64_t offset = 0;
+  auto range = request.headers.find("range");
+  std::string extra;
+  const char* status = "200 OK";
+  if (range != request.headers.end() && range->second.compare(0, 6, "bytes=") == 0)
+  {
+    offset = std::min<uint64_t>(strtoull(range->second.c_str() + 6, nullptr, 10), length);
+    extra = "Content-Range: bytes " + std::to_string(offset) + "-" + std::to_string(length - 1) + "/" + std::to_string(length) + "\r\n";
+    status = "206 Partial Content";
+  }
+  if (!SendHeader(socket, status, "video/mp2t", static_cast<int64_t>(length - offset), false, "Accept-Ranges: bytes\r\n" + extra))
+    return false;
+  while (offset < length)
+  {
+    const size_t chunk = static_cast<size_t>(std::min<uint64_t>(stream.size(), length - offset));
+    FillStream(&stream[0], offset, chunk);
+    if (!Send(socket, stream.data(), chunk, m_options.streamRate))
+      return true;
+    offset += chunk;
+  }
+  return true;
+}
+
+std::string MockBackend::Answer(const std::string& method, const HttpRequest& request, std::string& contentType)
+{
+  static const std::string OK = "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n<rsp stat=\"ok\">";
+  static const std::string END = "</rsp>\n";
+
+  // a recorded response wins over a generated one
+  std::string text;
+  auto channel = request.query.find("channel_id");
+  if (method == "channel.listings" && channel != request.query.end() && ReadFixture("channel.listings." + channel->second + ".xml", text))
+    return text;
+  if (ReadFixture(method + ".xml", text))
+    return text;
+
+  if (method == "session.initiate")
+    return OK + "<sid>mock-" + std::to_string(m_started) + "</sid><salt>mock-salt</salt>" + END;
+  if (method == "setting.list")
+  {
+    return OK + "<NextPVRVersion>" + std::to_string(BACKEND_VERSION) + "</NextPVRVersion><TimeEpoch>" + std::to_string(time(nullptr)) +
+           "</TimeEpoch><SlipSeconds>1800</SlipSeconds><PrePadding>1</PrePadding><PostPadding>2</PostPadding>"
+           "<ShowNewInGuide>false</ShowNewInGuide><RecordingDirectories></RecordingDirectories>" + END;
+  }
+  if (method == "recording.lastupdated" || method == "system.epg.summary")
+    return OK + "<last_update>" + std::to_string(m_started) + "</last_update>" + END;
+  if (method == "channel.groups")
+  {
+    std::string groups = OK + "<groups>";
+    for (int group = 1; group <= m_fixtureOptions.groups; group++)
+      groups += "<group><name>Group " + std::to_string(group) + "</name></group>";
+    return groups + "</groups>" + END;
+  }
+  if (method == "system.space")
+  {
+    return OK + "<directory name=\"Default\"><total>4000000000000</total><free>1500000000000</free></directory>" + END;
+  }
+  if (method == "channel.transcode.status")
+    return OK + "<percentage>100</percentage><final>true</final>" + END;
+  if (method == "channel.stream.info")
+  {
+    // raw XML, not a method response, for a stream that started with the server
+    const int64_t seconds = static_cast<int64_t>(time(nullptr) - m_started);
+    return "<map><stream_duration>" + std::to_string(seconds * 1000) + "</stream_duration><stream_length>" +
+           std::to_string(seconds * m_options.streamRate * 1024) + "</stream_length><complete>false</complete></map>";
+  }
+  if (method == "channel.icon")
+  {
+    contentType = "image/png";
+    return std::string(reinterpret_cast<const char*>(ICON), sizeof(ICON));
+  }
+  if (method == "setting.get")
+    return OK + "<value></value>" + END;
+  if (method == "session.login" || method == "session.logout" || method.compare(0, 15, "channel.stream.") == 0 ||
+      method.compare(0, 18, "channel.transcode.") == 0)
+    return OK + END;
+
+  text = Generated(method, request);
+  if (!text.empty())
+    return text;
+  return "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n<rsp stat=\"fail\"><err code=\"3\" msg=\"Unknown method\" /></rsp>\n";
+}
+
+std::string MockBackend::Generated(const std::string& method, const HttpRequest& request)
+{
+  std::unique_lock<std::mutex> lock(m_generatorMutex);
+  if (method == "channel.list")
+  {
+    if (m_channelList.empty())
+      m_channelList = m_generator.ChannelList();
+    return m_channelList;
+  }
+  if (method == "channel.listings")
+  {
+    auto channel = request.query.find("channel_id");
+    return channel != request.query.end() ? m_generator.ChannelListings(atoi(channel->second.c_str())) : std::string();
+  }
+  if (method == "recording.list")
+  {
+    if (m_recordingList.empty())
+      m_recordingList = m_generator.RecordingList();
+    return m_recordingList;
+  }
+  if (method == "recording.recurring.list")
+  {
+    if (m_recurringList.empty())
+      m_recurringList = m_generator.RecurringList();
+    return m_recurringList;
+  }
+  return std::string();
+}
+
+bool MockBackend::ReadFixture(const std::string& name, std::string& text) const
+{
+  if (m_options.fixtures.empty())
+    return false;
+  FILE* file = fopen((m_options.fixtures + "/" + name).c_str(), "rb");
+  if (file == nullptr)
+    return false;
+  text.clear();
+  char buffer[64 * 1024];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    text.append(buffer, read);
+  fclose(file);
+  return true;
+}
+
+bool MockBackend::Send(int socket, const char* data, size_t length, int rate) const
+{
+  // paced per chunk so the rate holds from the first byte
+  const auto start = std::chrono::steady_clock::now();
+  size_t sent = 0;
+  while (sent < length)
+  {
+    const ssize_t written = send(socket, data + sent, std::min(SEND_CHUNK, length - sent), 0);
+    if (written <= 0)
+      return false;
+    sent += static_cast<size_t>(written);
+    if (rate > 0)
+      std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<int64_t>(sent) * 1000000 / (static_cast<int64_t>(rate) * 1024)));
+  }
+  return true;
+}
+
+bool MockBackend::SendHeader(int socket, const char* status, const char* contentType, int64_t length, bool keepAlive,
+                             const std::string& extra) const
+{
+  std::string header = std::string("HTTP/1.1 ") + status + "\r\nServer: nextpvr-mock-backend\r\nContent-Type: " + contentType + "\r\n";
+  if (length >= 0)
+    header += "Content-Length: " + std::to_string(length) + "\r\n";
+  header += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+  header += extra + "\r\n";
+  return Send(socket, header.data(), header.size(), 0);
+}
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+  MockOptions options;
+  FixtureOptions fixtureOptions;
+  for (int i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    if (!strcmp(arg, "--verbose"))
+    {
+      options.verbose = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+    {
+      fprintf(stderr, "%s needs a value\n", arg);
+      return 1;
+    }
+    const char* value = argv[++i];
+    if (!strcmp(arg, "--fixtures"))
+      options.fixtures = value;
+    else if (!strcmp(arg, "--port"))
+      options.port = atoi(value);
+    else if (!strcmp(arg, "--latency"))
+      options.latencyMilliseconds = atoi(value);
+    else if (!strcmp(arg, "--bandwidth"))
+      options.bandwidth = atoi(value);
+    else if (!strcmp(arg, "--stream-rate"))
+      options.streamRate = atoi(value);
+    else if (!strcmp(arg, "--recording-size"))
+      options.recordingSize = atoi(value);
+    else if (!strcmp(arg, "--seed"))
+      fixtureOptions.seed = static_cast<uint32_t>(atoi(value));
+    else if (!strcmp(arg, "--channels"))
+      fixtureOptions.channels = atoi(value);
+    else if (!strcmp(arg, "--groups"))
+      fixtureOptions.groups = atoi(value);
+    else if (!strcmp(arg, "--days"))
+      fixtureOptions.days = atoi(value);
+    else if (!strcmp(arg, "--recordings"))
+      fixtureOptions.recordings = atoi(value);
+    else if (!strcmp(arg, "--recurring"))
+      fixtureOptions.recurringRules = atoi(value);
+    else
+    {
+      fprintf(stderr, "Unknown option %s\n", arg);
+      return 1;
+    }
+  }
+
+  // a client closing a stream early must not end the server
+  signal(SIGPIPE, SIG_IGN);
+  MockBackend backend(options, fixtureOptions);
+  if (!backend.Listen())
+    return 1;
+  printf("Serving %d channels, %d days of listings and %d recordings on port %d, %d ms latency\n", fixtureOptions.channels,
+         fixtureOptions.days, fixtureOptions.recordings, options.port, options.latencyMilliseconds);
+  fflush(stdout);
+  backend.Run();
+  return 1;
+}
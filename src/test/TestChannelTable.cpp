@@ -0,0 +1,121 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ChannelTable.h"
+#include "TestUtils.h"
+
+#include <gtest/gtest.h>
+
+using namespace NextPVR;
+
+TEST(ChannelTable, ParsesRecordedLineup)
+{
+  const std::string response = test::ReadFixture("channel.list.xml");
+  ChannelTable table;
+  ASSERT_TRUE(table.Parse(response.data(), response.size(), 1697500000));
+  ASSERT_EQ(table.Size(), 4u);
+  EXPECT_EQ(table.GetUpdateTime(), 1697500000);
+
+  EXPECT_EQ(table.GetId(0), 7165u);
+  EXPECT_EQ(table.GetNumber(0), 1u);
+  EXPECT_STREQ(table.GetName(0), "BBC One");
+  EXPECT_STREQ(table.GetEpgSource(0), "XMLTV");
+  EXPECT_TRUE(table.HasIcon(0));
+  EXPECT_FALSE(table.IsRadio(0));
+  ASSERT_EQ(table.GetGroupCount(0), 2u);
+  EXPECT_STREQ(table.GetGroup(0, 0), "Favourites");
+  EXPECT_STREQ(table.GetGroup(0, 1), "HD");
+
+  EXPECT_STREQ(table.GetName(1), "BBC Two & Four");
+  EXPECT_EQ(table.GetNumber(1), 2u);
+  EXPECT_EQ(table.GetMinor(1), 1u);
+  EXPECT_FALSE(table.HasIcon(1));
+
+  EXPECT_TRUE(table.IsEpgNone(2));
+  EXPECT_FALSE(table.HasGroups(2));
+  EXPECT_EQ(table.GetGroupCount(2), 0u);
+
+  EXPECT_TRUE(table.IsRadio(3));
+  EXPECT_STREQ(table.GetGroup(3, 0), "Favourites");
+}
+
+TEST(ChannelTable, RejectsFailedResponse)
+{
+  const std::string response = "<?xml version=\"1.0\" encoding=\"utf-8\" ?><rsp stat=\"fail\"><err code=\"8\" msg=\"Invalid Session\" /></rsp>";
+  ChannelTable table;
+  EXPECT_FALSE(table.Parse(response.data(), response.size(), 0));
+  EXPECT_EQ(table.Size(), 0u);
+}
+
+namespace
+{
+std::string ReplaceOnce(std::string text, const std::string& from, const std::string& to)
+{
+  const size_t pos = text.find(from);
+  EXPECT_NE(pos, std::string::npos) << from;
+  if (pos != std::string::npos)
+    text.replace(pos, from.length(), to);
+  return text;
+}
+
+void ParseLineup(const std::string& response, ChannelTable& table)
+{
+  ASSERT_TRUE(table.Parse(response.data(), response.size(), 0));
+}
+} // unnamed namespace
+
+TEST(ChannelTable, DiffOfSameLineupIsEmpty)
+{
+  const std::string response = test::ReadFixture("channel.list.xml");
+  ChannelTable before, after;
+  ParseLineup(response, before);
+  ParseLineup(response, after);
+  const ChannelDiff diff = ChannelTable::Diff(before, after);
+  EXPECT_FALSE(diff.HasChannelChanges());
+  EXPECT_FALSE(diff.HasGroupChanges());
+  EXPECT_EQ(before.GetLineupHash(), after.GetLineupHash());
+}
+
+TEST(ChannelTable, DiffCountsEachKindOfChange)
+{
+  const std::string response = test::ReadFixture("channel.list.xml");
+  std::string changed = ReplaceOnce(response, "<name>Radio 4</name>", "<name>Radio 4 Extra</name>");
+  changed = ReplaceOnce(changed, "<number>2</number>", "<number>22</number>");
+  changed = ReplaceOnce(changed, "<id>7170</id>", "<id>7171</id>");
+  changed = ReplaceOnce(changed, "<group>HD</group>\n      </groups>", "</groups>");
+  changed = ReplaceOnce(changed, "<name>BBC Two &amp; Four</name>\n      <type>0x1</type>\n",
+                        "<name>BBC Two &amp; Four</name>\n      <type>0x1</type>\n      <icon>true</icon>\n");
+
+  ChannelTable before, after;
+  ParseLineup(response, before);
+  ParseLineup(changed, after);
+  const ChannelDiff diff = ChannelTable::Diff(before, after);
+  EXPECT_EQ(diff.added, 1);
+  EXPECT_EQ(diff.removed, 1);
+  EXPECT_EQ(diff.renamed, 1);
+  EXPECT_EQ(diff.renumbered, 1);
+  EXPECT_EQ(diff.iconChanged, 1);
+  EXPECT_EQ(diff.iconChangedUids, std::vector<unsigned int>{7166});
+  EXPECT_EQ(diff.otherChanged, 0);
+  EXPECT_EQ(diff.groupsChanged, 1);
+  EXPECT_TRUE(diff.HasChannelChanges());
+  EXPECT_TRUE(diff.HasGroupChanges());
+}
+
+TEST(ChannelTable, DiffSeesGroupOnlyChanges)
+{
+  const std::string response = test::ReadFixture("channel.list.xml");
+  const std::string changed = ReplaceOnce(response, "<group>Favourites</group>\n        <group>HD</group>",
+                                          "<group>HD</group>\n        <group>Favourites</group>");
+  ChannelTable before, after;
+  ParseLineup(response, before);
+  ParseLineup(changed, after);
+  const ChannelDiff diff = ChannelTable::Diff(before, after);
+  EXPECT_FALSE(diff.HasChannelChanges());
+  EXPECT_TRUE(diff.HasGroupChanges());
+  EXPECT_EQ(diff.groupsChanged, 1);
+}
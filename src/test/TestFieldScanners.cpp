@@ -0,0 +1,122 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "utilities/FieldScanners.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <regex>
+#include <vector>
+
+using namespace NextPVR::utilities;
+
+namespace
+{
+// the patterns the scanners replaced, used the way EPG and Recordings used them
+
+bool RegexEpisodeMarker(const std::string& text, int& episode, int& part)
+{
+  static const std::regex pattern("^.*\\([eE][pP](\\d+)(?:/?(\\d+))?\\)");
+  std::smatch match;
+  if (!std::regex_search(text, match, pattern))
+    return false;
+  episode = std::atoi(match[1].str().c_str());
+  if (match[2].matched)
+    part = std::atoi(match[2].str().c_str());
+  return true;
+}
+
+bool RegexEpisodeFraction(const std::string& text, int& episode, int& part)
+{
+  static const std::regex pattern("^([1-9]\\d*)/([1-9]\\d*)\\.");
+  std::smatch match;
+  if (!std::regex_search(text, match, pattern))
+    return false;
+  episode = std::atoi(match[1].str().c_str());
+  part = std::atoi(match[2].str().c_str());
+  return true;
+}
+
+bool RegexStarRating(const std::string& text, double& quotient, double& denominator)
+{
+  static const std::regex pattern("(\\d+[.]?\\d*)(?:(?:/)(\\d+[.]?\\d*))?");
+  std::smatch match;
+  if (!std::regex_match(text, match, pattern))
+    return false;
+  quotient = std::atof(match[1].str().c_str());
+  denominator = std::atof(match[2].str().c_str());
+  return true;
+}
+
+bool RegexSeasonEpisode(const std::string& text, bool withName, SeasonEpisode& result)
+{
+  static const std::regex named("S(\\d{2,4})E(\\d+)(?: - ?(.+)$)?");
+  static const std::regex unnamed("S(\\d{2,4})E(\\d+)");
+  std::smatch match;
+  if (!std::regex_search(text, match, withName ? named : unnamed))
+    return false;
+  result.season = std::stoi(match[1].str());
+  result.episode = std::stoi(match[2].str());
+  result.hasName = withName && match[3].matched;
+  result.name = result.hasName ? match[3].str() : std::string();
+  return true;
+}
+
+void ExpectSameAsRegex(const std::string& text)
+{
+  int episode = -1, part = -1, regexEpisode = -1, regexPart = -1;
+  EXPECT_EQ(ScanEpisodeMarker(text, episode, part), RegexEpisodeMarker(text, regexEpisode, regexPart)) << text;
+  EXPECT_EQ(episode, regexEpisode) << text;
+  EXPECT_EQ(part, regexPart) << text;
+
+  episode = part = regexEpisode = regexPart = -1;
+  EXPECT_EQ(ScanEpisodeFraction(text, episode, part), RegexEpisodeFraction(text, regexEpisode, regexPart)) << text;
+  EXPECT_EQ(episode, regexEpisode) << text;
+  EXPECT_EQ(part, regexPart) << text;
+
+  double quotient = -1, denominator = -1, regexQuotient = -1, regexDenominator = -1;
+  EXPECT_EQ(ScanStarRating(text, quotient, denominator), RegexStarRating(text, regexQuotient, regexDenominator)) << text;
+  EXPECT_EQ(quotient, regexQuotient) << text;
+  EXPECT_EQ(denominator, regexDenominator) << text;
+
+  for (const bool withName : {false, true})
+  {
+    SeasonEpisode scanned, matched;
+    EXPECT_EQ(ScanSeasonEpisode(text, withName, scanned), RegexSeasonEpisode(text, withName, matched)) << text;
+    EXPECT_EQ(scanned.season, matched.season) << text;
+    EXPECT_EQ(scanned.episode, matched.episode) << text;
+    EXPECT_EQ(scanned.hasName, matched.hasName) << text;
+    EXPECT_EQ(scanned.name, matched.name) << text;
+  }
+}
+} // unnamed namespace
+
+TEST(FieldScanners, KnownFormsMatchRegex)
+{
+  const std::vector<std::string> texts = {
+      "", "(Ep1)", "Part one (Ep3/6)", "(ep12/13) then (EP4)", "(Ep4)\nsecond line (Ep5)", "(Ep)", "(Ep12x)", "(Ep1/)",
+      "(Ep123)", "(Ep1/2/3)", "1/6. The first part", "0/6. Not a part", "12/3.", "1/6 no dot", "3.5", "3.5/4", "7/10",
+      "4.", ".5", "3/", "3.5/4 stars", "S01E02", "S01E02 - Pilot", "S01E02 -Pilot", "S01E02 - ", "S01E02 -", "S1E02",
+      "S12345E1", "S0102E03 - A name\nwith a break", "Show S2023E100 - Finale", "xS01E02yS03E04 - Later", "S01E"};
+  for (const std::string& text : texts)
+    ExpectSameAsRegex(text);
+}
+
+TEST(FieldScanners, RandomTextMatchesRegex)
+{
+  // short strings over the characters the patterns care about
+  static const char alphabet[] = "EePpS()/.-  0123456789x\n";
+  std::mt19937 random(23);
+  for (int i = 0; i < 5000; i++)
+  {
+    std::string text;
+    const size_t length = random() % 16;
+    for (size_t c = 0; c < length; c++)
+      text.push_back(alphabet[random() % (sizeof(alphabet) - 1)]);
+    ExpectSameAsRegex(text);
+  }
+}
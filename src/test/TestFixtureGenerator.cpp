@@ -0,0 +1,82 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ChannelTable.h"
+#include "FixtureGenerator.h"
+#include "utilities/XMLRecordReader.h"
+
+#include <gtest/gtest.h>
+
+using namespace NextPVR;
+using namespace NextPVR::test;
+using namespace NextPVR::utilities;
+
+namespace
+{
+FixtureOptions SmallOptions()
+{
+  FixtureOptions options;
+  options.channels = 40;
+  options.days = 2;
+  options.recordings = 300;
+  options.recurringRules = 50;
+  return options;
+}
+
+int CountRecords(const std::string& response, const char* recordTag)
+{
+  XMLRecordReader reader(recordTag, [](tinyxml2::XMLElement*) {});
+  if (!reader.Feed(response.data(), response.size()) || reader.Finish() != tinyxml2::XML_SUCCESS)
+    return -1;
+  return reader.Records();
+}
+} // unnamed namespace
+
+TEST(FixtureGenerator, SameSeedGivesSameResponses)
+{
+  FixtureGenerator first(SmallOptions());
+  FixtureGenerator second(SmallOptions());
+  // asked for in another order, each response has a stream of its own
+  const std::string recordings = second.RecordingList();
+  EXPECT_EQ(first.ChannelList(), second.ChannelList());
+  EXPECT_EQ(first.ChannelListings(first.GetChannelUid(3)), second.ChannelListings(second.GetChannelUid(3)));
+  EXPECT_EQ(first.RecordingList(), recordings);
+  EXPECT_EQ(first.RecurringList(), second.RecurringList());
+
+  FixtureOptions options = SmallOptions();
+  options.seed = 2;
+  FixtureGenerator other(options);
+  EXPECT_NE(first.RecordingList(), other.RecordingList());
+}
+
+TEST(FixtureGenerator, LineupParsesIntoChannelTable)
+{
+  const FixtureOptions options = SmallOptions();
+  FixtureGenerator generator(options);
+  const std::string response = generator.ChannelList();
+  ChannelTable table;
+  ASSERT_TRUE(table.Parse(response.data(), response.size(), 0));
+  ASSERT_EQ(table.Size(), static_cast<size_t>(options.channels));
+  for (size_t row = 0; row < table.Size(); row++)
+  {
+    EXPECT_EQ(table.GetId(row), static_cast<unsigned int>(generator.GetChannelUid(static_cast<int>(row))));
+    EXPECT_EQ(table.IsRadio(row), generator.IsRadio(static_cast<int>(row)));
+    EXPECT_TRUE(table.HasGroups(row));
+  }
+}
+
+TEST(FixtureGenerator, ResponsesStreamAsRecords)
+{
+  const FixtureOptions options = SmallOptions();
+  FixtureGenerator generator(options);
+  EXPECT_EQ(CountRecords(generator.RecordingList(), "recording"), options.recordings);
+  EXPECT_EQ(CountRecords(generator.RecurringList(), "recurring"), options.recurringRules);
+  // listings are back to back and run from 15 minutes to two hours
+  const int listings = CountRecords(generator.ChannelListings(generator.GetChannelUid(0)), "l");
+  EXPECT_GE(listings, options.days * 24 / 2);
+  EXPECT_LE(listings, options.days * 24 * 4);
+}
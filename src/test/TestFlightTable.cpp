@@ -0,0 +1,185 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "utilities/FlightTable.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+
+using namespace NextPVR::utilities;
+
+namespace
+{
+constexpr int LINGER_MS = 60000;
+
+// a fetch that answers with the number of fetches so far
+class CountingFetch
+{
+public:
+  bool operator()(std::string& response)
+  {
+    response = std::to_string(++m_fetches);
+    return true;
+  }
+  int Fetches() const { return m_fetches; }
+
+private:
+  std::atomic<int> m_fetches{0};
+};
+
+std::string Join(FlightTable& flights, CountingFetch& fetch, bool& shared)
+{
+  std::string response;
+  EXPECT_TRUE(flights.Join("recording.list", response, shared, std::ref(fetch)));
+  return response;
+}
+} // unnamed namespace
+
+TEST(FlightTable, LingeringResponseIsShared)
+{
+  FlightTable flights(LINGER_MS);
+  CountingFetch fetch;
+  bool shared;
+  EXPECT_EQ(Join(flights, fetch, shared), "1");
+  EXPECT_FALSE(shared);
+  EXPECT_EQ(Join(flights, fetch, shared), "1");
+  EXPECT_TRUE(shared);
+
+  std::string response;
+  EXPECT_TRUE(flights.Share("recording.list", response));
+  EXPECT_EQ(response, "1");
+  EXPECT_FALSE(flights.Share("channel.list", response));
+  EXPECT_EQ(fetch.Fetches(), 1);
+  EXPECT_EQ(flights.GetShared(), 2u);
+}
+
+TEST(FlightTable, ExpiredResponseIsFetchedAgain)
+{
+  FlightTable flights(0);
+  CountingFetch fetch;
+  bool shared;
+  Join(flights, fetch, shared);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_EQ(Join(flights, fetch, shared), "2");
+  EXPECT_FALSE(shared);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  std::string response;
+  EXPECT_FALSE(flights.Share("recording.list", response));
+}
+
+TEST(FlightTable, FailureIsNotShared)
+{
+  FlightTable flights(LINGER_MS);
+  std::string response;
+  bool shared;
+  EXPECT_FALSE(flights.Join("recording.list", response, shared, [](std::string&) { return false; }));
+  EXPECT_FALSE(flights.Share("recording.list", response));
+  CountingFetch fetch;
+  EXPECT_EQ(Join(flights, fetch, shared), "1");
+  EXPECT_FALSE(shared);
+}
+
+TEST(FlightTable, InvalidateDropsLingeringResponse)
+{
+  FlightTable flights(LINGER_MS);
+  CountingFetch fetch;
+  bool shared;
+  Join(flights, fetch, shared);
+  flights.Invalidate();
+  std::string response;
+  EXPECT_FALSE(flights.Share("recording.list", response));
+  EXPECT_EQ(Join(flights, fetch, shared), "2");
+  EXPECT_FALSE(shared);
+}
+
+TEST(FlightTable, InvalidateDropsFlightStillRunning)
+{
+  // a list fetched while a change was being made must not linger once the change is done
+  FlightTable flights(LINGER_MS);
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool started = false;
+  bool release = false;
+  std::thread list([&] {
+    std::string response;
+    bool shared;
+    flights.Join("recording.list", response, shared, [&](std::string& text) {
+      std::unique_lock<std::mutex> lock(mutex);
+      started = true;
+      changed.notify_all();
+      changed.wait(lock, [&] { return release; });
+      text = "before";
+      return true;
+    });
+  });
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return started; });
+  }
+
+  flights.Invalidate();
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    release = true;
+  }
+  changed.notify_all();
+  list.join();
+
+  std::string response;
+  EXPECT_FALSE(flights.Share("recording.list", response));
+  CountingFetch fetch;
+  bool shared;
+  EXPECT_EQ(Join(flights, fetch, shared), "1");
+  EXPECT_FALSE(shared);
+}
+
+TEST(FlightTable, OverlappingRequestsShareOneFetch)
+{
+  FlightTable flights(LINGER_MS);
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool started = false;
+  bool release = false;
+  std::atomic<int> fetches{0};
+  auto fetch = [&](std::string& text) {
+    fetches++;
+    std::unique_lock<std::mutex> lock(mutex);
+    started = true;
+    changed.notify_all();
+    changed.wait(lock, [&] { return release; });
+    text = "list";
+    return true;
+  };
+
+  std::string first;
+  bool firstShared;
+  std::thread owner([&] { flights.Join("recording.list", first, firstShared, fetch); });
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return started; });
+  }
+  std::string second;
+  bool secondShared = false;
+  std::thread joiner([&] { flights.Join("recording.list", second, secondShared, fetch); });
+  // the joiner shares the owner's fetch whether it starts waiting before or after the fetch ends
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    release = true;
+  }
+  changed.notify_all();
+  owner.join();
+  joiner.join();
+  EXPECT_EQ(fetches, 1);
+  EXPECT_EQ(first, "list");
+  EXPECT_EQ(second, "list");
+  EXPECT_FALSE(firstShared);
+  EXPECT_TRUE(secondShared);
+}
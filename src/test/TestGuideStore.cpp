@@ -0,0 +1,130 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "GuideStore.h"
+
+#include <gtest/gtest.h>
+
+using namespace NextPVR;
+
+namespace
+{
+constexpr time_t START = 1697500800;
+constexpr time_t HOUR = 3600;
+constexpr time_t WINDOW = 3 * 24 * HOUR;
+constexpr uint32_t SETTINGS = 0x5;
+
+// hourly listings over the window, the channel uid and hour make each one distinct
+void FillStore(GuideStore& store, int channelUid)
+{
+  std::shared_ptr<utilities::StringPool> strings = std::make_shared<utilities::StringPool>();
+  std::vector<EpgEvent> events;
+  for (time_t start = START; start < START + WINDOW; start += HOUR)
+  {
+    EpgEvent event;
+    event.start = start;
+    event.end = start + HOUR;
+    event.broadcastId = static_cast<unsigned int>(channelUid * 1000 + (start - START) / HOUR);
+    event.genreType = 0x10;
+    event.season = 2;
+    event.episode = static_cast<int>((start - START) / HOUR);
+    event.title = strings->Intern("Title " + std::to_string(channelUid));
+    event.plot = "Plot " + std::to_string(event.broadcastId);
+    event.genreDescription = strings->Intern("Drama");
+    event.cast = strings->Intern("One,Two");
+    events.push_back(std::move(event));
+  }
+  store.Replace(channelUid, START, START + WINDOW, std::move(events), strings);
+}
+
+std::string SaveStore()
+{
+  GuideStore store;
+  FillStore(store, 7165);
+  FillStore(store, 7166);
+  std::string data;
+  EXPECT_TRUE(store.Serialize(START + 42, SETTINGS, data));
+  return data;
+}
+} // unnamed namespace
+
+TEST(GuideStore, LoadedGuideIsAnsweredFromMemory)
+{
+  GuideStore saved;
+  FillStore(saved, 7165);
+  FillStore(saved, 7166);
+  std::string data;
+  ASSERT_TRUE(saved.Serialize(START + 42, SETTINGS, data));
+
+  GuideStore loaded;
+  time_t lastUpdate = 0;
+  ASSERT_TRUE(loaded.Deserialize(std::move(data), SETTINGS, START, lastUpdate));
+  EXPECT_EQ(lastUpdate, START + 42);
+  EXPECT_EQ(loaded.Channels(), 2u);
+  EXPECT_EQ(loaded.Events(), saved.Events());
+
+  for (const int channelUid : {7165, 7166})
+  {
+    std::vector<EpgEvent> expected, actual;
+    std::shared_ptr<const utilities::StringPool> expectedStrings, actualStrings;
+    ASSERT_TRUE(saved.Get(channelUid, START + HOUR, START + 5 * HOUR, expected, expectedStrings));
+    ASSERT_TRUE(loaded.Get(channelUid, START + HOUR, START + 5 * HOUR, actual, actualStrings));
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++)
+    {
+      EXPECT_EQ(actual[i].start, expected[i].start);
+      EXPECT_EQ(actual[i].end, expected[i].end);
+      EXPECT_EQ(actual[i].broadcastId, expected[i].broadcastId);
+      EXPECT_EQ(actual[i].genreType, expected[i].genreType);
+      EXPECT_EQ(actual[i].season, expected[i].season);
+      EXPECT_EQ(actual[i].episode, expected[i].episode);
+      EXPECT_EQ(actual[i].title, expected[i].title);
+      EXPECT_EQ(actual[i].plot, expected[i].plot);
+      EXPECT_EQ(actual[i].genreDescription, expected[i].genreDescription);
+      EXPECT_EQ(actual[i].cast, expected[i].cast);
+      EXPECT_EQ(actual[i].director, expected[i].director);
+    }
+  }
+
+  // outside the saved window and for other channels Kodi goes to the backend
+  std::vector<EpgEvent> events;
+  std::shared_ptr<const utilities::StringPool> strings;
+  EXPECT_FALSE(loaded.Get(7165, START, START + WINDOW + HOUR, events, strings));
+  EXPECT_FALSE(loaded.Get(7170, START, START + HOUR, events, strings));
+}
+
+TEST(GuideStore, LoadLeavesOutPastListings)
+{
+  GuideStore loaded;
+  time_t lastUpdate;
+  ASSERT_TRUE(loaded.Deserialize(SaveStore(), SETTINGS, START + 30 * HOUR, lastUpdate));
+  EXPECT_EQ(loaded.Events(), 2u * (WINDOW / HOUR - 30));
+
+  time_t from, to;
+  ASSERT_TRUE(loaded.GetCoverage(7165, from, to));
+  EXPECT_EQ(from, START + 30 * HOUR);
+  EXPECT_EQ(to, START + WINDOW);
+}
+
+TEST(GuideStore, LoadRefusesOtherSettings)
+{
+  GuideStore loaded;
+  time_t lastUpdate;
+  EXPECT_FALSE(loaded.Deserialize(SaveStore(), SETTINGS + 1, START, lastUpdate));
+  EXPECT_EQ(loaded.Channels(), 0u);
+}
+
+TEST(GuideStore, LoadRefusesDamagedGuide)
+{
+  std::string data = SaveStore();
+  GuideStore loaded;
+  time_t lastUpdate;
+  EXPECT_FALSE(loaded.Deserialize(data.substr(0, data.size() - 1), SETTINGS, START, lastUpdate));
+  data[data.size() / 2] ^= 0x5a;
+  EXPECT_FALSE(loaded.Deserialize(std::move(data), SETTINGS, START, lastUpdate));
+  EXPECT_EQ(loaded.Channels(), 0u);
+}
@@ -0,0 +1,168 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "utilities/SlotPool.h"
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace NextPVR::utilities;
+
+namespace
+{
+constexpr int HIGH = 0;
+constexpr int NORMAL = 1;
+constexpr int BULK = 2;
+
+void WaitForQueue(const SlotPool& slots, int lane, int depth)
+{
+  while (slots.GetQueueDepth(lane) != depth)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+} // unnamed namespace
+
+TEST(SlotPool, GrantsUpToTheLimit)
+{
+  SlotPool slots([] { return 2; }, 60000);
+  bool promoted;
+  slots.Acquire(NORMAL, promoted);
+  slots.Acquire(NORMAL, promoted);
+  EXPECT_EQ(slots.GetActive(), 2);
+
+  std::atomic<bool> granted{false};
+  std::thread waiter([&] {
+    bool promoted;
+    slots.Acquire(NORMAL, promoted);
+    granted = true;
+  });
+  WaitForQueue(slots, NORMAL, 1);
+  EXPECT_FALSE(granted);
+  slots.Release();
+  waiter.join();
+  EXPECT_TRUE(granted);
+  EXPECT_EQ(slots.GetActive(), 2);
+  EXPECT_EQ(slots.GetPeakQueueDepth(NORMAL), 1);
+}
+
+TEST(SlotPool, GrantsInLaneOrder)
+{
+  SlotPool slots([] { return 1; }, 60000);
+  bool promoted;
+  slots.Acquire(HIGH, promoted);
+
+  std::mutex mutex;
+  std::vector<int> order;
+  std::vector<std::thread> waiters;
+  for (const int lane : {BULK, NORMAL, HIGH})
+  {
+    waiters.emplace_back([&, lane] {
+      bool promoted;
+      slots.Acquire(lane, promoted);
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        order.push_back(lane);
+      }
+      slots.Release();
+    });
+    WaitForQueue(slots, lane, 1);
+  }
+  slots.Release();
+  for (std::thread& waiter : waiters)
+    waiter.join();
+  EXPECT_EQ(order, (std::vector<int>{HIGH, NORMAL, BULK}));
+  EXPECT_EQ(slots.GetPromotions(), 0u);
+}
+
+TEST(SlotPool, BulkLeavesLastSlotFree)
+{
+  SlotPool slots([] { return 2; }, 60000);
+  bool promoted;
+  slots.Acquire(HIGH, promoted);
+
+  std::atomic<bool> bulkGranted{false};
+  std::thread bulk([&] {
+    bool promoted;
+    slots.Acquire(BULK, promoted);
+    bulkGranted = true;
+    slots.Release();
+  });
+  WaitForQueue(slots, BULK, 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(bulkGranted);
+
+  // the free slot still goes to a more urgent lane
+  slots.Acquire(NORMAL, promoted);
+  slots.Release();
+  slots.Release();
+  bulk.join();
+  EXPECT_TRUE(bulkGranted);
+}
+
+TEST(SlotPool, AgingPromotesWaitingBulk)
+{
+  SlotPool slots([] { return 1; }, 20);
+  bool promoted;
+  slots.Acquire(HIGH, promoted);
+
+  std::atomic<bool> bulkPromoted{false};
+  std::atomic<int> grants{0};
+  std::atomic<int> bulkGrant{-1};
+  std::thread bulk([&] {
+    bool promoted;
+    slots.Acquire(BULK, promoted);
+    bulkPromoted = promoted;
+    bulkGrant = grants++;
+    slots.Release();
+  });
+  WaitForQueue(slots, BULK, 1);
+  // two aging periods take bulk to the top lane, ahead of a normal request queued after it
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  std::thread normal([&] {
+    bool promoted;
+    slots.Acquire(NORMAL, promoted);
+    grants++;
+    slots.Release();
+  });
+  WaitForQueue(slots, NORMAL, 1);
+  slots.Release();
+  bulk.join();
+  normal.join();
+  EXPECT_EQ(bulkGrant, 0);
+  EXPECT_TRUE(bulkPromoted);
+  EXPECT_EQ(slots.GetPromotions(), 1u);
+}
+
+TEST(SlotPool, AgingGrantsWithoutRelease)
+{
+  // bulk is kept off the last free slot only until it has aged out of its lane
+  SlotPool slots([] { return 2; }, 20);
+  bool promoted;
+  slots.Acquire(HIGH, promoted);
+  std::thread bulk([&] {
+    bool promoted;
+    slots.Acquire(BULK, promoted);
+    EXPECT_TRUE(promoted);
+  });
+  bulk.join();
+  EXPECT_EQ(slots.GetActive(), 2);
+  EXPECT_EQ(slots.GetPromotions(), 1u);
+}
+
+TEST(SlotPool, LimitIsReadOnEachAcquire)
+{
+  std::atomic<int> limit{1};
+  SlotPool slots([&] { return limit.load(); }, 60000);
+  bool promoted;
+  slots.Acquire(NORMAL, promoted);
+  limit = 2;
+  // would block for ever under the old limit
+  slots.Acquire(NORMAL, promoted);
+  EXPECT_EQ(slots.GetActive(), 2);
+}
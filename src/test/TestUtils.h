@@ -0,0 +1,31 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace NextPVR
+{
+namespace test
+{
+
+/* \brief Reads a recorded backend response from the fixtures directory.
+   \return the response text, empty if the fixture is missing
+*/
+inline std::string ReadFixture(const std::string& name)
+{
+  std::ifstream file(std::string(NEXTPVR_FIXTURE_DIR) + name, std::ios::binary);
+  std::ostringstream text;
+  text << file.rdbuf();
+  return text.str();
+}
+
+} // namespace test
+} // namespace NextPVR
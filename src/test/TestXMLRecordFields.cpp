@@ -0,0 +1,71 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "utilities/XMLRecordFields.h"
+
+#include <cstdlib>
+#include <gtest/gtest.h>
+
+using namespace NextPVR::utilities;
+
+TEST(XMLRecordFields, ParseIntegerMatchesAtoi)
+{
+  for (const char* text : {"0", "42", "-17", "+8", "  12", "\t-3", "12abc", "abc", "", "-", "+", "2147483647", "-2147483648", "007", " + 5"})
+  {
+    EXPECT_EQ(ParseInteger<int32_t>(text), std::atoi(text)) << text;
+    EXPECT_EQ(ParseInteger<int64_t>(text), std::atoll(text)) << text;
+  }
+  EXPECT_EQ(ParseInteger<int64_t>("1697533200000"), 1697533200000LL);
+}
+
+TEST(XMLRecordFields, ParseIntegerStopsAtMaxLength)
+{
+  // millisecond timestamps are read as seconds
+  EXPECT_EQ(ParseInteger<int64_t>("1697533200000", 10), 1697533200LL);
+  EXPECT_EQ(ParseInteger<int64_t>("1697533200", 10), 1697533200LL);
+  EXPECT_EQ(ParseInteger<int64_t>("123", 10), 123LL);
+}
+
+TEST(XMLRecordFields, ParseIntegerRejectsOverflow)
+{
+  EXPECT_EQ(ParseInteger<int32_t>("2147483648"), 0);
+  EXPECT_EQ(ParseInteger<int64_t>("2147483648"), 2147483648LL);
+}
+
+TEST(XMLRecordFields, ParseBooleanSwitches)
+{
+  for (const char* text : {"true", "TRUE", "Yes", "on", "Enabled"})
+  {
+    bool value = false;
+    EXPECT_TRUE(ParseBoolean(text, value)) << text;
+    EXPECT_TRUE(value) << text;
+  }
+  for (const char* text : {"false", "False", "NO", "off", "disabled", "0"})
+  {
+    bool value = true;
+    EXPECT_TRUE(ParseBoolean(text, value)) << text;
+    EXPECT_FALSE(value) << text;
+  }
+  // other text is not a switch but still reads as true
+  for (const char* text : {"1", "", "truely", "maybe"})
+  {
+    bool value = false;
+    EXPECT_FALSE(ParseBoolean(text, value)) << text;
+    EXPECT_TRUE(value) << text;
+  }
+}
+
+TEST(XMLRecordFields, FieldTableFindsEveryName)
+{
+  constexpr auto table = MakeFieldTable("name", "description", "start", "end", "genre", "genres");
+  EXPECT_EQ(table.Find("name"), 0);
+  EXPECT_EQ(table.Find("description"), 1);
+  EXPECT_EQ(table.Find("genres"), 5);
+  EXPECT_EQ(table.Find("genre"), 4);
+  EXPECT_EQ(table.Find("gen"), -1);
+  EXPECT_EQ(table.Find("subtitle"), -1);
+}
@@ -0,0 +1,173 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "TestUtils.h"
+#include "utilities/XMLRecordReader.h"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <tinyxml2.h>
+#include <vector>
+
+using namespace NextPVR;
+using namespace NextPVR::utilities;
+
+namespace
+{
+// every record as the reader handed it over, printed back to text
+std::vector<std::string> StreamRecords(const std::string& response, const char* recordTag, size_t chunk, tinyxml2::XMLError& status)
+{
+  std::vector<std::string> records;
+  XMLRecordReader reader(recordTag, [&](tinyxml2::XMLElement* record) {
+    tinyxml2::XMLPrinter printer;
+    record->Accept(&printer);
+    records.emplace_back(printer.CStr());
+  });
+  for (size_t offset = 0; offset < response.size(); offset += chunk)
+  {
+    if (!reader.Feed(response.data() + offset, std::min(chunk, response.size() - offset)))
+      break;
+  }
+  status = reader.Finish();
+  return records;
+}
+
+// the same records found in a DOM of the whole response
+std::vector<std::string> ParseRecords(const std::string& response, const char* recordTag)
+{
+  std::vector<std::string> records;
+  tinyxml2::XMLDocument doc;
+  if (doc.Parse(response.data(), response.size()) != tinyxml2::XML_SUCCESS)
+    return records;
+  const tinyxml2::XMLElement* list = doc.RootElement()->FirstChildElement();
+  for (const tinyxml2::XMLElement* record = list->FirstChildElement(recordTag); record; record = record->NextSiblingElement(recordTag))
+  {
+    tinyxml2::XMLPrinter printer;
+    record->Accept(&printer);
+    records.emplace_back(printer.CStr());
+  }
+  return records;
+}
+
+void ExpectStreamsLikeDocument(const std::string& response, const char* recordTag, size_t expected, const char* name)
+{
+  ASSERT_FALSE(response.empty()) << name;
+  const std::vector<std::string> parsed = ParseRecords(response, recordTag);
+  ASSERT_EQ(parsed.size(), expected) << name;
+
+  // any chunking of the response has to give the same records
+  for (const size_t chunk : {static_cast<size_t>(1), static_cast<size_t>(7), static_cast<size_t>(256), response.size()})
+  {
+    tinyxml2::XMLError status;
+    const std::vector<std::string> streamed = StreamRecords(response, recordTag, chunk, status);
+    EXPECT_EQ(status, tinyxml2::XML_SUCCESS) << name << " chunk " << chunk;
+    EXPECT_EQ(streamed, parsed) << name << " chunk " << chunk;
+  }
+}
+
+void ExpectSameAsDocument(const char* fixture, const char* recordTag, size_t expected)
+{
+  ExpectStreamsLikeDocument(test::ReadFixture(fixture), recordTag, expected, fixture);
+}
+} // unnamed namespace
+
+TEST(XMLRecordReader, StreamsListingsLikeDocument)
+{
+  ExpectSameAsDocument("channel.listings.xml", "l", 3);
+}
+
+TEST(XMLRecordReader, StreamsRecordingsLikeDocument)
+{
+  // <recording> must not match the <recordings> list around it
+  ExpectSameAsDocument("recording.list.xml", "recording", 2);
+}
+
+TEST(XMLRecordReader, StreamsEmptyRecords)
+{
+  ExpectStreamsLikeDocument("<?xml version=\"1.0\" encoding=\"utf-8\" ?><rsp stat=\"ok\"><listings>"
+                            "<l/><l id=\"2\" /><l><id>3</id></l><l note='a/'/></listings></rsp>",
+                            "l", 4, "empty records");
+}
+
+TEST(XMLRecordReader, StreamsRecordsWithMarkupInText)
+{
+  // an end tag inside CDATA or a comment does not end the record
+  ExpectSameAsDocument("channel.listings.cdata.xml", "l", 3);
+}
+
+TEST(XMLRecordReader, EmptyListIsSuccess)
+{
+  tinyxml2::XMLError status;
+  const std::vector<std::string> records =
+      StreamRecords("<?xml version=\"1.0\" encoding=\"utf-8\" ?><rsp stat=\"ok\"><listings></listings></rsp>", "l", 5, status);
+  EXPECT_EQ(status, tinyxml2::XML_SUCCESS);
+  EXPECT_TRUE(records.empty());
+}
+
+TEST(XMLRecordReader, TruncatedResponseIsReported)
+{
+  // a connection dropped inside the second record or before </rsp> is not a short list
+  const std::string response = test::ReadFixture("channel.listings.xml");
+  const size_t second = response.find("<l>", response.find("</l>"));
+  ASSERT_NE(second, std::string::npos);
+  const size_t listEnd = response.find("</listings>");
+  ASSERT_NE(listEnd, std::string::npos);
+  for (const size_t length : {second + 20, listEnd, response.find("</rsp>") + 3})
+  {
+    for (const size_t chunk : {static_cast<size_t>(1), static_cast<size_t>(7), length})
+    {
+      tinyxml2::XMLError status;
+      StreamRecords(response.substr(0, length), "l", chunk, status);
+      EXPECT_EQ(status, tinyxml2::XML_ERROR_PARSING) << "length " << length << " chunk " << chunk;
+    }
+  }
+}
+
+TEST(XMLRecordReader, ExpiredSessionIsReported)
+{
+  // the session is dropped on this code, whatever the record tag
+  const std::string response = test::ReadFixture("session.expired.xml");
+  for (const size_t chunk : {static_cast<size_t>(1), static_cast<size_t>(7), response.size()})
+  {
+    tinyxml2::XMLError status;
+    EXPECT_TRUE(StreamRecords(response, "l", chunk, status).empty());
+    EXPECT_EQ(status, tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED) << "chunk " << chunk;
+  }
+}
+
+TEST(XMLRecordReader, OtherFailureIsReported)
+{
+  tinyxml2::XMLError status;
+  StreamRecords("<rsp stat=\"fail\"><err code=\"3\" msg=\"Not found\" /></rsp>", "l", 4, status);
+  EXPECT_EQ(status, tinyxml2::XML_NO_ATTRIBUTE);
+  StreamRecords("<rsp stat=\"fail\"></rsp>", "l", 4, status);
+  EXPECT_EQ(status, tinyxml2::XML_NO_ATTRIBUTE);
+  StreamRecords("<rsp></rsp>", "l", 4, status);
+  EXPECT_EQ(status, tinyxml2::XML_NO_ATTRIBUTE);
+}
+
+TEST(XMLRecordReader, EnvelopeStatusIsTheAttribute)
+{
+  // the status is read from the <rsp> start tag, not searched for in its text
+  tinyxml2::XMLError status;
+  EXPECT_EQ(StreamRecords("<rsp stat='ok' note='a > b'><listings><l><id>1</id></l></listings></rsp>", "l", 3, status).size(), 1u);
+  EXPECT_EQ(status, tinyxml2::XML_SUCCESS);
+  EXPECT_TRUE(StreamRecords("<rsp note='stat=\"ok\"' stat=\"fail\"><listings><l><id>1</id></l></listings></rsp>", "l", 3, status).empty());
+  EXPECT_EQ(status, tinyxml2::XML_NO_ATTRIBUTE);
+}
+
+TEST(XMLRecordReader, CheckResponseStatus)
+{
+  tinyxml2::XMLDocument doc;
+  ASSERT_EQ(doc.Parse("<rsp stat=\"ok\" />"), tinyxml2::XML_SUCCESS);
+  EXPECT_EQ(CheckResponseStatus(doc.RootElement()), tinyxml2::XML_SUCCESS);
+  ASSERT_EQ(doc.Parse("<rsp stat=\"fail\"><err code=\"8\" /></rsp>"), tinyxml2::XML_SUCCESS);
+  EXPECT_EQ(CheckResponseStatus(doc.RootElement()), tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED);
+  ASSERT_EQ(doc.Parse("<rsp stat=\"fail\"><err code=\"80\" /></rsp>"), tinyxml2::XML_SUCCESS);
+  EXPECT_EQ(CheckResponseStatus(doc.RootElement()), tinyxml2::XML_NO_ATTRIBUTE);
+  EXPECT_EQ(CheckResponseStatus(nullptr), tinyxml2::XML_NO_ATTRIBUTE);
+}
@@ -0,0 +1,168 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "FieldScanners.h"
+
+#include <cstdlib>
+
+using namespace NextPVR::utilities;
+
+namespace
+{
+inline bool IsDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+// what ECMAScript's "." refuses
+inline bool IsLineTerminator(char c)
+{
+  return c == '\n' || c == '\r';
+}
+
+size_t SkipDigits(const std::string& text, size_t pos)
+{
+  while (pos < text.length() && IsDigit(text[pos]))
+    pos++;
+  return pos;
+}
+
+// \d+[.]?\d* from pos, returns the end or npos
+size_t ScanNumber(const std::string& text, size_t pos)
+{
+  const size_t digits = SkipDigits(text, pos);
+  if (digits == pos)
+    return std::string::npos;
+  if (digits < text.length() && text[digits] == '.')
+    return SkipDigits(text, digits + 1);
+  return digits;
+}
+} // unnamed namespace
+
+bool NextPVR::utilities::ScanEpisodeMarker(const std::string& text, int& episode, int& part)
+{
+  // ^.* cannot cross a line break and backtracks from the right, so the last marker on the first line wins
+  size_t lineEnd = 0;
+  while (lineEnd < text.length() && !IsLineTerminator(text[lineEnd]))
+    lineEnd++;
+
+  for (size_t open = text.rfind('(', lineEnd); open != std::string::npos; open = open == 0 ? std::string::npos : text.rfind('(', open - 1))
+  {
+    if (open >= lineEnd || open + 3 >= text.length() || (text[open + 1] != 'e' && text[open + 1] != 'E') ||
+        (text[open + 2] != 'p' && text[open + 2] != 'P'))
+      continue;
+
+    const size_t first = open + 3;
+    const size_t firstEnd = SkipDigits(text, first);
+    if (firstEnd == first || firstEnd >= text.length())
+      continue;
+
+    if (text[firstEnd] == ')')
+    {
+      episode = std::atoi(text.substr(first, firstEnd - first).c_str());
+      return true;
+    }
+    if (text[firstEnd] == '/')
+    {
+      const size_t second = firstEnd + 1;
+      const size_t secondEnd = SkipDigits(text, second);
+      if (secondEnd != second && secondEnd < text.length() && text[secondEnd] == ')')
+      {
+        episode = std::atoi(text.substr(first, firstEnd - first).c_str());
+        part = std::atoi(text.substr(second, secondEnd - second).c_str());
+        return true;
+      }
+    }
+    // "(ep12x)" and friends cannot be rescued by splitting the digits differently
+  }
+  return false;
+}
+
+bool NextPVR::utilities::ScanEpisodeFraction(const std::string& text, int& episode, int& part)
+{
+  if (text.empty() || text[0] < '1' || text[0] > '9')
+    return false;
+  const size_t slash = SkipDigits(text, 1);
+  if (slash >= text.length() || text[slash] != '/')
+    return false;
+  const size_t second = slash + 1;
+  if (second >= text.length() || text[second] < '1' || text[second] > '9')
+    return false;
+  const size_t dot = SkipDigits(text, second + 1);
+  if (dot >= text.length() || text[dot] != '.')
+    return false;
+
+  episode = std::atoi(text.substr(0, slash).c_str());
+  part = std::atoi(text.substr(second, dot - second).c_str());
+  return true;
+}
+
+bool NextPVR::utilities::ScanStarRating(const std::string& text, double& quotient, double& denominator)
+{
+  const size_t firstEnd = ScanNumber(text, 0);
+  if (firstEnd == std::string::npos)
+    return false;
+
+  if (firstEnd == text.length())
+  {
+    quotient = std::atof(text.c_str());
+    denominator = 0;
+    return true;
+  }
+  if (text[firstEnd] != '/')
+    return false;
+  const size_t secondEnd = ScanNumber(text, firstEnd + 1);
+  if (secondEnd != text.length())
+    return false;
+
+  quotient = std::atof(text.substr(0, firstEnd).c_str());
+  denominator = std::atof(text.substr(firstEnd + 1).c_str());
+  return true;
+}
+
+bool NextPVR::utilities::ScanSeasonEpisode(const std::string& text, bool withName, SeasonEpisode& result)
+{
+  for (size_t s = text.find('S'); s != std::string::npos; s = text.find('S', s + 1))
+  {
+    // \d{2,4} followed by E, a longer run of digits never reaches the E
+    const size_t season = s + 1;
+    const size_t seasonEnd = SkipDigits(text, season);
+    const size_t seasonLength = seasonEnd - season;
+    if (seasonLength < 2 || seasonLength > 4 || seasonEnd >= text.length() || text[seasonEnd] != 'E')
+      continue;
+    const size_t episode = seasonEnd + 1;
+    const size_t episodeEnd = SkipDigits(text, episode);
+    if (episodeEnd == episode)
+      continue;
+
+    result.season = std::stoi(text.substr(season, seasonLength));
+    result.episode = std::stoi(text.substr(episode, episodeEnd - episode));
+    result.hasName = false;
+    result.name.clear();
+    if (withName && text.compare(episodeEnd, 2, " -") == 0)
+    {
+      // (.+)$ takes the rest of the text when no line break is left in it
+      size_t name = episodeEnd + 2;
+      bool terminated = false;
+      for (size_t pos = name; pos < text.length(); pos++)
+        terminated |= IsLineTerminator(text[pos]);
+      if (!terminated)
+      {
+        // " ?" is greedy but gives its space back when nothing else is left
+        if (name < text.length() && text[name] == ' ' && name + 1 < text.length())
+          name++;
+        if (name < text.length())
+        {
+          result.hasName = true;
+          result.name = text.substr(name);
+        }
+      }
+    }
+    return true;
+  }
+  return false;
+}
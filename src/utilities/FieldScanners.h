@@ -0,0 +1,60 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <string>
+
+namespace NextPVR
+{
+namespace utilities
+{
+/*
+ * Hand written replacements for the std::regex patterns once used on
+ * guide and recording text.  Each scanner gives the same answer as the
+ * ECMAScript pattern it is named after, including where an ambiguous
+ * pattern would pick its match, and converts the captured digits with the
+ * same atoi, stoi or atof call the regex code used.
+ */
+
+/*
+ * ^.*\([eE][pP](\d+)(?:/?(\d+))?\)
+ * The last "(EpN)" or "(EpN/M)" on the first line.  part is left alone
+ * when there is no "/M".
+ */
+bool ScanEpisodeMarker(const std::string& text, int& episode, int& part);
+
+/*
+ * ^([1-9]\d*)/([1-9]\d*)\.
+ * A leading "N/M." part numbering.
+ */
+bool ScanEpisodeFraction(const std::string& text, int& episode, int& part);
+
+/*
+ * (\d+[.]?\d*)(?:/(\d+[.]?\d*))? matched against the whole text.
+ * denominator is 0 when the rating has no "/".
+ */
+bool ScanStarRating(const std::string& text, double& quotient, double& denominator);
+
+struct SeasonEpisode
+{
+  int season = 0;
+  int episode = 0;
+  bool hasName = false;
+  std::string name;
+};
+
+/*
+ * S(\d{2,4})E(\d+)(?: - ?(.+)$)?
+ * The first "SxxEyy" anywhere in the text.  With withName the rest of the
+ * text after " - " or " -" becomes the name when it reaches the end
+ * without a line break.
+ */
+bool ScanSeasonEpisode(const std::string& text, bool withName, SeasonEpisode& result);
+
+} // namespace utilities
+} // namespace NextPVR
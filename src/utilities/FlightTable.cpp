@@ -0,0 +1,93 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "FlightTable.h"
+
+using namespace NextPVR::utilities;
+
+FlightTable::FlightTable(int lingerMilliseconds) :
+  m_linger(lingerMilliseconds)
+{
+}
+
+bool FlightTable::IsLingering(const Flight& flight, std::chrono::steady_clock::time_point now) const
+{
+  return !flight.done || now <= flight.finished + m_linger;
+}
+
+bool FlightTable::Join(const std::string& key, std::string& response, bool& shared, const std::function<bool(std::string&)>& fetch)
+{
+  shared = false;
+  std::shared_ptr<Flight> flight;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // drop finished flights past the linger window so large lists are not held on to
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = m_flights.begin(); it != m_flights.end();)
+    {
+      if (!IsLingering(*it->second, now))
+        it = m_flights.erase(it);
+      else
+        ++it;
+    }
+    auto it = m_flights.find(key);
+    if (it != m_flights.end())
+    {
+      flight = it->second;
+      m_flightDone.wait(lock, [&flight] { return flight->done; });
+      m_shared++;
+      shared = true;
+      response = flight->response;
+      return flight->success;
+    }
+    flight = std::make_shared<Flight>();
+    m_flights[key] = flight;
+  }
+
+  const bool success = fetch(response);
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    flight->success = success;
+    if (success)
+      flight->response = response;
+    flight->finished = std::chrono::steady_clock::now();
+    flight->done = true;
+    auto it = m_flights.find(key);
+    if (!success && it != m_flights.end() && it->second == flight)
+      m_flights.erase(it);
+  }
+  m_flightDone.notify_all();
+  return success;
+}
+
+bool FlightTable::Share(const std::string& key, std::string& response)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_flights.find(key);
+  if (it == m_flights.end())
+    return false;
+  std::shared_ptr<Flight> flight = it->second;
+  m_flightDone.wait(lock, [&flight] { return flight->done; });
+  if (!flight->success || !IsLingering(*flight, std::chrono::steady_clock::now()))
+    return false;
+  m_shared++;
+  response = flight->response;
+  return true;
+}
+
+void FlightTable::Invalidate()
+{
+  // callers already waiting keep their flight, it is only taken out of the table
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_flights.clear();
+}
+
+unsigned int FlightTable::GetShared() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_shared;
+}
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+/*
+ * Identical requests that overlap, or arrive within lingerMilliseconds of
+ * the last one finishing, share one round trip.  Each caller gets its own
+ * copy of the response text.  A failed fetch is never shared after it
+ * finishes.
+ */
+class FlightTable
+{
+public:
+  explicit FlightTable(int lingerMilliseconds);
+
+  /* \brief Waits for and shares the identical request in flight or lingering, or runs fetch for it.
+     \param[out] shared true when the response came from another caller's fetch
+     \return what fetch returned
+  */
+  bool Join(const std::string& key, std::string& response, bool& shared, const std::function<bool(std::string&)>& fetch);
+  // shares a request in flight or lingering without ever fetching
+  bool Share(const std::string& key, std::string& response);
+  // nothing fetched or fetching before this call is shared with later callers
+  void Invalidate();
+
+  unsigned int GetShared() const;
+
+private:
+  FlightTable(FlightTable const&) = delete;
+  void operator=(FlightTable const&) = delete;
+
+  struct Flight
+  {
+    bool done = false;
+    bool success = false;
+    std::string response;
+    std::chrono::steady_clock::time_point finished;
+  };
+
+  bool IsLingering(const Flight& flight, std::chrono::steady_clock::time_point now) const;
+
+  const std::chrono::milliseconds m_linger;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_flightDone;
+  std::map<std::string, std::shared_ptr<Flight>> m_flights;
+  unsigned int m_shared = 0;
+};
+
+} // namespace utilities
+} // namespace NextPVR
@@ -0,0 +1,50 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+/*
+ * 64-bit FNV-1a, used to notice when cached backend data changed.  Not
+ * suitable for anything an attacker controls the collisions of.
+ */
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+inline uint64_t HashBytes(uint64_t hash, const void* data, size_t length)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < length; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+inline uint64_t HashString(uint64_t hash, const char* value)
+{
+  // include the terminator so "ab","c" and "a","bc" differ
+  return HashBytes(hash, value, strlen(value) + 1);
+}
+
+inline uint64_t HashString(uint64_t hash, std::string_view value)
+{
+  const char terminator = '\0';
+  return HashBytes(HashBytes(hash, value.data(), value.length()), &terminator, 1);
+}
+
+} // namespace utilities
+} // namespace NextPVR
@@ -0,0 +1,92 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "MappedFile.h"
+
+#include "kodi/Filesystem.h"
+#include "kodi/General.h"
+
+#if defined(TARGET_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace NextPVR::utilities;
+
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+  Close();
+  const std::string path = kodi::vfs::TranslateSpecialProtocol(filename);
+
+#if defined(TARGET_WINDOWS)
+  // Windows will not rename over a mapped file, so the file is read and not held
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart <= MAXDWORD)
+  {
+    m_copy.resize(static_cast<size_t>(size.QuadPart));
+    DWORD read = 0;
+    if (ReadFile(file, m_copy.data(), static_cast<DWORD>(m_copy.size()), &read, nullptr) && read == m_copy.size())
+    {
+      m_data = m_copy.data();
+      m_size = m_copy.size();
+    }
+  }
+  CloseHandle(file);
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+  {
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED)
+    {
+      m_data = data;
+      m_size = static_cast<size_t>(st.st_size);
+    }
+  }
+  // the mapping keeps its own reference to the file
+  close(fd);
+#endif
+
+  if (m_data == nullptr)
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "MappedFile cannot read %s", path.c_str());
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(TARGET_WINDOWS)
+  std::vector<char>().swap(m_copy);
+#else
+  if (m_data != nullptr)
+    munmap(m_data, m_size);
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
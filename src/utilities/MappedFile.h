@@ -0,0 +1,51 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#if defined(TARGET_WINDOWS)
+#include <vector>
+#endif
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+/*
+ * Read-only memory map of a local file.  Takes a special:// path, the file
+ * stays mapped until the object is destroyed.  On Windows a mapped file
+ * cannot be replaced by a rename, so there the file is read into memory
+ * and a newer version may be renamed over it while the old one is in use.
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  bool Open(const std::string& filename);
+  void Close();
+
+  const void* Data() const { return m_data; }
+  size_t Size() const { return m_size; }
+
+private:
+  MappedFile(MappedFile const&) = delete;
+  void operator=(MappedFile const&) = delete;
+
+  void* m_data{nullptr};
+  size_t m_size{0};
+#if defined(TARGET_WINDOWS)
+  std::vector<char> m_copy;
+#endif
+};
+
+} // namespace utilities
+} // namespace NextPVR
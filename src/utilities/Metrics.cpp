@@ -0,0 +1,198 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "Metrics.h"
+
+#include "kodi/Filesystem.h"
+#include "kodi/General.h"
+#include "kodi/tools/StringUtils.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NextPVR::utilities;
+
+void Histogram::Record(uint64_t value)
+{
+  m_counts[BucketIndex(value)]++;
+  m_count++;
+  m_sum += value;
+  m_max = std::max(m_max, value);
+}
+
+int Histogram::BucketIndex(uint64_t value)
+{
+  if (value < SUB_BUCKETS)
+    return static_cast<int>(value);
+
+  int magnitude = 0;
+  for (uint64_t v = value; v >>= 1;)
+    magnitude++;
+  if (magnitude > MAX_MAGNITUDE)
+    return BUCKETS - 1;
+
+  const int subBucket = static_cast<int>((value >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+  return SUB_BUCKETS + (magnitude - SUB_BUCKET_BITS) * SUB_BUCKETS + subBucket;
+}
+
+uint64_t Histogram::BucketValue(int index)
+{
+  // highest value that lands in the bucket
+  if (index < SUB_BUCKETS)
+    return index;
+
+  const int magnitude = (index - SUB_BUCKETS) / SUB_BUCKETS + SUB_BUCKET_BITS;
+  const uint64_t subBucket = (index - SUB_BUCKETS) % SUB_BUCKETS;
+  return ((SUB_BUCKETS + subBucket + 1) << (magnitude - SUB_BUCKET_BITS)) - 1;
+}
+
+uint64_t Histogram::Percentile(double percentile) const
+{
+  if (m_count == 0)
+    return 0;
+
+  const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * m_count)));
+  uint64_t seen = 0;
+  for (int i = 0; i < BUCKETS; i++)
+  {
+    seen += m_counts[i];
+    if (seen >= target)
+      return std::min(BucketValue(i), m_max);
+  }
+  return m_max;
+}
+
+void Metrics::RecordRequest(const std::string& method, int64_t waitMicroseconds, int64_t serviceMicroseconds, int64_t bytes)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  MethodMetrics& metrics = m_methods[method];
+  metrics.wait.Record(std::max<int64_t>(0, waitMicroseconds));
+  metrics.service.Record(std::max<int64_t>(0, serviceMicroseconds));
+  metrics.bytes.Record(std::max<int64_t>(0, bytes));
+}
+
+void Metrics::RecordParse(const std::string& method, int64_t parseMicroseconds)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_methods[method].parse.Record(std::max<int64_t>(0, parseMicroseconds));
+}
+
+void Metrics::RecordPhase(const std::string& phase, int64_t microseconds)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_phases[phase].Record(std::max<int64_t>(0, microseconds));
+}
+
+std::string Metrics::GetSummary() const
+{
+  // the phase and method names are not translated, only the figures around them
+  const std::string phaseCalls = kodi::addon::GetLocalizedString(30231);
+  const std::string requests = kodi::addon::GetLocalizedString(30232);
+  const std::string service = kodi::addon::GetLocalizedString(30233);
+  const std::string wait = kodi::addon::GetLocalizedString(30234);
+  const std::string parse = kodi::addon::GetLocalizedString(30235);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::string summary;
+  for (const auto& phase : m_phases)
+  {
+    summary += kodi::tools::StringUtils::Format("[B]%s[/B]  ", phase.first.c_str());
+    summary += kodi::tools::StringUtils::Format(phaseCalls.c_str(),
+                                                static_cast<unsigned long long>(phase.second.Count()), phase.second.Percentile(50) / 1000.0,
+                                                phase.second.Percentile(95) / 1000.0, phase.second.Max() / 1000.0) + "\n";
+  }
+  if (!m_phases.empty())
+    summary += "\n";
+  for (const auto& method : m_methods)
+  {
+    const MethodMetrics& metrics = method.second;
+    summary += kodi::tools::StringUtils::Format("[B]%s[/B]  ", method.first.c_str());
+    summary += kodi::tools::StringUtils::Format(requests.c_str(), static_cast<unsigned long long>(metrics.service.Count()),
+                                                metrics.bytes.Mean()) + "\n  ";
+    summary += kodi::tools::StringUtils::Format(service.c_str(),
+                                                metrics.service.Percentile(50) / 1000.0, metrics.service.Percentile(95) / 1000.0,
+                                                metrics.service.Percentile(99) / 1000.0, metrics.service.Max() / 1000.0) + "\n  ";
+    summary += kodi::tools::StringUtils::Format(wait.c_str(),
+                                                metrics.wait.Percentile(50) / 1000.0, metrics.wait.Percentile(95) / 1000.0,
+                                                metrics.wait.Percentile(99) / 1000.0, metrics.wait.Max() / 1000.0) + "\n";
+    if (metrics.parse.Count() != 0)
+      summary += "  " + kodi::tools::StringUtils::Format(parse.c_str(),
+                                                         metrics.parse.Percentile(50) / 1000.0, metrics.parse.Percentile(95) / 1000.0,
+                                                         metrics.parse.Max() / 1000.0) + "\n";
+  }
+  return summary;
+}
+
+bool Metrics::WriteJSON(const std::string& filename) const
+{
+  auto histogram = [](const char* name, const Histogram& h) {
+    return kodi::tools::StringUtils::Format(
+        "\"%s\": {\"count\": %llu, \"mean\": %.1f, \"p50\": %llu, \"p90\": %llu, \"p95\": %llu, \"p99\": %llu, \"max\": %llu}", name,
+        static_cast<unsigned long long>(h.Count()), h.Mean(), static_cast<unsigned long long>(h.Percentile(50)),
+        static_cast<unsigned long long>(h.Percentile(90)), static_cast<unsigned long long>(h.Percentile(95)),
+        static_cast<unsigned long long>(h.Percentile(99)), static_cast<unsigned long long>(h.Max()));
+  };
+
+  std::string json = "{\n  \"methods\": {";
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool first = true;
+    for (const auto& method : m_methods)
+    {
+      std::string name = method.first;
+      kodi::tools::StringUtils::Replace(name, "\\", "\\\\");
+      kodi::tools::StringUtils::Replace(name, "\"", "\\\"");
+      json += kodi::tools::StringUtils::Format("%s\n    \"%s\": {\n      %s,\n      %s,\n      %s,\n      %s\n    }", first ? "" : ",",
+                                               name.c_str(), histogram("service_us", method.second.service).c_str(),
+                                               histogram("wait_us", method.second.wait).c_str(),
+                                               histogram("parse_us", method.second.parse).c_str(),
+                                               histogram("bytes", method.second.bytes).c_str());
+      first = false;
+    }
+  }
+  json += "\n  },\n  \"phases\": {";
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool first = true;
+    for (const auto& phase : m_phases)
+    {
+      json += kodi::tools::StringUtils::Format("%s\n    %s", first ? "" : ",", histogram(phase.first.c_str(), phase.second).c_str());
+      first = false;
+    }
+  }
+  json += "\n  }\n}\n";
+
+  // write beside the old file and swap, a reader never sees half of it
+  const std::string tempFile = filename + ".tmp";
+  kodi::vfs::CFile file;
+  if (!file.OpenFileForWrite(tempFile, true))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot write metrics to %s", tempFile.c_str());
+    return false;
+  }
+  const bool written = file.Write(json.c_str(), json.length()) == static_cast<ssize_t>(json.length());
+  file.Close();
+  if (!written || !kodi::vfs::RenameFile(tempFile, filename))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Cannot replace metrics %s", filename.c_str());
+    kodi::vfs::DeleteFile(tempFile);
+    return false;
+  }
+  return true;
+}
+
+ScopedPhase::ScopedPhase(Metrics& metrics, const char* phase) :
+  m_metrics(metrics),
+  m_phase(phase),
+  m_start(std::chrono::steady_clock::now())
+{
+}
+
+ScopedPhase::~ScopedPhase()
+{
+  const int64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+  m_metrics.RecordPhase(m_phase, microseconds);
+}
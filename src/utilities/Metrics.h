@@ -0,0 +1,105 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+/*
+ * Log-linear histogram in the style of HdrHistogram: 16 linear sub-buckets
+ * per power of two keep every recorded value within about 6% while the
+ * whole histogram is a fixed array of counters.
+ */
+class Histogram
+{
+public:
+  void Record(uint64_t value);
+
+  uint64_t Count() const { return m_count; }
+  uint64_t Max() const { return m_max; }
+  double Mean() const { return m_count == 0 ? 0.0 : static_cast<double>(m_sum) / m_count; }
+  uint64_t Percentile(double percentile) const;
+
+private:
+  static constexpr int SUB_BUCKET_BITS = 4;
+  static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr int MAX_MAGNITUDE = 40;
+  static constexpr int BUCKETS = SUB_BUCKETS + (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  static int BucketIndex(uint64_t value);
+  static uint64_t BucketValue(int index);
+
+  std::array<uint32_t, BUCKETS> m_counts{};
+  uint64_t m_count{0};
+  uint64_t m_sum{0};
+  uint64_t m_max{0};
+};
+
+/*
+ * Always-on timing for backend requests, keyed by method name.  Times are
+ * recorded in microseconds so sub-millisecond parses still register.
+ */
+class Metrics
+{
+public:
+  Metrics() = default;
+
+  void RecordRequest(const std::string& method, int64_t waitMicroseconds, int64_t serviceMicroseconds, int64_t bytes);
+  void RecordParse(const std::string& method, int64_t parseMicroseconds);
+  void RecordPhase(const std::string& phase, int64_t microseconds);
+
+  std::string GetSummary() const;
+  bool WriteJSON(const std::string& filename) const;
+
+private:
+  Metrics(Metrics const&) = delete;
+  void operator=(Metrics const&) = delete;
+
+  struct MethodMetrics
+  {
+    Histogram service;
+    Histogram wait;
+    Histogram parse;
+    Histogram bytes;
+  };
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, MethodMetrics> m_methods;
+  std::map<std::string, Histogram> m_phases;
+};
+
+/*
+ * Times one client entry point (connect, channel load, EPG fetch, stream
+ * open ...) end to end, including everything it waits on.
+ */
+class ScopedPhase
+{
+public:
+  ScopedPhase(Metrics& metrics, const char* phase);
+  ~ScopedPhase();
+
+private:
+  ScopedPhase(ScopedPhase const&) = delete;
+  void operator=(ScopedPhase const&) = delete;
+
+  Metrics& m_metrics;
+  const char* m_phase;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace utilities
+} // namespace NextPVR
@@ -0,0 +1,143 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ResponseCache.h"
+
+#include "kodi/General.h"
+#include "kodi/tools/StringUtils.h"
+
+using namespace NextPVR::utilities;
+
+namespace
+{
+// resource prefix, ttl, stale window, invalidated by
+const CachePolicy cachePolicies[] = {
+    {"channel.groups", 3600, 86400, InvalidateEPG},
+    {"setting.get&key=/Settings/Recording/", 3600, 86400, InvalidateNone},
+    {"recording.recurring.list", 300, 3600, InvalidateRecordings},
+    {"/public/service.xml", 3600, 86400, InvalidateEPG}};
+
+// requests that change what the recording and timer lists return
+const char* recordingMutations[] = {"recording.save", "recording.delete", "recording.forget",
+                                    "recording.recurring.save", "recording.recurring.delete"};
+} // unnamed namespace
+
+const CachePolicy* ResponseCache::GetPolicy(const std::string& resource) const
+{
+  for (const CachePolicy& policy : cachePolicies)
+  {
+    if (kodi::tools::StringUtils::StartsWith(resource, policy.prefix))
+      return &policy;
+  }
+  return nullptr;
+}
+
+bool ResponseCache::IsCacheable(const std::string& resource) const
+{
+  return GetPolicy(resource) != nullptr;
+}
+
+bool ResponseCache::Get(const std::string& resource, std::string& response, bool& stale)
+{
+  if (!IsCacheable(resource))
+    return false;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_entries.find(resource);
+  const time_t now = time(nullptr);
+  if (it == m_entries.end() || now >= it->second.fetched + it->second.policy->ttl + it->second.policy->stale)
+  {
+    m_misses++;
+    return false;
+  }
+  stale = now >= it->second.fetched + it->second.policy->ttl;
+  if (stale)
+    m_staleHits++;
+  else
+    m_hits++;
+  response = it->second.response;
+  return true;
+}
+
+bool ResponseCache::GetFallback(const std::string& resource, std::string& response)
+{
+  // backend failed, any copy that has not been invalidated beats nothing
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_entries.find(resource);
+  if (it == m_entries.end())
+    return false;
+  m_fallbacks++;
+  response = it->second.response;
+  return true;
+}
+
+void ResponseCache::Put(const std::string& resource, const std::string& response)
+{
+  const CachePolicy* policy = GetPolicy(resource);
+  if (policy == nullptr)
+    return;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_entries[resource] = {response, time(nullptr), policy};
+}
+
+void ResponseCache::Invalidate(const std::string& resource)
+{
+  if (kodi::tools::StringUtils::StartsWith(resource, "session.login"))
+  {
+    Clear();
+    return;
+  }
+  for (const char* mutation : recordingMutations)
+  {
+    if (kodi::tools::StringUtils::StartsWith(resource, mutation))
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      InvalidateLocked(InvalidateRecordings);
+      return;
+    }
+  }
+}
+
+void ResponseCache::Validate(eCacheInvalidation invalidation, time_t lastUpdate)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_lastUpdate[invalidation] != lastUpdate)
+  {
+    if (m_lastUpdate[invalidation] != 0)
+      InvalidateLocked(invalidation);
+    m_lastUpdate[invalidation] = lastUpdate;
+  }
+}
+
+void ResponseCache::InvalidateLocked(eCacheInvalidation invalidation)
+{
+  for (auto it = m_entries.begin(); it != m_entries.end();)
+  {
+    if (it->second.policy->invalidation == invalidation)
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "ResponseCache invalidated %s", it->first.c_str());
+      it = m_entries.erase(it);
+      m_invalidations++;
+    }
+    else
+      ++it;
+  }
+}
+
+void ResponseCache::Clear()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_entries.clear();
+}
+
+std::string ResponseCache::GetStats() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return kodi::tools::StringUtils::Format("entries %zu hits %u stale %u misses %u fallbacks %u invalidations %u",
+                                          m_entries.size(), m_hits, m_staleHits, m_misses, m_fallbacks, m_invalidations);
+}
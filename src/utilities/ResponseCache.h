@@ -0,0 +1,85 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+enum eCacheInvalidation
+{
+  InvalidateNone = 0,
+  InvalidateRecordings = 1,
+  InvalidateEPG = 2
+};
+
+struct CachePolicy
+{
+  const char* prefix;
+  // seconds a response is served without asking the backend
+  time_t ttl;
+  // further seconds an expired response is served while it is refreshed
+  time_t stale;
+  eCacheInvalidation invalidation;
+};
+
+/*
+ * Response text for backend methods that rarely change, keyed by the full
+ * resource.  Each method has a policy in ResponseCache.cpp; anything without
+ * one is never cached.  Entries are dropped when the recording.lastupdated or
+ * system.epg.summary stamp they depend on moves, or when a request that
+ * changes recordings or timers is sent.
+ */
+class ResponseCache
+{
+public:
+  ResponseCache() = default;
+
+  bool IsCacheable(const std::string& resource) const;
+  bool Get(const std::string& resource, std::string& response, bool& stale);
+  bool GetFallback(const std::string& resource, std::string& response);
+  void Put(const std::string& resource, const std::string& response);
+
+  void Invalidate(const std::string& resource);
+  void Validate(eCacheInvalidation invalidation, time_t lastUpdate);
+  void Clear();
+
+  std::string GetStats() const;
+
+private:
+  ResponseCache(ResponseCache const&) = delete;
+  void operator=(ResponseCache const&) = delete;
+
+  struct CacheEntry
+  {
+    std::string response;
+    time_t fetched;
+    const CachePolicy* policy;
+  };
+
+  const CachePolicy* GetPolicy(const std::string& resource) const;
+  void InvalidateLocked(eCacheInvalidation invalidation);
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, CacheEntry> m_entries;
+  time_t m_lastUpdate[3]{0, 0, 0};
+  unsigned int m_hits{0};
+  unsigned int m_staleHits{0};
+  unsigned int m_misses{0};
+  unsigned int m_fallbacks{0};
+  unsigned int m_invalidations{0};
+};
+
+} // namespace utilities
+} // namespace NextPVR
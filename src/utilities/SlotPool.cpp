@@ -0,0 +1,136 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "SlotPool.h"
+
+#include <algorithm>
+
+using namespace NextPVR::utilities;
+
+SlotPool::SlotPool(const std::function<int()>& limit, int agingMilliseconds) :
+  m_limit(limit),
+  m_agingMilliseconds(std::max(1, agingMilliseconds))
+{
+}
+
+int64_t SlotPool::Acquire(int lane, bool& promoted)
+{
+  const auto start = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(m_mutex);
+  const uint64_t ticket = m_nextTicket++;
+  m_waiters.push_back({ticket, lane, start});
+  int& depth = m_queueDepth[lane];
+  depth++;
+  m_peakQueueDepth[lane] = std::max(m_peakQueueDepth[lane], depth);
+
+  while (!IsNextWaiter(ticket, std::max(1, m_limit())))
+  {
+    // aging can make a waiter next in line without anyone releasing a slot
+    std::chrono::steady_clock::time_point deadline;
+    if (NextAgingDeadline(std::chrono::steady_clock::now(), deadline))
+      m_slotAvailable.wait_until(lock, deadline);
+    else
+      m_slotAvailable.wait(lock);
+  }
+
+  auto waiter = std::find_if(m_waiters.begin(), m_waiters.end(), [ticket](const Waiter& w) { return w.ticket == ticket; });
+  const auto now = std::chrono::steady_clock::now();
+  promoted = EffectiveLane(*waiter, now) < lane;
+  if (promoted)
+    m_promotions++;
+  m_waiters.erase(waiter);
+  depth--;
+  m_active++;
+  lock.unlock();
+  // another waiter may now be first in line for a remaining slot
+  m_slotAvailable.notify_all();
+  return std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+}
+
+void SlotPool::Release()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_active--;
+  }
+  m_slotAvailable.notify_all();
+}
+
+int SlotPool::EffectiveLane(const Waiter& waiter, std::chrono::steady_clock::time_point now) const
+{
+  const int waited = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - waiter.queued).count());
+  return std::max(0, waiter.lane - waited / m_agingMilliseconds);
+}
+
+bool SlotPool::NextAgingDeadline(std::chrono::steady_clock::time_point now,
+                                 std::chrono::steady_clock::time_point& deadline) const
+{
+  // called with m_mutex held
+  const std::chrono::milliseconds aging(m_agingMilliseconds);
+  bool found = false;
+  for (const Waiter& waiter : m_waiters)
+  {
+    if (EffectiveLane(waiter, now) == 0)
+      continue;
+    const auto periods = (now - waiter.queued) / aging + 1;
+    const auto next = waiter.queued + periods * aging;
+    if (!found || next < deadline)
+      deadline = next;
+    found = true;
+  }
+  return found;
+}
+
+bool SlotPool::IsNextWaiter(uint64_t ticket, int limit) const
+{
+  // called with m_mutex held
+  if (m_active >= limit)
+    return false;
+
+  // keep one slot back for the other lanes unless the last lane's waiter has aged out of it
+  const int lastLaneLimit = std::max(1, limit - 1);
+  const auto now = std::chrono::steady_clock::now();
+  const Waiter* next = nullptr;
+  int nextLane = LANES;
+  for (const Waiter& waiter : m_waiters)
+  {
+    const int lane = EffectiveLane(waiter, now);
+    if (lane == LANES - 1 && m_active >= lastLaneLimit)
+      continue;
+    // m_waiters is in ticket order so the first of the best lane wins
+    if (lane < nextLane)
+    {
+      next = &waiter;
+      nextLane = lane;
+    }
+  }
+  return next != nullptr && next->ticket == ticket;
+}
+
+int SlotPool::GetActive() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_active;
+}
+
+int SlotPool::GetQueueDepth(int lane) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_queueDepth[lane];
+}
+
+int SlotPool::GetPeakQueueDepth(int lane) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_peakQueueDepth[lane];
+}
+
+unsigned int SlotPool::GetPromotions() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_promotions;
+}
@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+/*
+ * A limited number of slots granted to waiting threads in lane order, lane
+ * 0 first and in arrival order within a lane.  A waiter moves up one lane
+ * for every agingMilliseconds it waits so the last lane is never starved,
+ * and the last lane is kept off the final free slot when the limit allows
+ * it.  Waiters wake up at the next aging step as well as on a release,
+ * and the limit is asked for on every wake up so it can change at any
+ * time.
+ */
+class SlotPool
+{
+public:
+  static constexpr int LANES = 3;
+
+  SlotPool(const std::function<int()>& limit, int agingMilliseconds);
+
+  /* \brief Blocks until a slot is free and this waiter is first in line for it.
+     \param[in] lane 0 to LANES - 1
+     \param[out] promoted true when aging moved the waiter up from its lane
+     \return the microseconds waited
+  */
+  int64_t Acquire(int lane, bool& promoted);
+  void Release();
+
+  int GetActive() const;
+  int GetQueueDepth(int lane) const;
+  int GetPeakQueueDepth(int lane) const;
+  unsigned int GetPromotions() const;
+
+private:
+  SlotPool(SlotPool const&) = delete;
+  void operator=(SlotPool const&) = delete;
+
+  struct Waiter
+  {
+    uint64_t ticket;
+    int lane;
+    std::chrono::steady_clock::time_point queued;
+  };
+
+  int EffectiveLane(const Waiter& waiter, std::chrono::steady_clock::time_point now) const;
+  bool NextAgingDeadline(std::chrono::steady_clock::time_point now,
+                         std::chrono::steady_clock::time_point& deadline) const;
+  bool IsNextWaiter(uint64_t ticket, int limit) const;
+
+  const std::function<int()> m_limit;
+  const int m_agingMilliseconds;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_slotAvailable;
+  int m_active = 0;
+  uint64_t m_nextTicket = 0;
+  std::list<Waiter> m_waiters;
+  int m_queueDepth[LANES]{0};
+  int m_peakQueueDepth[LANES]{0};
+  unsigned int m_promotions = 0;
+};
+
+} // namespace utilities
+} // namespace NextPVR
@@ -0,0 +1,57 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "StringPool.h"
+
+#include "kodi/tools/StringUtils.h"
+
+#include <cstring>
+
+using namespace NextPVR::utilities;
+
+std::string_view StringPool::Intern(std::string_view value)
+{
+  if (value.empty())
+    return std::string_view();
+
+  m_total++;
+  auto it = m_strings.find(value);
+  if (it != m_strings.end())
+  {
+    m_savedBytes += value.length();
+    return *it;
+  }
+
+  char* data;
+  if (value.length() > BLOCK_SIZE / 4)
+  {
+    // a long value gets a block of its own rather than wasting the tail of the current one
+    m_blocks.emplace_back(new char[value.length()]);
+    data = m_blocks.back().get();
+  }
+  else
+  {
+    if (value.length() > m_free)
+    {
+      m_blocks.emplace_back(new char[BLOCK_SIZE]);
+      m_next = m_blocks.back().get();
+      m_free = BLOCK_SIZE;
+    }
+    data = m_next;
+    m_next += value.length();
+    m_free -= value.length();
+  }
+  memcpy(data, value.data(), value.length());
+  m_bytes += value.length();
+  return *m_strings.emplace(data, value.length()).first;
+}
+
+std::string StringPool::GetStats() const
+{
+  return kodi::tools::StringUtils::Format("%zu unique of %zu strings, %zu bytes held, %zu bytes not copied",
+                                          m_strings.size(), m_total, m_bytes, m_savedBytes);
+}
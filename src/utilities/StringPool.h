@@ -0,0 +1,55 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+/*
+ * Interns the metadata that repeats across one refresh, genres, cast and
+ * crew lists, channel names and the like, so every distinct value is
+ * copied once into an arena of large blocks instead of into a string per
+ * occurrence.  Views returned by Intern() stay valid for the life of the
+ * pool.  A pool is filled by one thread at a time, the threads of a
+ * refresh each intern into a pool of their own.
+ */
+class StringPool
+{
+public:
+  StringPool() = default;
+
+  std::string_view Intern(std::string_view value);
+  // unique against total strings interned, and the bytes that were not copied
+  std::string GetStats() const;
+
+private:
+  StringPool(StringPool const&) = delete;
+  void operator=(StringPool const&) = delete;
+
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+  std::vector<std::unique_ptr<char[]>> m_blocks;
+  char* m_next = nullptr;
+  size_t m_free = 0;
+  std::unordered_set<std::string_view> m_strings;
+  size_t m_total = 0;
+  size_t m_bytes = 0;
+  size_t m_savedBytes = 0;
+};
+
+} // namespace utilities
+} // namespace NextPVR
@@ -0,0 +1,240 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <tinyxml2.h>
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+// text against a lower case word, ignoring the case of the text
+inline bool EqualsLower(std::string_view text, std::string_view lower)
+{
+  if (text.length() != lower.length())
+    return false;
+  for (size_t i = 0; i < text.length(); i++)
+  {
+    if (::tolower(static_cast<unsigned char>(text[i])) != lower[i])
+      return false;
+  }
+  return true;
+}
+
+/* \brief Reads the text of a boolean element the way XMLUtils::GetBoolean does, without copying it.
+   \return true if the text is a recognised switch, value is still set for other text
+*/
+inline bool ParseBoolean(std::string_view text, bool& value)
+{
+  for (const std::string_view off : {"off", "no", "disabled", "false", "0"})
+  {
+    if (EqualsLower(text, off))
+    {
+      value = false;
+      return true;
+    }
+  }
+  value = true;
+  for (const std::string_view on : {"on", "yes", "enabled", "true"})
+  {
+    if (EqualsLower(text, on))
+      return true;
+  }
+  return false; // invalid bool switch - it's probably some other string.
+}
+
+/* \brief Parses a leading integer the way atoi and atoll do, without locale or errno.
+   \param[in] text the text, at most maxLength characters are read
+   \return the value, 0 when there is no number
+*/
+template<typename T>
+inline T ParseInteger(const char* text, size_t maxLength = std::string::npos)
+{
+  std::string_view view(text);
+  if (view.length() > maxLength)
+    view = view.substr(0, maxLength);
+  size_t start = 0;
+  while (start < view.length() && ::isspace(static_cast<unsigned char>(view[start])))
+    start++;
+  if (start < view.length() && view[start] == '+')
+    start++;
+  T value = 0;
+  if (std::from_chars(view.data() + start, view.data() + view.length(), value).ec != std::errc())
+    return 0;
+  return value;
+}
+
+/*
+ * The child element names one record type reads, given in any order.  The
+ * constructor sorts an index over them at compile time so a child's name is
+ * found by binary search, and field numbers stay the positions in names.
+ */
+template<size_t N>
+struct XMLFieldTable
+{
+  constexpr explicit XMLFieldTable(const std::array<std::string_view, N>& fieldNames) :
+    names(fieldNames),
+    order()
+  {
+    for (size_t i = 0; i < N; i++)
+      order[i] = i;
+    for (size_t i = 1; i < N; i++)
+    {
+      for (size_t j = i; j > 0 && names[order[j]] < names[order[j - 1]]; j--)
+      {
+        const size_t swap = order[j];
+        order[j] = order[j - 1];
+        order[j - 1] = swap;
+      }
+    }
+  }
+
+  int Find(std::string_view name) const
+  {
+    size_t low = 0;
+    size_t high = N;
+    while (low < high)
+    {
+      const size_t mid = (low + high) / 2;
+      const int compare = names[order[mid]].compare(name);
+      if (compare == 0)
+        return static_cast<int>(order[mid]);
+      if (compare < 0)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+    return -1;
+  }
+
+  std::array<std::string_view, N> names;
+  std::array<size_t, N> order;
+};
+
+template<typename... Names>
+constexpr XMLFieldTable<sizeof...(Names)> MakeFieldTable(Names... names)
+{
+  return XMLFieldTable<sizeof...(Names)>(std::array<std::string_view, sizeof...(Names)>{names...});
+}
+
+/*
+ * One pass over a record's children, keeping the first element for every
+ * field in the table like FirstChildElement() would find.  The getters
+ * mirror the XMLUtils functions of the same name and give the same results,
+ * except that numbers are parsed with std::from_chars.
+ */
+template<size_t N>
+class XMLRecordFields
+{
+public:
+  XMLRecordFields(const tinyxml2::XMLNode* pRecordNode, const XMLFieldTable<N>& table) :
+    m_elements()
+  {
+    if (pRecordNode == nullptr)
+      return;
+    for (const tinyxml2::XMLElement* pElement = pRecordNode->FirstChildElement(); pElement; pElement = pElement->NextSiblingElement())
+    {
+      const int field = table.Find(pElement->Name());
+      if (field >= 0 && m_elements[field] == nullptr)
+        m_elements[field] = pElement;
+    }
+  }
+
+  const tinyxml2::XMLElement* Element(size_t field) const { return m_elements[field]; }
+  bool Has(size_t field) const { return m_elements[field] != nullptr; }
+
+  bool GetString(size_t field, std::string& value) const
+  {
+    if (m_elements[field] == nullptr)
+      return false;
+    const char* text = Text(field);
+    if (text != nullptr)
+    {
+      value = text;
+      return true;
+    }
+    value.clear();
+    return false;
+  }
+
+  /* \brief Like GetString(), without copying the text out of the document.
+     \return true if the element has text
+  */
+  bool GetView(size_t field, std::string_view& value) const
+  {
+    const char* text = Text(field);
+    value = text == nullptr ? std::string_view() : std::string_view(text);
+    return text != nullptr;
+  }
+
+  bool GetInt(size_t field, int32_t& value) const
+  {
+    const char* text = Text(field);
+    if (text == nullptr)
+      return false;
+    value = ParseInteger<int32_t>(text);
+    return true;
+  }
+
+  int GetIntValue(size_t field, const int setDefault = 0) const
+  {
+    const char* text = Text(field);
+    return text == nullptr ? setDefault : ParseInteger<int32_t>(text);
+  }
+
+  int GetUIntValue(size_t field, const unsigned int setDefault = 0) const
+  {
+    const char* text = Text(field);
+    return text == nullptr ? setDefault : static_cast<int>(ParseInteger<int64_t>(text));
+  }
+
+  bool GetLong(size_t field, int64_t& value) const
+  {
+    const char* text = Text(field);
+    if (text == nullptr)
+      return false;
+    value = ParseInteger<int64_t>(text);
+    return true;
+  }
+
+  bool GetBoolean(size_t field, bool& value) const
+  {
+    const char* text = Text(field);
+    return text != nullptr && ParseBoolean(text, value);
+  }
+
+  /* \brief A backend timestamp, which may carry milliseconds, as whole seconds.
+     \return the time, or 0 when the element is missing
+  */
+  time_t GetTime(size_t field) const
+  {
+    const char* text = Text(field);
+    return text == nullptr ? 0 : static_cast<time_t>(ParseInteger<int64_t>(text, 10));
+  }
+
+private:
+  const char* Text(size_t field) const
+  {
+    if (m_elements[field] == nullptr || m_elements[field]->FirstChild() == nullptr)
+      return nullptr;
+    return m_elements[field]->FirstChild()->Value();
+  }
+
+  std::array<const tinyxml2::XMLElement*, N> m_elements;
+};
+
+} // namespace utilities
+} // namespace NextPVR
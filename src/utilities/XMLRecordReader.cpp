@@ -0,0 +1,245 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "XMLRecordReader.h"
+
+#include "kodi/General.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+using namespace NextPVR::utilities;
+
+tinyxml2::XMLError NextPVR::utilities::CheckResponseStatus(const tinyxml2::XMLElement* rsp)
+{
+  const char* attrib = rsp ? rsp->Attribute("stat") : nullptr;
+  if (attrib != nullptr && !strcmp(attrib, "ok"))
+    return tinyxml2::XML_SUCCESS;
+
+  kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest bad return %s", attrib ? attrib : "");
+  if (attrib != nullptr && !strcmp(attrib, "fail"))
+  {
+    const tinyxml2::XMLElement* err = rsp->FirstChildElement("err");
+    const char* code = err ? err->Attribute("code") : nullptr;
+    if (code)
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest error code %s", code);
+      if (atoi(code) == 8)
+        return tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED;
+    }
+  }
+  return tinyxml2::XML_NO_ATTRIBUTE;
+}
+
+XMLRecordReader::XMLRecordReader(const char* recordTag, const RecordCallback& callback) :
+  m_openTag(std::string("<") + recordTag),
+  m_closeTag(std::string("</") + recordTag + ">"),
+  m_callback(callback)
+{
+}
+
+bool XMLRecordReader::Feed(const char* data, size_t length)
+{
+  if (m_status != tinyxml2::XML_SUCCESS)
+    return false;
+
+  m_pending.append(data, length);
+  m_length += length;
+  ExtractRecords();
+  return m_status == tinyxml2::XML_SUCCESS;
+}
+
+tinyxml2::XMLError XMLRecordReader::Finish()
+{
+  if (m_status != tinyxml2::XML_SUCCESS)
+    return m_status;
+
+  if (m_records != 0)
+  {
+    // the records were handed over, only the end tags of the list may be left
+    if (!IsCompleteTail())
+    {
+      kodi::Log(ADDON_LOG_ERROR, "DoMethodRequest response truncated after %d records", m_records);
+      m_status = tinyxml2::XML_ERROR_PARSING;
+    }
+    return m_status;
+  }
+
+  // no records so nothing was discarded, check the whole response the same way as a DOM request
+  tinyxml2::XMLDocument doc;
+  m_status = doc.Parse(m_pending.data(), m_pending.size());
+  if (m_status == tinyxml2::XML_SUCCESS)
+    m_status = CheckResponseStatus(doc.RootElement());
+  return m_status;
+}
+
+tinyxml2::XMLError XMLRecordReader::CheckEnvelope(size_t length) const
+{
+  // parse the <rsp> start tag on its own, the element it opens is not finished yet
+  size_t pos = m_pending.find("<rsp");
+  while (pos != std::string::npos && pos + 4 < length && m_pending[pos + 4] != '>' &&
+         !std::isspace(static_cast<unsigned char>(m_pending[pos + 4])))
+    pos = m_pending.find("<rsp", pos + 1);
+  if (pos == std::string::npos || pos + 4 >= length)
+    return CheckResponseStatus(nullptr);
+
+  const size_t end = FindTagEnd(pos + 4, length);
+  if (end == std::string::npos)
+    return CheckResponseStatus(nullptr);
+
+  std::string startTag = m_pending.substr(pos, end - pos);
+  if (startTag.back() != '/')
+    startTag += '/';
+  startTag += '>';
+  tinyxml2::XMLDocument doc;
+  if (doc.Parse(startTag.data(), startTag.size()) != tinyxml2::XML_SUCCESS)
+    return CheckResponseStatus(nullptr);
+  return CheckResponseStatus(doc.RootElement());
+}
+
+bool XMLRecordReader::IsCompleteTail() const
+{
+  if (FindRecord(m_consumed) != std::string::npos)
+    return false;
+
+  // whitespace and end tags, the last of them </rsp>
+  bool closedResponse = false;
+  size_t pos = m_consumed;
+  while (pos < m_pending.length())
+  {
+    if (std::isspace(static_cast<unsigned char>(m_pending[pos])))
+    {
+      pos++;
+      continue;
+    }
+    if (closedResponse || m_pending.compare(pos, 2, "</") != 0)
+      return false;
+    const size_t end = m_pending.find('>', pos);
+    if (end == std::string::npos)
+      return false;
+    closedResponse = m_pending.compare(pos, end + 1 - pos, "</rsp>") == 0;
+    pos = end + 1;
+  }
+  return closedResponse;
+}
+
+size_t XMLRecordReader::FindRecord(size_t from) const
+{
+  // <recording> must not match <recordings>
+  size_t pos = m_pending.find(m_openTag, from);
+  while (pos != std::string::npos && pos + m_openTag.length() < m_pending.length())
+  {
+    const char next = m_pending[pos + m_openTag.length()];
+    if (next == '>' || next == '/' || std::isspace(static_cast<unsigned char>(next)))
+      return pos;
+    pos = m_pending.find(m_openTag, pos + 1);
+  }
+  return std::string::npos;
+}
+
+size_t XMLRecordReader::FindTagEnd(size_t from, size_t length) const
+{
+  // the '>' closing a start tag, one inside a quoted attribute value does not count
+  char quote = '\0';
+  for (size_t pos = from; pos < length; pos++)
+  {
+    const char c = m_pending[pos];
+    if (quote != '\0')
+    {
+      if (c == quote)
+        quote = '\0';
+    }
+    else if (c == '"' || c == '\'')
+      quote = c;
+    else if (c == '>')
+      return pos;
+  }
+  return std::string::npos;
+}
+
+size_t XMLRecordReader::FindRecordEnd(size_t start) const
+{
+  static const std::string CDATA_OPEN = "<![CDATA[";
+  static const std::string COMMENT_OPEN = "<!--";
+
+  size_t pos = FindTagEnd(start + m_openTag.length(), m_pending.length());
+  if (pos == std::string::npos)
+    return std::string::npos;
+  if (m_pending[pos - 1] == '/')
+    return pos + 1;
+
+  // npos until the whole record has arrived
+  while ((pos = m_pending.find('<', pos)) != std::string::npos)
+  {
+    if (m_pending.length() - pos < CDATA_OPEN.length() && m_pending.compare(pos, std::string::npos, CDATA_OPEN, 0, m_pending.length() - pos) == 0)
+      return std::string::npos;
+    if (m_pending.compare(pos, CDATA_OPEN.length(), CDATA_OPEN) == 0)
+    {
+      pos = m_pending.find("]]>", pos + CDATA_OPEN.length());
+      if (pos == std::string::npos)
+        return std::string::npos;
+      pos += 3;
+    }
+    else if (m_pending.compare(pos, COMMENT_OPEN.length(), COMMENT_OPEN) == 0)
+    {
+      pos = m_pending.find("-->", pos + COMMENT_OPEN.length());
+      if (pos == std::string::npos)
+        return std::string::npos;
+      pos += 3;
+    }
+    else if (m_pending.compare(pos, m_closeTag.length(), m_closeTag) == 0)
+    {
+      return pos + m_closeTag.length();
+    }
+    else if (m_pending.length() - pos < m_closeTag.length())
+    {
+      return std::string::npos;
+    }
+    else
+    {
+      pos++;
+    }
+  }
+  return std::string::npos;
+}
+
+void XMLRecordReader::ExtractRecords()
+{
+  size_t start;
+  while ((start = FindRecord(m_consumed)) != std::string::npos)
+  {
+    if (!m_checkedStatus)
+    {
+      // the <rsp> start tag is complete once the first record starts
+      m_status = CheckEnvelope(start);
+      if (m_status != tinyxml2::XML_SUCCESS)
+        return;
+      m_checkedStatus = true;
+    }
+
+    const size_t end = FindRecordEnd(start);
+    if (end == std::string::npos)
+      break;
+
+    m_status = m_recordDoc.Parse(m_pending.data() + start, end - start);
+    if (m_status != tinyxml2::XML_SUCCESS)
+    {
+      kodi::Log(ADDON_LOG_ERROR, "DoMethodRequest record %d parse error %d", m_records, m_status);
+      return;
+    }
+    m_callback(m_recordDoc.RootElement());
+    m_records++;
+    m_consumed = end;
+  }
+
+  if (m_checkedStatus && m_consumed != 0)
+  {
+    m_pending.erase(0, m_consumed);
+    m_consumed = 0;
+  }
+}
@@ -0,0 +1,71 @@
+/*
+ *  Copyright (C) 2005-2023 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include "tinyxml2.h"
+
+namespace NextPVR
+{
+namespace utilities
+{
+/*
+ * What a NextPVR <rsp> element reports: XML_SUCCESS for stat="ok",
+ * XML_ERROR_FILE_COULD_NOT_BE_OPENED when the backend no longer knows the
+ * session (error code 8) and XML_NO_ATTRIBUTE for any other answer.
+ */
+tinyxml2::XMLError CheckResponseStatus(const tinyxml2::XMLElement* rsp);
+
+/*
+ * Splits a NextPVR <rsp> response into its <recordTag> elements while the
+ * text is still arriving and parses each element into a small document of
+ * its own, so a listing is never held as one DOM.  Only the unfinished
+ * record is kept between calls to Feed(), which may be given any chunking.
+ * Records may be empty elements, and CDATA sections and comments inside a
+ * record are skipped when looking for its end tag.  Finish() fails with
+ * XML_ERROR_PARSING when the response stops before its closing </rsp>.
+ */
+class XMLRecordReader
+{
+public:
+  typedef std::function<void(tinyxml2::XMLElement*)> RecordCallback;
+
+  XMLRecordReader(const char* recordTag, const RecordCallback& callback);
+
+  bool Feed(const char* data, size_t length);
+  tinyxml2::XMLError Finish();
+
+  int Records() const { return m_records; }
+  size_t Length() const { return m_length; }
+
+private:
+  XMLRecordReader(XMLRecordReader const&) = delete;
+  void operator=(XMLRecordReader const&) = delete;
+
+  size_t FindRecord(size_t from) const;
+  size_t FindTagEnd(size_t from, size_t length) const;
+  size_t FindRecordEnd(size_t start) const;
+  tinyxml2::XMLError CheckEnvelope(size_t length) const;
+  bool IsCompleteTail() const;
+  void ExtractRecords();
+
+  const std::string m_openTag;
+  const std::string m_closeTag;
+  RecordCallback m_callback;
+  tinyxml2::XMLDocument m_recordDoc;
+  std::string m_pending;
+  size_t m_consumed{0};
+  size_t m_length{0};
+  int m_records{0};
+  bool m_checkedStatus{false};
+  tinyxml2::XMLError m_status{tinyxml2::XML_SUCCESS};
+};
+
+} // namespace utilities
+} // namespace NextPVR
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include "XMLRecordFields.h"
+
 #include <algorithm>
 #include <cstdint>
 #include <memory>
@@ -171,19 +173,7 @@ inline bool GetBoolean(const tinyxml2::XMLNode* pRootNode, const std::string& st
   const tinyxml2::XMLNode* pNode = pRootNode->FirstChildElement(strTag.c_str());
   if (!pNode || !pNode->FirstChild())
     return false;
-  std::string strEnabled = pNode->FirstChild()->Value();
-  std::transform(strEnabled.begin(), strEnabled.end(), strEnabled.begin(), ::tolower);
-  if (strEnabled == "off" || strEnabled == "no" || strEnabled == "disabled" ||
-    strEnabled == "false" || strEnabled == "0")
-    value = false;
-  else
-  {
-    value = true;
-    if (strEnabled != "on" && strEnabled != "yes" && strEnabled != "enabled" &&
-      strEnabled != "true")
-      return false; // invalid bool switch - it's probably some other string.
-  }
-  return true;
+  return ParseBoolean(pNode->FirstChild()->Value(), value);
 }
 //------------------------------------------------------------------------------
 